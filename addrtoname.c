@@ -63,6 +63,7 @@ extern int ether_ntohost(char *, const struct ether_addr *);
 #include "setsignal.h"
 #include "extract.h"
 #include "oui.h"
+#include "scratch.h"
 
 #ifndef ETHER_ADDR_LEN
 #define ETHER_ADDR_LEN	6
@@ -71,7 +72,8 @@ extern int ether_ntohost(char *, const struct ether_addr *);
 /*
  * hash tables for whatever-to-name translations
  *
- * XXX there has to be error checks against strdup(3) failure
+ * Entries and names are never freed; they come from the cache pool
+ * (see scratch.h), which exits with an error when memory runs out.
  */
 
 #define HASHNAMESIZE 4096
@@ -195,6 +197,97 @@ intoa(u_int32_t addr)
 	return cp + 1;
 }
 
+/*
+ * Write the IPv4 address pointed to by ap, in dotted-quad form, to
+ * buf, which must have room for INET_ADDRSTRLEN bytes.  Returns a
+ * pointer to the terminating '\0'.  No name lookup is done and nothing
+ * is cached, for printers that format many addresses seen only once
+ * (routing updates and the like) with -n.
+ */
+char *
+ipaddr_format(char *buf, const u_char *ap)
+{
+	register char *cp = buf;
+	register u_int byte;
+	register int i;
+
+	for (i = 0; i < 4; i++) {
+		byte = ap[i];
+		if (byte >= 100) {
+			*cp++ = byte / 100 + '0';
+			byte %= 100;
+			*cp++ = byte / 10 + '0';
+		} else if (byte >= 10)
+			*cp++ = byte / 10 + '0';
+		*cp++ = byte % 10 + '0';
+		*cp++ = '.';
+	}
+	*--cp = '\0';
+	return cp;
+}
+
+#ifdef INET6
+/*
+ * Write the IPv6 address pointed to by ap to buf, which must have room
+ * for INET6_ADDRSTRLEN bytes, in the form inet_ntop() uses: lower-case
+ * hex, the longest run of two or more zero words (the first, if there
+ * are several) written as "::", and the last 32 bits of IPv4-compatible
+ * and IPv4-mapped addresses in dotted-quad form.  Returns a pointer to
+ * the terminating '\0'.
+ */
+char *
+ip6addr_format(char *buf, const u_char *ap)
+{
+	static const char hex[] = "0123456789abcdef";
+	register char *cp = buf;
+	u_int words[8];
+	int i, best, bestlen, cur, curlen;
+
+	best = cur = -1;
+	bestlen = curlen = 0;
+	for (i = 0; i < 8; i++) {
+		words[i] = EXTRACT_16BITS(ap + 2 * i);
+		if (words[i] == 0) {
+			if (cur == -1) {
+				cur = i;
+				curlen = 0;
+			}
+			if (++curlen > bestlen) {
+				best = cur;
+				bestlen = curlen;
+			}
+		} else
+			cur = -1;
+	}
+	if (bestlen < 2)
+		best = -1;
+
+	for (i = 0; i < 8; i++) {
+		if (i == best) {
+			*cp++ = ':';
+			if (i == 0)
+				*cp++ = ':';
+			i += bestlen - 1;
+			continue;
+		}
+		if (i == 6 && best == 0 &&
+		    (bestlen == 6 || (bestlen == 5 && words[5] == 0xffff)))
+			return ipaddr_format(cp, ap + 12);
+		if (words[i] >= 0x1000)
+			*cp++ = hex[words[i] >> 12];
+		if (words[i] >= 0x100)
+			*cp++ = hex[(words[i] >> 8) & 0xf];
+		if (words[i] >= 0x10)
+			*cp++ = hex[(words[i] >> 4) & 0xf];
+		*cp++ = hex[words[i] & 0xf];
+		if (i < 7)
+			*cp++ = ':';
+	}
+	*cp = '\0';
+	return cp;
+}
+#endif /* INET6 */
+
 static u_int32_t f_netmask;
 static u_int32_t f_localnet;
 
@@ -246,7 +339,7 @@ getname(const u_char *ap)
 		if (hp) {
 			char *dotp;
 
-			p->name = strdup(hp->h_name);
+			p->name = pool_strdup(hp->h_name);
 			if (Nflag) {
 				/* Remove domain qualifications */
 				dotp = strchr(p->name, '.');
@@ -256,7 +349,7 @@ getname(const u_char *ap)
 			return (p->name);
 		}
 	}
-	p->name = strdup(intoa(addr));
+	p->name = pool_strdup(intoa(addr));
 	return (p->name);
 }
 
@@ -297,7 +390,7 @@ getname6(const u_char *ap)
 		if (hp) {
 			char *dotp;
 
-			p->name = strdup(hp->h_name);
+			p->name = pool_strdup(hp->h_name);
 			if (Nflag) {
 				/* Remove domain qualifications */
 				dotp = strchr(p->name, '.');
@@ -308,7 +401,7 @@ getname6(const u_char *ap)
 		}
 	}
 	cp = inet_ntop(AF_INET6, &addr, ntop_buf, sizeof(ntop_buf));
-	p->name = strdup(cp);
+	p->name = pool_strdup(cp);
 	return (p->name);
 }
 #endif /* INET6 */
@@ -339,9 +432,7 @@ lookup_emem(const u_char *ep)
 	tp->e_addr0 = i;
 	tp->e_addr1 = j;
 	tp->e_addr2 = k;
-	tp->e_nxt = (struct enamemem *)calloc(1, sizeof(*tp));
-	if (tp->e_nxt == NULL)
-		error("lookup_emem: calloc");
+	tp->e_nxt = (struct enamemem *)pool_alloc(sizeof(*tp));
 
 	return tp;
 }
@@ -382,14 +473,10 @@ lookup_bytestring(register const u_char *bs, const unsigned int nlen)
 	tp->e_addr1 = j;
 	tp->e_addr2 = k;
 
-	tp->e_bs = (u_char *) calloc(1, nlen + 1);
-	if (tp->e_bs == NULL)
-		error("lookup_bytestring: calloc");
+	tp->e_bs = (u_char *) pool_alloc(nlen + 1);
 
 	memcpy(tp->e_bs, bs, nlen);
-	tp->e_nxt = (struct enamemem *)calloc(1, sizeof(*tp));
-	if (tp->e_nxt == NULL)
-		error("lookup_bytestring: calloc");
+	tp->e_nxt = (struct enamemem *)pool_alloc(sizeof(*tp));
 
 	return tp;
 }
@@ -426,13 +513,9 @@ lookup_nsap(register const u_char *nsap)
 	tp->e_addr0 = i;
 	tp->e_addr1 = j;
 	tp->e_addr2 = k;
-	tp->e_nsap = (u_char *)malloc(nlen + 1);
-	if (tp->e_nsap == NULL)
-		error("lookup_nsap: malloc");
+	tp->e_nsap = (u_char *)pool_alloc(nlen + 1);
 	memcpy((char *)tp->e_nsap, (const char *)nsap, nlen + 1);
-	tp->e_nxt = (struct enamemem *)calloc(1, sizeof(*tp));
-	if (tp->e_nxt == NULL)
-		error("lookup_nsap: calloc");
+	tp->e_nxt = (struct enamemem *)pool_alloc(sizeof(*tp));
 
 	return tp;
 }
@@ -458,9 +541,7 @@ lookup_protoid(const u_char *pi)
 			tp = tp->p_nxt;
 	tp->p_oui = i;
 	tp->p_proto = j;
-	tp->p_nxt = (struct protoidmem *)calloc(1, sizeof(*tp));
-	if (tp->p_nxt == NULL)
-		error("lookup_protoid: calloc");
+	tp->p_nxt = (struct protoidmem *)pool_alloc(sizeof(*tp));
 
 	return tp;
 }
@@ -488,7 +569,7 @@ etheraddr_string(register const u_char *ep)
 		 * don't modify what it points to.
 		 */
 		if (ether_ntohost(buf2, (struct ether_addr *)ep) == 0) {
-			tp->e_name = strdup(buf2);
+			tp->e_name = pool_strdup(buf2);
 			return (tp->e_name);
 		}
 	}
@@ -508,7 +589,7 @@ etheraddr_string(register const u_char *ep)
 		    tok2str(oui_values, "Unknown", oui));
 	} else
 		*cp = '\0';
-	tp->e_name = strdup(buf);
+	tp->e_name = pool_strdup(buf);
 	return (tp->e_name);
 }
 
@@ -535,7 +616,7 @@ le64addr_string(const u_char *ep)
 
 	*cp = '\0';
 
-	tp->e_name = strdup(buf);
+	tp->e_name = pool_strdup(buf);
 
 	return (tp->e_name);
 }
@@ -560,9 +641,7 @@ linkaddr_string(const u_char *ep, const unsigned int type, const unsigned int le
 	if (tp->e_name)
 		return (tp->e_name);
 
-	tp->e_name = cp = (char *)malloc(len*3);
-	if (tp->e_name == NULL)
-		error("linkaddr_string: malloc");
+	tp->e_name = cp = (char *)pool_alloc(len*3);
 	*cp++ = hex[*ep >> 4];
 	*cp++ = hex[*ep++ & 0xf];
 	for (i = len-1; i > 0 ; --i) {
@@ -596,7 +675,7 @@ etherproto_string(u_short port)
 	*cp++ = hex[port >> 4 & 0xf];
 	*cp++ = hex[port & 0xf];
 	*cp++ = '\0';
-	tp->name = strdup(buf);
+	tp->name = pool_strdup(buf);
 	return (tp->name);
 }
 
@@ -623,7 +702,7 @@ protoid_string(register const u_char *pi)
 		*cp++ = hex[*pi++ & 0xf];
 	}
 	*cp = '\0';
-	tp->p_name = strdup(buf);
+	tp->p_name = pool_strdup(buf);
 	return (tp->p_name);
 }
 
@@ -642,9 +721,7 @@ isonsap_string(const u_char *nsap, register u_int nsap_length)
 	if (tp->e_name)
 		return tp->e_name;
 
-	tp->e_name = cp = (char *)malloc(sizeof("xx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xx"));
-	if (cp == NULL)
-		error("isonsap_string: malloc");
+	tp->e_name = cp = (char *)pool_alloc(sizeof("xx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xx"));
 
 	for (nsap_idx = 0; nsap_idx < nsap_length; nsap_idx++) {
 		*cp++ = hex[*nsap >> 4];
@@ -673,7 +750,7 @@ tcpport_string(u_short port)
 	tp->nxt = newhnamemem();
 
 	(void)snprintf(buf, sizeof(buf), "%u", i);
-	tp->name = strdup(buf);
+	tp->name = pool_strdup(buf);
 	return (tp->name);
 }
 
@@ -692,7 +769,7 @@ udpport_string(register u_short port)
 	tp->nxt = newhnamemem();
 
 	(void)snprintf(buf, sizeof(buf), "%u", i);
-	tp->name = strdup(buf);
+	tp->name = pool_strdup(buf);
 	return (tp->name);
 }
 
@@ -718,7 +795,7 @@ ipxsap_string(u_short port)
 	*cp++ = hex[port >> 4 & 0xf];
 	*cp++ = hex[port & 0xf];
 	*cp++ = '\0';
-	tp->name = strdup(buf);
+	tp->name = pool_strdup(buf);
 	return (tp->name);
 }
 
@@ -744,9 +821,9 @@ init_servarray(void)
 			table = table->nxt;
 		if (nflag) {
 			(void)snprintf(buf, sizeof(buf), "%d", port);
-			table->name = strdup(buf);
+			table->name = pool_strdup(buf);
 		} else
-			table->name = strdup(sv->s_name);
+			table->name = pool_strdup(sv->s_name);
 		table->addr = port;
 		table->nxt = newhnamemem();
 	}
@@ -813,7 +890,7 @@ init_protoidarray(void)
 
 		memcpy((char *)&protoid[3], (char *)&etype, 2);
 		tp = lookup_protoid(protoid);
-		tp->p_name = strdup(eproto_db[i].s);
+		tp->p_name = pool_strdup(eproto_db[i].s);
 	}
 	/* Hardwire some SNAP proto ID names */
 	for (pl = protoidlist; pl->name != NULL; ++pl) {
@@ -864,7 +941,7 @@ init_etherarray(void)
 	if (fp != NULL) {
 		while ((ep = pcap_next_etherent(fp)) != NULL) {
 			tp = lookup_emem(ep->addr);
-			tp->e_name = strdup(ep->name);
+			tp->e_name = pool_strdup(ep->name);
 		}
 		(void)fclose(fp);
 	}
@@ -887,7 +964,7 @@ init_etherarray(void)
 		 * as a "const" pointer.
 		 */
 		if (ether_ntohost(name, (struct ether_addr *)el->addr) == 0) {
-			tp->e_name = strdup(name);
+			tp->e_name = pool_strdup(name);
 			continue;
 		}
 #endif
@@ -1175,42 +1252,18 @@ dnaddr_string(u_short dnaddr)
 	return(tp->name);
 }
 
-/* Return a zero'ed hnamemem struct and cuts down on calloc() overhead */
+/* Return a zero'ed hnamemem struct */
 struct hnamemem *
 newhnamemem(void)
 {
-	register struct hnamemem *p;
-	static struct hnamemem *ptr = NULL;
-	static u_int num = 0;
-
-	if (num  <= 0) {
-		num = 64;
-		ptr = (struct hnamemem *)calloc(num, sizeof (*ptr));
-		if (ptr == NULL)
-			error("newhnamemem: calloc");
-	}
-	--num;
-	p = ptr++;
-	return (p);
+	return ((struct hnamemem *)pool_alloc(sizeof(struct hnamemem)));
 }
 
 #ifdef INET6
-/* Return a zero'ed h6namemem struct and cuts down on calloc() overhead */
+/* Return a zero'ed h6namemem struct */
 struct h6namemem *
 newh6namemem(void)
 {
-	register struct h6namemem *p;
-	static struct h6namemem *ptr = NULL;
-	static u_int num = 0;
-
-	if (num  <= 0) {
-		num = 64;
-		ptr = (struct h6namemem *)calloc(num, sizeof (*ptr));
-		if (ptr == NULL)
-			error("newh6namemem: calloc");
-	}
-	--num;
-	p = ptr++;
-	return (p);
+	return ((struct h6namemem *)pool_alloc(sizeof(struct h6namemem)));
 }
 #endif /* INET6 */
@@ -41,6 +41,10 @@ extern const char *getname(const u_char *);
 extern const char *getname6(const u_char *);
 #endif
 extern const char *intoa(u_int32_t);
+extern char *ipaddr_format(char *, const u_char *);
+#ifdef INET6
+extern char *ip6addr_format(char *, const u_char *);
+#endif
 
 extern void init_addrtoname(u_int32_t, u_int32_t);
 extern struct hnamemem *newhnamemem(void);
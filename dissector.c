@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Registry of dissectors added at run time, and the plugin loader;
+ * see dissector.h.
+ */
+
+#define NETDISSECT_REWORKED
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <tcpdump-stdinc.h>
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_DLOPEN
+#include <dlfcn.h>
+#endif
+
+#include "interface.h"
+#include "dissector.h"
+#include "porttable.h"
+
+#define DISSECTOR_DLT_MAX	32
+
+static struct {
+	int		type;
+	if_ndo_printer	f;
+} dlt_dissectors[DISSECTOR_DLT_MAX];
+static u_int n_dlt_dissectors;
+
+dissector_func *ethertype_dissectors;
+dissector_func *ipproto_dissectors;
+
+static const struct dissector_api dissector_api = {
+	DISSECTOR_API_VERSION,
+	dissector_register_dlt,
+	dissector_register_ethertype,
+	dissector_register_ipproto,
+	dissector_register_port,
+	sizeof(netdissect_options)
+};
+
+void
+dissector_register_dlt(int type, if_ndo_printer f)
+{
+	u_int i;
+
+	for (i = 0; i < n_dlt_dissectors; i++)
+		if (dlt_dissectors[i].type == type)
+			break;
+	if (i == n_dlt_dissectors) {
+		if (i == DISSECTOR_DLT_MAX)
+			error("dissector_register_dlt: too many link-layer types");
+		dlt_dissectors[i].type = type;
+		n_dlt_dissectors++;
+	}
+	dlt_dissectors[i].f = f;
+}
+
+if_ndo_printer
+dissector_lookup_dlt(int type)
+{
+	u_int i;
+
+	for (i = 0; i < n_dlt_dissectors; i++)
+		if (dlt_dissectors[i].type == type)
+			return dlt_dissectors[i].f;
+	return NULL;
+}
+
+void
+dissector_register_ethertype(u_int type, dissector_func f)
+{
+	if (type > 0xffff)
+		error("dissector_register_ethertype: bad Ethernet type %u",
+		    type);
+	if (ethertype_dissectors == NULL) {
+		ethertype_dissectors = calloc(0x10000, sizeof(dissector_func));
+		if (ethertype_dissectors == NULL)
+			error("dissector_register_ethertype: calloc");
+	}
+	ethertype_dissectors[type] = f;
+}
+
+void
+dissector_register_ipproto(u_int proto, dissector_func f)
+{
+	if (proto > 0xff)
+		error("dissector_register_ipproto: bad IP protocol %u", proto);
+	if (ipproto_dissectors == NULL) {
+		ipproto_dissectors = calloc(0x100, sizeof(dissector_func));
+		if (ipproto_dissectors == NULL)
+			error("dissector_register_ipproto: calloc");
+	}
+	ipproto_dissectors[proto] = f;
+}
+
+void
+dissector_register_port(const char *proto, u_int lo, u_int hi,
+			const char *name, dissector_func f)
+{
+	struct port_table *pt;
+	u_int printer;
+
+	pt = port_table_find(proto);
+	if (pt == NULL)
+		error("dissector_register_port: unknown protocol `%s'", proto);
+	if (lo <= hi && hi > 65535)
+		error("dissector_register_port: bad port %u", hi);
+	printer = port_table_add(pt, name, f);
+	if (lo <= hi)
+		port_table_set(pt, lo, hi, printer);
+}
+
+void
+dissector_load_plugin(const char *file)
+{
+#ifdef HAVE_DLOPEN
+	void *handle;
+	const struct dissector_abi *abi;
+	dissector_plugin_init init;
+
+	handle = dlopen(file, RTLD_NOW | RTLD_LOCAL);
+	if (handle == NULL)
+		error("can't load %s: %s", file, dlerror());
+	abi = (const struct dissector_abi *)dlsym(handle,
+	    DISSECTOR_PLUGIN_ABI_NAME);
+	if (abi == NULL)
+		error("%s: no %s; rebuild it with this version of tcpdump",
+		    file, DISSECTOR_PLUGIN_ABI_NAME);
+	if (abi->api_version > DISSECTOR_API_VERSION ||
+	    abi->ndo_size != sizeof(netdissect_options))
+		error("%s: built for another version of tcpdump; rebuild it",
+		    file);
+	init = (dissector_plugin_init)dlsym(handle, DISSECTOR_PLUGIN_INIT);
+	if (init == NULL)
+		error("%s: no %s function", file, DISSECTOR_PLUGIN_INIT);
+	if ((*init)(&dissector_api) != 0)
+		error("%s: plugin initialization failed", file);
+#else
+	error("can't load %s: plugins are not supported on this platform",
+	    file);
+#endif
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Dissectors added at run time, by link-layer type, Ethernet type,
+ * IP protocol or UDP/TCP port.
+ *
+ * The built-in printers are still picked by the switches in
+ * ethertype_print(), ip_print_demux(), ip6_print() and the port tables;
+ * a dissector registered here comes before the built-in printer for the
+ * same value.  Each lookup is one table index, and until something is
+ * registered the tables aren't allocated and the lookup is a test for
+ * NULL.
+ *
+ * Dissectors are called with the payload, its length and the enclosing
+ * IPv4 or IPv6 header (NULL for Ethernet types), and print with
+ * ND_PRINT(); the end of the captured data is ndo->ndo_snapend.
+ */
+
+extern dissector_func *ethertype_dissectors;	/* 65536 entries, or NULL */
+extern dissector_func *ipproto_dissectors;	/* 256 entries, or NULL */
+
+#define ethertype_dissector(t) \
+	(ethertype_dissectors != NULL ? ethertype_dissectors[(t)] : NULL)
+#define ipproto_dissector(p) \
+	(ipproto_dissectors != NULL ? ipproto_dissectors[(p)] : NULL)
+
+extern void dissector_register_dlt(int, if_ndo_printer);
+extern void dissector_register_ethertype(u_int, dissector_func);
+extern void dissector_register_ipproto(u_int, dissector_func);
+
+/*
+ * Adds a printer called "name" to the "udp" or "tcp" port table, so that
+ * a ports file can refer to it, and uses it for ports "lo" to "hi";
+ * lo > hi registers the name only.
+ */
+extern void dissector_register_port(const char *, u_int, u_int,
+				     const char *, dissector_func);
+
+extern if_ndo_printer dissector_lookup_dlt(int);
+
+/*
+ * Plugins are shared objects loaded with "-o plugin=file".  A plugin
+ * defines
+ *
+ *	int netdissect_plugin_init(const struct dissector_api *api);
+ *
+ * which registers its dissectors through "api" and returns 0, or
+ * returns -1 if api->version is older than the DISSECTOR_API_VERSION
+ * it was built with.  The registration functions are passed in rather
+ * than linked against, so tcpdump needn't export its symbols.
+ *
+ * Dissectors also use netdissect_options directly, through ND_PRINT()
+ * and ndo_snapend, and its layout changes from one version of tcpdump
+ * to the next, so a plugin has to be rebuilt against the netdissect.h
+ * of the tcpdump that loads it.  To let that be checked, a plugin also
+ * has, at file scope,
+ *
+ *	DISSECTOR_PLUGIN_ABI;
+ *
+ * which records the API version and the size of netdissect_options it
+ * was built with.  Plugins without it, or built for another API version
+ * or another netdissect_options, are refused before their init function
+ * is called.
+ */
+#define DISSECTOR_API_VERSION	2
+
+struct dissector_api {
+	u_int	version;
+	void	(*register_dlt)(int, if_ndo_printer);
+	void	(*register_ethertype)(u_int, dissector_func);
+	void	(*register_ipproto)(u_int, dissector_func);
+	void	(*register_port)(const char *, u_int, u_int, const char *,
+				 dissector_func);
+	size_t	ndo_size;		/* sizeof(netdissect_options) */
+};
+
+struct dissector_abi {
+	u_int	api_version;
+	size_t	ndo_size;
+};
+
+#define DISSECTOR_PLUGIN_INIT	"netdissect_plugin_init"
+#define DISSECTOR_PLUGIN_ABI_NAME "netdissect_plugin_abi"
+
+#define DISSECTOR_PLUGIN_ABI \
+	const struct dissector_abi netdissect_plugin_abi = { \
+		DISSECTOR_API_VERSION, sizeof(netdissect_options) \
+	}
+
+typedef int (*dissector_plugin_init)(const struct dissector_api *);
+
+extern void dissector_load_plugin(const char *);
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * IP fragment reassembly cache.
+ *
+ * Incomplete datagrams are kept in a hash table keyed on
+ * (af, proto, src, dst, id).  Everything is bounded, so that a flood
+ * of fragments can't make us grow without limit:
+ *
+ *	- datagrams are dropped "frag-timeout" seconds (in packet time)
+ *	  after their first fragment was seen;
+ *	- reassembly buffers come from a small slab allocator with a
+ *	  few fixed buffer sizes and a total budget of "frag-memory"
+ *	  bytes; when the budget is exhausted the oldest datagram is
+ *	  thrown away to make room;
+ *	- at most REASM_MAXCTX datagrams, each of at most REASM_MAXRANGES
+ *	  discontiguous pieces, are tracked at any time.
+ */
+
+#define NETDISSECT_REWORKED
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <tcpdump-stdinc.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "interface.h"
+#include "ipreasm.h"
+
+#define REASM_HASHSIZE	257
+#define REASM_MAXCTX	1024
+#define REASM_MAXRANGES	64
+#define REASM_MAXLEN	65535		/* largest reassembled payload */
+
+/*
+ * Slab buffer sizes; each includes IP_REASM_HDRMAX bytes of room for
+ * the network-layer header in front of the payload.
+ */
+static const u_int reasm_slab_size[] = {
+	2048,
+	8192,
+	IP_REASM_HDRMAX + REASM_MAXLEN
+};
+#define REASM_NCLASSES	(sizeof(reasm_slab_size) / sizeof(reasm_slab_size[0]))
+
+struct reasm_slab {
+	struct reasm_slab *next;	/* free list link */
+	u_int cls;
+	/* buffer follows */
+};
+#define SLAB_DATA(s)	((u_char *)((s) + 1))
+
+struct reasm_range {
+	u_int start;
+	u_int end;
+};
+
+struct reasm_ctx {
+	struct reasm_ctx *hnext;		/* hash chain / free list */
+	struct reasm_ctx *older, *newer;	/* age list */
+	struct ip_reasm_key key;
+	struct timeval first;		/* time stamp of the first fragment */
+	struct reasm_slab *slab;
+	u_int extent;			/* highest payload offset received */
+	u_int total;			/* payload length, once the last fragment was seen */
+	u_int hdrlen;			/* 0 until the offset-0 fragment was seen */
+	u_int nranges;
+	struct reasm_range range[REASM_MAXRANGES];
+};
+
+static struct reasm_ctx *reasm_hash[REASM_HASHSIZE];
+static struct reasm_ctx *reasm_oldest, *reasm_newest;
+static struct reasm_ctx *reasm_free_ctx;	/* recycled contexts */
+static struct reasm_ctx *reasm_completed;	/* handed out, awaiting ip_reasm_done() */
+static u_int reasm_nctx;			/* contexts ever allocated */
+
+static struct reasm_slab *reasm_free_slab[REASM_NCLASSES];
+static size_t reasm_slab_bytes;			/* malloc()ed for slabs, in use or free */
+
+static u_int
+reasm_hashkey(const struct ip_reasm_key *key)
+{
+	const u_int8_t *p = (const u_int8_t *)key;
+	u_int h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < sizeof(*key); i++)
+		h = (h ^ p[i]) * 16777619U;
+	return h % REASM_HASHSIZE;
+}
+
+static struct reasm_slab *
+reasm_slab_get(netdissect_options *ndo, u_int cls)
+{
+	struct reasm_slab *s;
+	u_int i;
+
+	if ((s = reasm_free_slab[cls]) != NULL) {
+		reasm_free_slab[cls] = s->next;
+		return s;
+	}
+
+	/*
+	 * Nothing to recycle; if we're over budget, give back idle
+	 * buffers of the other sizes before allocating a new one.
+	 */
+	for (i = 0; i < REASM_NCLASSES &&
+	    reasm_slab_bytes + reasm_slab_size[cls] > ndo->ndo_frag_memory; i++) {
+		while ((s = reasm_free_slab[i]) != NULL &&
+		    reasm_slab_bytes + reasm_slab_size[cls] > ndo->ndo_frag_memory) {
+			reasm_free_slab[i] = s->next;
+			reasm_slab_bytes -= reasm_slab_size[i];
+			free(s);
+		}
+	}
+	if (reasm_slab_bytes + reasm_slab_size[cls] > ndo->ndo_frag_memory)
+		return NULL;
+
+	s = (struct reasm_slab *)malloc(sizeof(*s) + reasm_slab_size[cls]);
+	if (s == NULL)
+		return NULL;
+	s->cls = cls;
+	reasm_slab_bytes += reasm_slab_size[cls];
+	return s;
+}
+
+static void
+reasm_slab_put(struct reasm_slab *s)
+{
+	s->next = reasm_free_slab[s->cls];
+	reasm_free_slab[s->cls] = s;
+}
+
+static void
+reasm_unlink(struct reasm_ctx *ctx)
+{
+	struct reasm_ctx **pp;
+
+	for (pp = &reasm_hash[reasm_hashkey(&ctx->key)]; *pp != NULL;
+	    pp = &(*pp)->hnext) {
+		if (*pp == ctx) {
+			*pp = ctx->hnext;
+			break;
+		}
+	}
+	if (ctx->older != NULL)
+		ctx->older->newer = ctx->newer;
+	else
+		reasm_oldest = ctx->newer;
+	if (ctx->newer != NULL)
+		ctx->newer->older = ctx->older;
+	else
+		reasm_newest = ctx->older;
+	ctx->older = ctx->newer = NULL;
+}
+
+static void
+reasm_release(struct reasm_ctx *ctx)
+{
+	if (ctx->slab != NULL)
+		reasm_slab_put(ctx->slab);
+	ctx->slab = NULL;
+	ctx->hnext = reasm_free_ctx;
+	reasm_free_ctx = ctx;
+}
+
+static void
+reasm_drop(struct reasm_ctx *ctx)
+{
+	reasm_unlink(ctx);
+	reasm_release(ctx);
+}
+
+static void
+reasm_expire(netdissect_options *ndo)
+{
+	while (reasm_oldest != NULL &&
+	    ndo->ndo_ts.tv_sec - reasm_oldest->first.tv_sec >
+	    (time_t)ndo->ndo_frag_timeout)
+		reasm_drop(reasm_oldest);
+}
+
+static struct reasm_ctx *
+reasm_lookup(netdissect_options *ndo, const struct ip_reasm_key *key)
+{
+	struct reasm_ctx *ctx;
+	u_int h;
+
+	h = reasm_hashkey(key);
+	for (ctx = reasm_hash[h]; ctx != NULL; ctx = ctx->hnext)
+		if (memcmp(&ctx->key, key, sizeof(*key)) == 0)
+			return ctx;
+
+	if ((ctx = reasm_free_ctx) != NULL)
+		reasm_free_ctx = ctx->hnext;
+	else if (reasm_nctx < REASM_MAXCTX) {
+		ctx = (struct reasm_ctx *)malloc(sizeof(*ctx));
+		if (ctx == NULL)
+			return NULL;
+		reasm_nctx++;
+	} else {
+		/* table full; the oldest datagram has to go */
+		if ((ctx = reasm_oldest) == NULL)
+			return NULL;
+		reasm_unlink(ctx);
+		if (ctx->slab != NULL)
+			reasm_slab_put(ctx->slab);
+	}
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->key = *key;
+	ctx->first = ndo->ndo_ts;
+	ctx->hnext = reasm_hash[h];
+	reasm_hash[h] = ctx;
+	ctx->older = reasm_newest;
+	if (reasm_newest != NULL)
+		reasm_newest->newer = ctx;
+	else
+		reasm_oldest = ctx;
+	reasm_newest = ctx;
+	return ctx;
+}
+
+/*
+ * Make sure the context's buffer can hold "len" payload bytes,
+ * moving to a larger slab if need be.
+ */
+static int
+reasm_reserve(netdissect_options *ndo, struct reasm_ctx *ctx, u_int len)
+{
+	struct reasm_slab *s;
+	u_int cls, need;
+
+	need = IP_REASM_HDRMAX + len;
+	if (ctx->slab != NULL && reasm_slab_size[ctx->slab->cls] >= need)
+		return 1;
+	for (cls = 0; reasm_slab_size[cls] < need; cls++)
+		;
+
+	while ((s = reasm_slab_get(ndo, cls)) == NULL) {
+		/* out of budget; sacrifice the oldest datagram, but not this one */
+		if (reasm_oldest == NULL || reasm_oldest == ctx)
+			return 0;
+		reasm_drop(reasm_oldest);
+	}
+	if (ctx->slab != NULL) {
+		memcpy(SLAB_DATA(s), SLAB_DATA(ctx->slab),
+		    IP_REASM_HDRMAX + ctx->extent);
+		reasm_slab_put(ctx->slab);
+	}
+	ctx->slab = s;
+	return 1;
+}
+
+/*
+ * Record [start, end) in the sorted list of received ranges, merging
+ * with the neighbours it overlaps or touches.
+ */
+static int
+reasm_add_range(struct reasm_ctx *ctx, u_int start, u_int end)
+{
+	struct reasm_range *r = ctx->range;
+	u_int i, j;
+
+	for (i = 0; i < ctx->nranges && r[i].end < start; i++)
+		;
+	if (i == ctx->nranges || end < r[i].start) {
+		/* disjoint from everything; insert a new range at i */
+		if (ctx->nranges == REASM_MAXRANGES)
+			return 0;
+		memmove(&r[i + 1], &r[i], (ctx->nranges - i) * sizeof(*r));
+		r[i].start = start;
+		r[i].end = end;
+		ctx->nranges++;
+		return 1;
+	}
+
+	/* r[i] overlaps or touches; absorb every later range that does too */
+	if (start < r[i].start)
+		r[i].start = start;
+	for (j = i + 1; j < ctx->nranges && r[j].start <= end; j++)
+		;
+	if (r[j - 1].end > end)
+		end = r[j - 1].end;
+	if (end > r[i].end)
+		r[i].end = end;
+	memmove(&r[i + 1], &r[j], (ctx->nranges - j) * sizeof(*r));
+	ctx->nranges -= j - i - 1;
+	return 1;
+}
+
+int
+ip_reasm_add(netdissect_options *ndo, const struct ip_reasm_key *key,
+	     u_int off, int more, const u_char *data, u_int len,
+	     const u_char *hdr, u_int hdrlen,
+	     u_char **dgram, u_int *dgramlen)
+{
+	struct reasm_ctx *ctx;
+	u_int end;
+
+	end = off + len;
+	if ((len == 0 && more) || end > REASM_MAXLEN || hdrlen > IP_REASM_HDRMAX)
+		return IP_REASM_DROPPED;
+
+	reasm_expire(ndo);
+	if ((ctx = reasm_lookup(ndo, key)) == NULL)
+		return IP_REASM_DROPPED;
+
+	if (!more) {
+		/* last fragment; it fixes the length of the datagram */
+		if ((ctx->total != 0 && ctx->total != end) || ctx->extent > end) {
+			reasm_drop(ctx);
+			return IP_REASM_DROPPED;
+		}
+		ctx->total = end;
+	} else if (ctx->total != 0 && end > ctx->total) {
+		reasm_drop(ctx);
+		return IP_REASM_DROPPED;
+	}
+
+	if (!reasm_reserve(ndo, ctx, end > ctx->extent ? end : ctx->extent) ||
+	    !reasm_add_range(ctx, off, end)) {
+		reasm_drop(ctx);
+		return IP_REASM_DROPPED;
+	}
+	memcpy(SLAB_DATA(ctx->slab) + IP_REASM_HDRMAX + off, data, len);
+	if (end > ctx->extent)
+		ctx->extent = end;
+	if (off == 0) {
+		memcpy(SLAB_DATA(ctx->slab) + IP_REASM_HDRMAX - hdrlen, hdr, hdrlen);
+		ctx->hdrlen = hdrlen;
+	}
+
+	if (ctx->total == 0 || ctx->hdrlen == 0 || ctx->nranges != 1 ||
+	    ctx->range[0].start != 0 || ctx->range[0].end != ctx->total)
+		return IP_REASM_PENDING;
+
+	/* complete; park it until the caller is done printing it */
+	reasm_unlink(ctx);
+	ctx->hnext = reasm_completed;
+	reasm_completed = ctx;
+	*dgram = SLAB_DATA(ctx->slab) + IP_REASM_HDRMAX - ctx->hdrlen;
+	*dgramlen = ctx->hdrlen + ctx->total;
+	return IP_REASM_COMPLETE;
+}
+
+void
+ip_reasm_done(netdissect_options *ndo _U_, u_char *dgram)
+{
+	struct reasm_ctx **pp, *ctx;
+
+	for (pp = &reasm_completed; (ctx = *pp) != NULL; pp = &ctx->hnext) {
+		if (dgram == SLAB_DATA(ctx->slab) + IP_REASM_HDRMAX - ctx->hdrlen) {
+			*pp = ctx->hnext;
+			reasm_release(ctx);
+			return;
+		}
+	}
+}
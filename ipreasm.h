@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * IPv4/IPv6 fragment reassembly, shared by print-ip.c and print-frag6.c.
+ */
+
+#define IP_REASM_HDRMAX		60	/* largest header kept in front of a datagram */
+
+#define IP_REASM_DEFAULT_TIMEOUT	30		/* seconds */
+#define IP_REASM_DEFAULT_MEMORY		(4*1024*1024)	/* bytes */
+
+struct ip_reasm_key {
+	u_int8_t	af;		/* 4 or 6 */
+	u_int8_t	proto;		/* IP protocol / IPv6 next header */
+	u_int8_t	src[16];
+	u_int8_t	dst[16];
+	u_int32_t	id;
+};
+
+/*
+ * Add the payload of one fragment to the reassembly cache.
+ *
+ * "hdr"/"hdrlen" is the network-layer header to put in front of the
+ * reassembled payload; only the one supplied with the offset-0 fragment
+ * is kept.  The caller fixes up its length fields once the datagram is
+ * complete.
+ *
+ * Returns IP_REASM_COMPLETE and fills in *dgram and *dgramlen (header
+ * included) when this fragment completed the datagram; the buffer
+ * stays valid until ip_reasm_done() is called.
+ */
+#define IP_REASM_DROPPED	-1	/* fragment not kept (malformed or out of space) */
+#define IP_REASM_PENDING	0	/* kept, datagram still incomplete */
+#define IP_REASM_COMPLETE	1	/* datagram complete */
+
+extern int ip_reasm_add(netdissect_options *, const struct ip_reasm_key *,
+			u_int, int, const u_char *, u_int,
+			const u_char *, u_int,
+			u_char **, u_int *);
+extern void ip_reasm_done(netdissect_options *, u_char *);
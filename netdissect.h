@@ -128,6 +128,8 @@ struct netdissect_options {
   char *ndo_espsecret;
   struct sa_list *ndo_sa_list_head;  /* used by print-esp.c */
   struct sa_list *ndo_sa_default;
+  struct sa_list **ndo_sa_hash;	/* SAs by SPI and address, or by IKEv2 SPIs */
+  u_int ndo_esp_reload;		/* seconds between checks of -E files, 0 = never */
 
   char *ndo_sigsecret;     	/* Signature verification secret key */
 
@@ -136,6 +138,32 @@ struct netdissect_options {
 
   int   ndo_packettype;	/* as specified by -T */
 
+  struct scratch_chunk *ndo_scratch_head; /* scratch space, see scratch.h */
+  struct scratch_chunk *ndo_scratch;	/* chunk currently allocated from */
+
+  int   ndo_nested;		/* > 0 while printing a packet carried as
+				   data, e.g. quoted in an ICMP error, which
+				   must not update per-connection state */
+
+  int   ndo_reassemble;		/* reassemble IP fragments (-o reassemble) */
+  u_int ndo_frag_timeout;	/* seconds to keep an incomplete datagram */
+  u_int ndo_frag_memory;	/* bytes of reassembly buffer space */
+
+  int   ndo_summary;		/* summary modes (SUMMARY_ flags in summary.h) */
+  u_int ndo_summary_interval;	/* seconds between summary reports, 0 = at exit */
+  u_int ndo_summary_top;	/* entries per summary table, 0 = all */
+  u_int ndo_flow_max;		/* most flows tracked by -o flows */
+  int   ndo_tcp_analysis;	/* -o tcp-analysis */
+
+  u_int ndo_ike_cookies;	/* most IKE initiator cookies remembered */
+  u_int ndo_ike_timeout;	/* seconds an idle IKE cookie is kept */
+  u_int ndo_rx_calls;		/* most outstanding Rx calls remembered */
+  u_int ndo_rx_timeout;		/* seconds an Rx call is kept */
+  u_int ndo_dns_queries;	/* most outstanding DNS queries remembered */
+  u_int ndo_dns_timeout;	/* seconds a DNS query is kept */
+  int   ndo_rx_stats;		/* -o rx-stats */
+  int   ndo_bgp_counts;		/* -o bgp-counts */
+
   char *ndo_program_name;	/*used to generate self-identifying messages */
 
   int32_t ndo_thiszone;	/* seconds offset from gmt to local time */
@@ -146,6 +174,8 @@ struct netdissect_options {
   const u_char *ndo_packetp;
   const u_char *ndo_snapend;
 
+  struct timeval ndo_ts;	/* time stamp of the current packet */
+
   /* bookkeeping for ^T output */
   int ndo_infodelay;
 
@@ -322,10 +352,12 @@ extern const char *dnnum_string(netdissect_options *, u_short);
 
 typedef u_int (*if_ndo_printer)(struct netdissect_options *ndo,
 				const struct pcap_pkthdr *, const u_char *);
-typedef u_int (*if_printer)(const struct pcap_pkthdr *, const u_char *);
+
+/* A payload printer added at run time; see dissector.h. */
+typedef void (*dissector_func)(struct netdissect_options *ndo,
+			       const u_char *, u_int, const u_char *);
 
 extern if_ndo_printer lookup_ndo_printer(int);
-extern if_printer lookup_printer(int);
 
 extern void eap_print(netdissect_options *,const u_char *, u_int);
 extern int esp_print(netdissect_options *,
@@ -444,6 +476,34 @@ extern void lwapp_data_print(netdissect_options *, const u_char *, u_int);
 extern void pgm_print(netdissect_options *, const u_char *, u_int, const u_char *);
 extern void pptp_print(netdissect_options *, const u_char *);
 extern void ldp_print(netdissect_options *, const u_char *, u_int);
+extern u_int atm_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int sunatm_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int enc_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int ieee802_11_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int ieee802_11_radio_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int ieee802_11_radio_avs_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int prism_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int ltalk_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int ppp_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int ppp_hdlc_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int ppp_bsdos_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int sl_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int sl_bsdos_if_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_atm1_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_atm2_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_mfr_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_mlfr_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_mlppp_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_pppoe_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_pppoe_atm_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_ggsn_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_es_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_monitor_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_services_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_ether_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_ppp_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_frelay_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
+extern u_int juniper_chdlc_print(netdissect_options *, const struct pcap_pkthdr *, const u_char *);
 
 /* stuff that has not yet been rototiled */
 extern const u_char * ns_nprint (register const u_char *, register const u_char *);
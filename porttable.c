@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Port to printer tables; see porttable.h.
+ *
+ * Each slot holds the rank of the entry that gave it its printer in
+ * the high byte, so that of the two slots a segment looks up, the
+ * smaller rank wins.  Built-in entries are ranked from 1 in the order
+ * they are listed, and only fill slots that are still empty; ports set
+ * by the user are ranked 0 and always overwrite the slot.
+ */
+
+#define NETDISSECT_REWORKED
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <tcpdump-stdinc.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "interface.h"
+#include "porttable.h"
+
+#define PORT_RANK(v)	((v) >> 8)
+#define PORT_PRINTER(v)	((v) & 0xff)
+
+static struct port_table *port_tables[] = {
+	&udp_port_table,
+	&tcp_port_table,
+	NULL
+};
+
+static void
+port_table_build(struct port_table *pt)
+{
+	const struct port_entry *e;
+	u_int rank, port;
+	u_int16_t v;
+
+	for (e = pt->builtin, rank = 1; e->printer != 0; e++, rank++) {
+		if (rank > 0xff)
+			error("port_table_build: too many %s ports", pt->name);
+		v = (rank << 8) | e->printer;
+		for (port = e->lo; port <= e->hi; port++) {
+			if ((e->dir & PORT_SRC) && pt->src[port] == 0)
+				pt->src[port] = v;
+			if ((e->dir & PORT_DST) && pt->dst[port] == 0)
+				pt->dst[port] = v;
+		}
+	}
+	pt->built = 1;
+}
+
+u_int
+port_table_lookup(struct port_table *pt, u_int sport, u_int dport, int *dstp)
+{
+	u_int s, d;
+
+	if (!pt->built)
+		port_table_build(pt);
+	s = pt->src[sport];
+	d = pt->dst[dport];
+	if (s == 0 || (d != 0 && PORT_RANK(d) <= PORT_RANK(s))) {
+		if (dstp != NULL)
+			*dstp = 1;
+		return PORT_PRINTER(d);
+	}
+	if (dstp != NULL)
+		*dstp = 0;
+	return PORT_PRINTER(s);
+}
+
+struct port_table *
+port_table_find(const char *name)
+{
+	struct port_table **ptp;
+
+	for (ptp = port_tables; *ptp != NULL; ptp++)
+		if (strcasecmp(name, (*ptp)->name) == 0)
+			return *ptp;
+	return NULL;
+}
+
+u_int
+port_table_add(struct port_table *pt, const char *name, dissector_func f)
+{
+	u_int i;
+
+	for (i = 0; i < pt->ndynamic; i++)
+		if (strcasecmp(name, pt->dynamic_names[i]) == 0)
+			break;
+	if (i == pt->ndynamic) {
+		if (i == PORT_DYNAMIC_MAX)
+			error("port_table_add: too many %s printers", pt->name);
+		pt->dynamic_names[i] = strdup(name);
+		if (pt->dynamic_names[i] == NULL)
+			error("port_table_add: strdup");
+		pt->ndynamic++;
+	}
+	pt->dynamic[i] = f;
+	return PORT_DYNAMIC + i;
+}
+
+void
+port_table_set(struct port_table *pt, u_int lo, u_int hi, u_int printer)
+{
+	u_int port;
+
+	for (port = lo; port <= hi; port++)
+		pt->src[port] = pt->dst[port] = printer;
+}
+
+/*
+ * Read a ports file: each line has a protocol ("udp" or "tcp"), a port
+ * or a range of ports ("7000-7009") and the name of a printer, e.g.
+ *
+ *	udp 5300 dns
+ *
+ * '#' starts a comment.
+ */
+void
+port_table_load(const char *file)
+{
+	FILE *fp;
+	char line[256], proto[16], ports[32], name[64], extra, *p, *end;
+	struct port_table *pt;
+	const struct tok *t;
+	u_long lo, hi;
+	u_int lineno = 0, printer, i;
+	int n;
+
+	fp = fopen(file, "r");
+	if (fp == NULL)
+		error("can't open %s: %s", file, strerror(errno));
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineno++;
+		if ((p = strchr(line, '#')) != NULL)
+			*p = '\0';
+		n = sscanf(line, "%15s %31s %63s %c", proto, ports, name, &extra);
+		if (n <= 0)
+			continue;
+		if (n != 3)
+			error("%s:%u: expected protocol, port and printer",
+			    file, lineno);
+
+		pt = port_table_find(proto);
+		if (pt == NULL)
+			error("%s:%u: unknown protocol `%s'", file, lineno,
+			    proto);
+
+		lo = hi = strtoul(ports, &end, 10);
+		if (end != ports && *end == '-') {
+			p = end + 1;
+			hi = strtoul(p, &end, 10);
+			if (end == p)
+				end = ports;
+		}
+		if (end == ports || *end != '\0' || lo > hi || hi > 65535)
+			error("%s:%u: bad port `%s'", file, lineno, ports);
+
+		for (t = pt->printers; t->s != NULL; t++)
+			if (strcasecmp(name, t->s) == 0)
+				break;
+		if (t->s != NULL)
+			printer = t->v;
+		else {
+			for (i = 0; i < pt->ndynamic; i++)
+				if (strcasecmp(name, pt->dynamic_names[i]) == 0)
+					break;
+			if (i == pt->ndynamic)
+				error("%s:%u: unknown %s printer `%s'", file,
+				    lineno, pt->name, name);
+			printer = PORT_DYNAMIC + i;
+		}
+
+		port_table_set(pt, lo, hi, printer);
+	}
+	fclose(fp);
+}
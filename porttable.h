@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Port to printer tables for the transport protocols that pick the
+ * printer for their payload by port number.
+ *
+ * A protocol lists its built-in ports as port_entry structures, in
+ * order of precedence: when the source and destination ports both have
+ * a printer, the one listed first is used.  From the list, the first
+ * lookup builds one table indexed by source port and one indexed by
+ * destination port, so a lookup costs the same whether or not the
+ * ports are known.  Ports given with "-o ports=file", or added with
+ * port_table_set(), come before all of the built-in ones.
+ *
+ * Printers are small numbers chosen by the protocol, 0 meaning none;
+ * the names are used for the ports file.  Printers from PORT_DYNAMIC up
+ * are added at run time with port_table_add() and are called through
+ * port_table_dissector().
+ */
+
+#define PORT_SRC	0x1		/* entry is for the source port */
+#define PORT_DST	0x2		/* entry is for the destination port */
+#define PORT_ANY	(PORT_SRC|PORT_DST)
+
+#define PORT_DYNAMIC	0x80		/* first printer added at run time */
+#define PORT_DYNAMIC_MAX	(0x100 - PORT_DYNAMIC)
+
+struct port_entry {
+	u_int16_t	lo;		/* first port */
+	u_int16_t	hi;		/* last port */
+	u_int8_t	dir;		/* PORT_SRC, PORT_DST or PORT_ANY */
+	u_int8_t	printer;
+};
+
+struct port_table {
+	const char	*name;		/* protocol, as in the ports file */
+	const struct tok *printers;	/* printer names */
+	const struct port_entry *builtin; /* ends with printer 0 */
+	int		built;
+	u_int		ndynamic;	/* printers added at run time */
+	const char	*dynamic_names[PORT_DYNAMIC_MAX];
+	dissector_func	dynamic[PORT_DYNAMIC_MAX];
+	/* (rank << 8) | printer, rank 0 for ports set by the user */
+	u_int16_t	src[65536];
+	u_int16_t	dst[65536];
+};
+
+extern struct port_table udp_port_table;
+extern struct port_table tcp_port_table;
+
+/*
+ * Returns the printer for a segment from "sport" to "dport", or 0;
+ * if "dstp" isn't NULL, *dstp is set to 1 if the printer was picked
+ * by the destination port.
+ */
+extern u_int port_table_lookup(struct port_table *, u_int, u_int, int *);
+
+/* Makes ports "lo" to "hi", in either direction, use "printer" */
+extern void port_table_set(struct port_table *, u_int, u_int, u_int);
+
+/* Returns the table for "udp" or "tcp", or NULL */
+extern struct port_table *port_table_find(const char *);
+
+/* Adds a printer called "name" and returns its number */
+extern u_int port_table_add(struct port_table *, const char *, dissector_func);
+
+#define port_table_dissector(pt, printer) \
+	((pt)->dynamic[(printer) - PORT_DYNAMIC])
+
+extern void port_table_load(const char *);
@@ -27,6 +27,7 @@
 #include <tcpdump-stdinc.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "interface.h"
@@ -36,6 +37,7 @@
 #include "extract.h"
 
 #include "cpack.h"
+#include "scratch.h"
 
 
 /* Lengths of 802.11 header components. */
@@ -161,56 +163,17 @@ struct mgmt_header_t {
 #define	CAPABILITY_CFP_REQ(cap)	((cap) & 0x0008)
 #define	CAPABILITY_PRIVACY(cap)	((cap) & 0x0010)
 
-struct ssid_t {
-	u_int8_t	element_id;
-	u_int8_t	length;
-	u_char		ssid[33];  /* 32 + 1 for null */
-};
-
-struct rates_t {
-	u_int8_t	element_id;
-	u_int8_t	length;
-	u_int8_t	rate[16];
-};
-
-struct challenge_t {
-	u_int8_t	element_id;
-	u_int8_t	length;
-	u_int8_t	text[254]; /* 1-253 + 1 for null */
-};
-
-struct fh_t {
-	u_int8_t	element_id;
-	u_int8_t	length;
-	u_int16_t	dwell_time;
-	u_int8_t	hop_set;
-	u_int8_t 	hop_pattern;
-	u_int8_t	hop_index;
-};
-
-struct ds_t {
-	u_int8_t	element_id;
-	u_int8_t	length;
-	u_int8_t	channel;
-};
-
-struct cf_t {
-	u_int8_t	element_id;
-	u_int8_t	length;
-	u_int8_t	count;
-	u_int8_t	period;
-	u_int16_t	max_duration;
-	u_int16_t	dur_remaing;
-};
-
-struct tim_t {
-	u_int8_t	element_id;
-	u_int8_t	length;
-	u_int8_t	count;
-	u_int8_t	period;
-	u_int8_t	bitmap_control;
-	u_int8_t	bitmap[251];
-};
+/*
+ * Sizes of the elements parse_elements() keeps track of; the length
+ * octet of the elements with a variable size is checked against these.
+ */
+#define	E_SSID_MAXLEN		32
+#define	E_RATES_MAXLEN		16
+#define	E_CHALLENGE_MAXLEN	253
+#define	E_DS_SIZE		3	/* ID, length, channel */
+#define	E_CF_SIZE		8	/* ID, length, count, period, durations */
+#define	E_TIM_MINSIZE		5	/* ID, length, count, period, control */
+#define	E_TIM_MAXBITMAP		251
 
 #define	E_SSID 		0
 #define	E_RATES 	1
@@ -248,23 +211,23 @@ struct mgmt_body_t {
 	u_int16_t	reason_code;
 	u_int16_t	auth_alg;
 	u_int16_t	auth_trans_seq_num;
-	int		challenge_present;
-	struct challenge_t  challenge;
 	u_int16_t	capability_info;
-	int		ssid_present;
-	struct ssid_t	ssid;
-	int		rates_present;
-	struct rates_t 	rates;
-	int		ds_present;
-	struct ds_t	ds;
-	int		cf_present;
-	struct cf_t	cf;
-	int		fh_present;
-	struct fh_t	fh;
-	int		tim_present;
-	struct tim_t	tim;
+	/*
+	 * The first element of each kind, or NULL; they point into the
+	 * frame, and are decoded only if they're printed.
+	 */
+	const u_char	*challenge;
+	const u_char	*ssid;
+	const u_char	*rates;		/* the first one that isn't empty */
+	const u_char	*ds;
+	const u_char	*cf;
+	const u_char	*tim;
 };
 
+/* Parts of an element pointed to by a mgmt_body_t */
+#define	E_LENGTH(e)	((e)[1])
+#define	E_BODY(e)	((e) + 2)
+
 struct ctrl_rts_t {
 	u_int16_t	fc;
 	u_int16_t	duration;
@@ -668,30 +631,29 @@ struct radiotap_state
 };
 
 #define PRINT_SSID(p) \
-	if (p.ssid_present) { \
+	if (p.ssid != NULL) { \
 		printf(" ("); \
-		fn_print(p.ssid.ssid, NULL); \
+		fn_printzp(E_BODY(p.ssid), E_LENGTH(p.ssid), NULL); \
 		printf(")"); \
 	}
 
 #define PRINT_RATE(_sep, _r, _suf) \
 	printf("%s%2.1f%s", _sep, (.5 * ((_r) & 0x7f)), _suf)
 #define PRINT_RATES(p) \
-	if (p.rates_present) { \
+	if (p.rates != NULL) { \
 		int z; \
 		const char *sep = " ["; \
-		for (z = 0; z < p.rates.length ; z++) { \
-			PRINT_RATE(sep, p.rates.rate[z], \
-				(p.rates.rate[z] & 0x80 ? "*" : "")); \
+		for (z = 0; z < E_LENGTH(p.rates); z++) { \
+			PRINT_RATE(sep, E_BODY(p.rates)[z], \
+				(E_BODY(p.rates)[z] & 0x80 ? "*" : "")); \
 			sep = " "; \
 		} \
-		if (p.rates.length != 0) \
-			printf(" Mbit]"); \
+		printf(" Mbit]"); \
 	}
 
 #define PRINT_DS_CHANNEL(p) \
-	if (p.ds_present) \
-		printf(" CH: %u", p.ds.channel); \
+	if (p.ds != NULL) \
+		printf(" CH: %u", E_BODY(p.ds)[0]); \
 	printf("%s", \
 	    CAPABILITY_PRIVACY(p.capability_info) ? ", PRIVACY" : "" );
 
@@ -1263,236 +1225,124 @@ wep_print(const u_char *p)
 	return 1;
 }
 
+/*
+ * Check the elements from "offset" on, and note where the first one of
+ * each kind that we know of is.  Returns 0 if the elements are
+ * truncated or one of them is too long.
+ */
 static int
 parse_elements(struct mgmt_body_t *pbody, const u_char *p, int offset,
     u_int length)
 {
-	u_int elementlen;
-	struct ssid_t ssid;
-	struct challenge_t challenge;
-	struct rates_t rates;
-	struct ds_t ds;
-	struct cf_t cf;
-	struct tim_t tim;
+	const u_char *e;
+	u_int elementlen, size;
 
 	/*
 	 * We haven't seen any elements yet.
 	 */
-	pbody->challenge_present = 0;
-	pbody->ssid_present = 0;
-	pbody->rates_present = 0;
-	pbody->ds_present = 0;
-	pbody->cf_present = 0;
-	pbody->tim_present = 0;
+	pbody->challenge = NULL;
+	pbody->ssid = NULL;
+	pbody->rates = NULL;
+	pbody->ds = NULL;
+	pbody->cf = NULL;
+	pbody->tim = NULL;
 
 	while (length != 0) {
-		if (!TTEST2(*(p + offset), 1))
+		e = p + offset;
+		if (!TTEST2(*e, 2))
 			return 0;
-		if (length < 1)
+		if (length < 2)
 			return 0;
-		switch (*(p + offset)) {
+		elementlen = E_LENGTH(e);
+
+		/*
+		 * Work out how much of the frame the element takes up.
+		 * The DS and CF elements are taken to have their usual
+		 * size, and the TIM element at least the size of its
+		 * fixed fields, whatever their length octet says.
+		 */
+		switch (e[0]) {
 		case E_SSID:
-			if (!TTEST2(*(p + offset), 2))
-				return 0;
-			if (length < 2)
+			if (elementlen > E_SSID_MAXLEN)
 				return 0;
-			memcpy(&ssid, p + offset, 2);
-			offset += 2;
-			length -= 2;
-			if (ssid.length != 0) {
-				if (ssid.length > sizeof(ssid.ssid) - 1)
-					return 0;
-				if (!TTEST2(*(p + offset), ssid.length))
-					return 0;
-				if (length < ssid.length)
-					return 0;
-				memcpy(&ssid.ssid, p + offset, ssid.length);
-				offset += ssid.length;
-				length -= ssid.length;
-			}
-			ssid.ssid[ssid.length] = '\0';
-			/*
-			 * Present and not truncated.
-			 *
-			 * If we haven't already seen an SSID IE,
-			 * copy this one, otherwise ignore this one,
-			 * so we later report the first one we saw.
-			 */
-			if (!pbody->ssid_present) {
-				pbody->ssid = ssid;
-				pbody->ssid_present = 1;
-			}
+			size = 2 + elementlen;
 			break;
 		case E_CHALLENGE:
-			if (!TTEST2(*(p + offset), 2))
-				return 0;
-			if (length < 2)
+			if (elementlen > E_CHALLENGE_MAXLEN)
 				return 0;
-			memcpy(&challenge, p + offset, 2);
-			offset += 2;
-			length -= 2;
-			if (challenge.length != 0) {
-				if (challenge.length >
-				    sizeof(challenge.text) - 1)
-					return 0;
-				if (!TTEST2(*(p + offset), challenge.length))
-					return 0;
-				if (length < challenge.length)
-					return 0;
-				memcpy(&challenge.text, p + offset,
-				    challenge.length);
-				offset += challenge.length;
-				length -= challenge.length;
-			}
-			challenge.text[challenge.length] = '\0';
-			/*
-			 * Present and not truncated.
-			 *
-			 * If we haven't already seen a challenge IE,
-			 * copy this one, otherwise ignore this one,
-			 * so we later report the first one we saw.
-			 */
-			if (!pbody->challenge_present) {
-				pbody->challenge = challenge;
-				pbody->challenge_present = 1;
-			}
+			size = 2 + elementlen;
 			break;
 		case E_RATES:
-			if (!TTEST2(*(p + offset), 2))
-				return 0;
-			if (length < 2)
+			if (elementlen > E_RATES_MAXLEN)
 				return 0;
-			memcpy(&rates, p + offset, 2);
-			offset += 2;
-			length -= 2;
-			if (rates.length != 0) {
-				if (rates.length > sizeof rates.rate)
-					return 0;
-				if (!TTEST2(*(p + offset), rates.length))
-					return 0;
-				if (length < rates.length)
-					return 0;
-				memcpy(&rates.rate, p + offset, rates.length);
-				offset += rates.length;
-				length -= rates.length;
-			}
-			/*
-			 * Present and not truncated.
-			 *
-			 * If we haven't already seen a rates IE,
-			 * copy this one if it's not zero-length,
-			 * otherwise ignore this one, so we later
-			 * report the first one we saw.
-			 *
-			 * We ignore zero-length rates IEs as some
-			 * devices seem to put a zero-length rates
-			 * IE, followed by an SSID IE, followed by
-			 * a non-zero-length rates IE into frames,
-			 * even though IEEE Std 802.11-2007 doesn't
-			 * seem to indicate that a zero-length rates
-			 * IE is valid.
-			 */
-			if (!pbody->rates_present && rates.length != 0) {
-				pbody->rates = rates;
-				pbody->rates_present = 1;
-			}
+			size = 2 + elementlen;
 			break;
 		case E_DS:
-			if (!TTEST2(*(p + offset), 3))
-				return 0;
-			if (length < 3)
-				return 0;
-			memcpy(&ds, p + offset, 3);
-			offset += 3;
-			length -= 3;
-			/*
-			 * Present and not truncated.
-			 *
-			 * If we haven't already seen a DS IE,
-			 * copy this one, otherwise ignore this one,
-			 * so we later report the first one we saw.
-			 */
-			if (!pbody->ds_present) {
-				pbody->ds = ds;
-				pbody->ds_present = 1;
-			}
+			size = E_DS_SIZE;
 			break;
 		case E_CF:
-			if (!TTEST2(*(p + offset), 8))
-				return 0;
-			if (length < 8)
-				return 0;
-			memcpy(&cf, p + offset, 8);
-			offset += 8;
-			length -= 8;
-			/*
-			 * Present and not truncated.
-			 *
-			 * If we haven't already seen a CF IE,
-			 * copy this one, otherwise ignore this one,
-			 * so we later report the first one we saw.
-			 */
-			if (!pbody->cf_present) {
-				pbody->cf = cf;
-				pbody->cf_present = 1;
-			}
+			size = E_CF_SIZE;
 			break;
 		case E_TIM:
-			if (!TTEST2(*(p + offset), 2))
-				return 0;
-			if (length < 2)
-				return 0;
-			memcpy(&tim, p + offset, 2);
-			offset += 2;
-			length -= 2;
-			if (!TTEST2(*(p + offset), 3))
-				return 0;
-			if (length < 3)
-				return 0;
-			memcpy(&tim.count, p + offset, 3);
-			offset += 3;
-			length -= 3;
-
-			if (tim.length <= 3)
-				break;
-			if (tim.length - 3 > (int)sizeof tim.bitmap)
-				return 0;
-			if (!TTEST2(*(p + offset), tim.length - 3))
-				return 0;
-			if (length < (u_int)(tim.length - 3))
-				return 0;
-			memcpy(tim.bitmap, p + (tim.length - 3),
-			    (tim.length - 3));
-			offset += tim.length - 3;
-			length -= tim.length - 3;
-			/*
-			 * Present and not truncated.
-			 *
-			 * If we haven't already seen a TIM IE,
-			 * copy this one, otherwise ignore this one,
-			 * so we later report the first one we saw.
-			 */
-			if (!pbody->tim_present) {
-				pbody->tim = tim;
-				pbody->tim_present = 1;
+			size = E_TIM_MINSIZE;
+			if (elementlen > 3) {
+				if (elementlen - 3 > E_TIM_MAXBITMAP)
+					return 0;
+				size += elementlen - 3;
 			}
 			break;
 		default:
 #if 0
-			printf("(1) unhandled element_id (%d)  ",
-			    *(p + offset));
+			printf("(1) unhandled element_id (%d)  ", e[0]);
 #endif
-			if (!TTEST2(*(p + offset), 2))
-				return 0;
-			if (length < 2)
-				return 0;
-			elementlen = *(p + offset + 1);
-			if (!TTEST2(*(p + offset + 2), elementlen))
-				return 0;
-			if (length < elementlen + 2)
-				return 0;
-			offset += elementlen + 2;
-			length -= elementlen + 2;
+			size = 2 + elementlen;
+			break;
+		}
+		if (!TTEST2(*e, size))
+			return 0;
+		if (length < size)
+			return 0;
+		offset += size;
+		length -= size;
+
+		/*
+		 * Present and not truncated.
+		 *
+		 * If we haven't already seen an element of this kind,
+		 * note this one, otherwise ignore it, so we later
+		 * report the first one we saw.
+		 *
+		 * We ignore zero-length rates IEs as some devices seem
+		 * to put a zero-length rates IE, followed by an SSID
+		 * IE, followed by a non-zero-length rates IE into
+		 * frames, even though IEEE Std 802.11-2007 doesn't seem
+		 * to indicate that a zero-length rates IE is valid.
+		 */
+		switch (e[0]) {
+		case E_SSID:
+			if (pbody->ssid == NULL)
+				pbody->ssid = e;
+			break;
+		case E_CHALLENGE:
+			if (pbody->challenge == NULL)
+				pbody->challenge = e;
+			break;
+		case E_RATES:
+			if (pbody->rates == NULL && elementlen != 0)
+				pbody->rates = e;
+			break;
+		case E_DS:
+			if (pbody->ds == NULL)
+				pbody->ds = e;
+			break;
+		case E_CF:
+			if (pbody->cf == NULL)
+				pbody->cf = e;
+			break;
+		case E_TIM:
+			/* only a TIM element with a bitmap is noted */
+			if (pbody->tim == NULL && elementlen > 3)
+				pbody->tim = e;
 			break;
 		}
 	}
@@ -2424,7 +2274,8 @@ ieee802_11_print(const u_char *p, u_int length, u_int orig_caplen, int pad,
  * is the number of bytes actually captured.
  */
 u_int
-ieee802_11_if_print(const struct pcap_pkthdr *h, const u_char *p)
+ieee802_11_if_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, const u_char *p)
 {
 	return ieee802_11_print(p, h->len, h->caplen, 0, 0);
 }
@@ -2487,95 +2338,115 @@ print_chaninfo(int freq, int flags)
 	printf(" ");
 }
 
+/*
+ * How a frame's radiotap fields are laid out.  The layout depends only
+ * on the header length, the number of presence bitmaps and the first
+ * bitmap: bit 31 of that bitmap (more bitmaps follow) isn't a field we
+ * know the size of, so we never get to the fields of the others.  As
+ * monitor-mode captures tend to repeat a few of those, layouts are
+ * kept, unless a vendor namespace field makes the offsets of the
+ * fields after it depend on the frame.
+ */
+#define RADIOTAP_FIELD		0	/* field at "offset" */
+#define RADIOTAP_UNKNOWN	1	/* bit we can't go past */
+#define RADIOTAP_TRUNC		2	/* field runs off the end of the header */
+#define RADIOTAP_VENDOR		3	/* vendor namespace, skipped */
+
+struct radiotap_step {
+	u_int16_t	offset;		/* from the start of the header */
+	u_int8_t	bit;
+	u_int8_t	kind;
+};
+
+struct radiotap_layout {
+	u_int32_t	present;	/* first presence bitmap */
+	u_int16_t	len;		/* it_len */
+	u_int16_t	nbitmaps;
+	int		cacheable;
+	u_int		nsteps;
+	struct radiotap_step steps[32];
+};
+
+#define RADIOTAP_LAYOUTS	8
+
+static struct radiotap_layout radiotap_layouts[RADIOTAP_LAYOUTS];
+static u_int radiotap_nlayouts, radiotap_nextlayout;
+
+/*
+ * Reads field "bit" the way the field is laid out, setting *offp to
+ * where it starts; returns the RADIOTAP_ kind of the step.
+ */
 static int
-print_radiotap_field(struct cpack_state *s, u_int32_t bit, u_int8_t *flags,
-						struct radiotap_state *state, u_int32_t presentflags)
+radiotap_field_offset(struct cpack_state *s, u_int32_t bit, u_int *offp)
 {
-	union {
-		int8_t		i8;
-		u_int8_t	u8;
-		int16_t		i16;
-		u_int16_t	u16;
-		u_int32_t	u32;
-		u_int64_t	u64;
-	} u, u2, u3, u4;
+	u_int8_t u8;
+	u_int16_t u16;
+	u_int32_t u32;
+	u_int64_t u64;
+	u_int size;
 	int rc;
 
 	switch (bit) {
 	case IEEE80211_RADIOTAP_FLAGS:
-		rc = cpack_uint8(s, &u.u8);
-		if (rc != 0)
-			break;
-		*flags = u.u8;
-		break;
 	case IEEE80211_RADIOTAP_RATE:
-		rc = cpack_uint8(s, &u.u8);
-		if (rc != 0)
-			break;
-
-		/* Save state rate */
-		state->rate = u.u8;
-		break;
 	case IEEE80211_RADIOTAP_DB_ANTSIGNAL:
 	case IEEE80211_RADIOTAP_DB_ANTNOISE:
 	case IEEE80211_RADIOTAP_ANTENNA:
-		rc = cpack_uint8(s, &u.u8);
-		break;
 	case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
 	case IEEE80211_RADIOTAP_DBM_ANTNOISE:
-		rc = cpack_int8(s, &u.i8);
+	case IEEE80211_RADIOTAP_DB_TX_ATTENUATION:
+	case IEEE80211_RADIOTAP_DBM_TX_POWER:
+		rc = cpack_uint8(s, &u8);
+		size = 1;
 		break;
 	case IEEE80211_RADIOTAP_CHANNEL:
-		rc = cpack_uint16(s, &u.u16);
+		rc = cpack_uint16(s, &u16);
 		if (rc != 0)
 			break;
-		rc = cpack_uint16(s, &u2.u16);
+		rc = cpack_uint16(s, &u16);
+		size = 4;
 		break;
 	case IEEE80211_RADIOTAP_FHSS:
 	case IEEE80211_RADIOTAP_LOCK_QUALITY:
 	case IEEE80211_RADIOTAP_TX_ATTENUATION:
 	case IEEE80211_RADIOTAP_RX_FLAGS:
-		rc = cpack_uint16(s, &u.u16);
-		break;
-	case IEEE80211_RADIOTAP_DB_TX_ATTENUATION:
-		rc = cpack_uint8(s, &u.u8);
-		break;
-	case IEEE80211_RADIOTAP_DBM_TX_POWER:
-		rc = cpack_int8(s, &u.i8);
+		rc = cpack_uint16(s, &u16);
+		size = 2;
 		break;
 	case IEEE80211_RADIOTAP_TSFT:
-		rc = cpack_uint64(s, &u.u64);
+		rc = cpack_uint64(s, &u64);
+		size = 8;
 		break;
 	case IEEE80211_RADIOTAP_XCHANNEL:
-		rc = cpack_uint32(s, &u.u32);
+		rc = cpack_uint32(s, &u32);
 		if (rc != 0)
 			break;
-		rc = cpack_uint16(s, &u2.u16);
+		rc = cpack_uint16(s, &u16);
 		if (rc != 0)
 			break;
-		rc = cpack_uint8(s, &u3.u8);
+		rc = cpack_uint8(s, &u8);
 		if (rc != 0)
 			break;
-		rc = cpack_uint8(s, &u4.u8);
+		rc = cpack_uint8(s, &u8);
+		size = 8;
 		break;
 	case IEEE80211_RADIOTAP_MCS:
-		rc = cpack_uint8(s, &u.u8);
+		rc = cpack_uint8(s, &u8);
 		if (rc != 0)
 			break;
-		rc = cpack_uint8(s, &u2.u8);
+		rc = cpack_uint8(s, &u8);
 		if (rc != 0)
 			break;
-		rc = cpack_uint8(s, &u3.u8);
+		rc = cpack_uint8(s, &u8);
+		size = 3;
 		break;
 	case IEEE80211_RADIOTAP_VENDOR_NAMESPACE: {
 		u_int8_t vns[3];
 		u_int16_t length;
 		u_int8_t subspace;
 
-		if ((cpack_align_and_reserve(s, 2)) == NULL) {
-			rc = -1;
-			break;
-		}
+		if ((cpack_align_and_reserve(s, 2)) == NULL)
+			return RADIOTAP_TRUNC;
 
 		rc = cpack_uint8(s, &vns[0]);
 		if (rc != 0)
@@ -2595,20 +2466,158 @@ print_radiotap_field(struct cpack_state *s, u_int32_t bit, u_int8_t *flags,
 
 		/* Skip up to length */
 		s->c_next += length;
-		break;
+		return RADIOTAP_VENDOR;
 	}
 	default:
 		/* this bit indicates a field whose
 		 * size we do not know, so we cannot
-		 * proceed.  Just print the bit number.
+		 * proceed.
 		 */
-		printf("[bit %u] ", bit);
-		return -1;
+		return RADIOTAP_UNKNOWN;
 	}
 
-	if (rc != 0) {
-		printf("%s", tstr);
-		return rc;
+	if (rc != 0)
+		return RADIOTAP_TRUNC;
+	*offp = s->c_next - s->c_buf - size;
+	return RADIOTAP_FIELD;
+}
+
+static void
+radiotap_layout_build(struct radiotap_layout *l, const u_char *p,
+		      u_int len, u_int nbitmaps, u_int32_t present)
+{
+#define	BITNO_32(x) (((x) >> 16) ? 16 + BITNO_16((x) >> 16) : BITNO_16((x)))
+#define	BITNO_16(x) (((x) >> 8) ? 8 + BITNO_8((x) >> 8) : BITNO_8((x)))
+#define	BITNO_8(x) (((x) >> 4) ? 4 + BITNO_4((x) >> 4) : BITNO_4((x)))
+#define	BITNO_4(x) (((x) >> 2) ? 2 + BITNO_2((x) >> 2) : BITNO_2((x)))
+#define	BITNO_2(x) (((x) & 2) ? 1 : 0)
+	struct cpack_state cpacker;
+	struct radiotap_step *step;
+	u_int32_t bits, next_bits;
+	u_int i, bit, off;
+	int kind;
+
+	l->present = present;
+	l->len = len;
+	l->nbitmaps = nbitmaps;
+	l->cacheable = 1;
+	l->nsteps = 0;
+
+	cpack_init(&cpacker, (u_int8_t *)p, len); /* align against header start */
+	cpack_advance(&cpacker, sizeof(struct ieee80211_radiotap_header)); /* includes the 1st bitmap */
+	for (i = 1; i < nbitmaps; i++)
+		cpack_advance(&cpacker, sizeof(u_int32_t)); /* more bitmaps */
+
+	for (bits = present; bits; bits = next_bits) {
+		/* clear the least significant bit that is set */
+		next_bits = bits & (bits - 1);
+
+		/* extract the least significant bit that is set */
+		bit = BITNO_32(bits ^ next_bits);
+
+		off = 0;
+		kind = radiotap_field_offset(&cpacker, bit, &off);
+		if (kind == RADIOTAP_VENDOR) {
+			l->cacheable = 0;
+			continue;
+		}
+		step = &l->steps[l->nsteps++];
+		step->offset = off;
+		step->bit = bit;
+		step->kind = kind;
+		if (kind != RADIOTAP_FIELD)
+			break;
+	}
+#undef BITNO_32
+#undef BITNO_16
+#undef BITNO_8
+#undef BITNO_4
+#undef BITNO_2
+}
+
+static const struct radiotap_layout *
+radiotap_layout_get(struct radiotap_layout *tmp, const u_char *p,
+		    u_int len, u_int nbitmaps, u_int32_t present)
+{
+	struct radiotap_layout *l;
+	u_int i;
+
+	for (i = 0; i < radiotap_nlayouts; i++) {
+		l = &radiotap_layouts[i];
+		if (l->present == present && l->len == len &&
+		    l->nbitmaps == nbitmaps)
+			return l;
+	}
+	radiotap_layout_build(tmp, p, len, nbitmaps, present);
+	if (!tmp->cacheable)
+		return tmp;
+	l = &radiotap_layouts[radiotap_nextlayout];
+	radiotap_nextlayout = (radiotap_nextlayout + 1) % RADIOTAP_LAYOUTS;
+	if (radiotap_nlayouts < RADIOTAP_LAYOUTS)
+		radiotap_nlayouts++;
+	*l = *tmp;
+	return l;
+}
+
+static void
+print_radiotap_field(const u_char *f, u_int32_t bit, u_int8_t *flags,
+						struct radiotap_state *state, u_int32_t presentflags)
+{
+	union {
+		int8_t		i8;
+		u_int8_t	u8;
+		int16_t		i16;
+		u_int16_t	u16;
+		u_int32_t	u32;
+		u_int64_t	u64;
+	} u, u2, u3, u4;
+
+	switch (bit) {
+	case IEEE80211_RADIOTAP_FLAGS:
+		u.u8 = f[0];
+		*flags = u.u8;
+		break;
+	case IEEE80211_RADIOTAP_RATE:
+		u.u8 = f[0];
+
+		/* Save state rate */
+		state->rate = u.u8;
+		break;
+	case IEEE80211_RADIOTAP_DB_ANTSIGNAL:
+	case IEEE80211_RADIOTAP_DB_ANTNOISE:
+	case IEEE80211_RADIOTAP_ANTENNA:
+	case IEEE80211_RADIOTAP_DB_TX_ATTENUATION:
+		u.u8 = f[0];
+		break;
+	case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
+	case IEEE80211_RADIOTAP_DBM_ANTNOISE:
+	case IEEE80211_RADIOTAP_DBM_TX_POWER:
+		u.i8 = (int8_t)f[0];
+		break;
+	case IEEE80211_RADIOTAP_CHANNEL:
+		u.u16 = EXTRACT_LE_16BITS(f);
+		u2.u16 = EXTRACT_LE_16BITS(f + 2);
+		break;
+	case IEEE80211_RADIOTAP_FHSS:
+	case IEEE80211_RADIOTAP_LOCK_QUALITY:
+	case IEEE80211_RADIOTAP_TX_ATTENUATION:
+	case IEEE80211_RADIOTAP_RX_FLAGS:
+		u.u16 = EXTRACT_LE_16BITS(f);
+		break;
+	case IEEE80211_RADIOTAP_TSFT:
+		u.u64 = EXTRACT_LE_64BITS(f);
+		break;
+	case IEEE80211_RADIOTAP_XCHANNEL:
+		u.u32 = EXTRACT_LE_32BITS(f);
+		u2.u16 = EXTRACT_LE_16BITS(f + 4);
+		u3.u8 = f[6];
+		u4.u8 = f[7];
+		break;
+	case IEEE80211_RADIOTAP_MCS:
+		u.u8 = f[0];
+		u2.u8 = f[1];
+		u3.u8 = f[2];
+		break;
 	}
 
 	/* Preserve the state present flags */
@@ -2801,28 +2810,43 @@ print_radiotap_field(struct cpack_state *s, u_int32_t bit, u_int8_t *flags,
 		break;
 		}
 	}
-	return 0;
 }
 
+/*
+ * Returns the number of presence bitmaps in the radiotap header "p" of
+ * "len" bytes, or 0 if the last one that fits says there's another.
+ */
 static u_int
-ieee802_11_radio_print(const u_char *p, u_int length, u_int caplen)
+radiotap_bitmaps(const u_char *p, u_int len)
 {
-#define	BITNO_32(x) (((x) >> 16) ? 16 + BITNO_16((x) >> 16) : BITNO_16((x)))
-#define	BITNO_16(x) (((x) >> 8) ? 8 + BITNO_8((x) >> 8) : BITNO_8((x)))
-#define	BITNO_8(x) (((x) >> 4) ? 4 + BITNO_4((x) >> 4) : BITNO_4((x)))
-#define	BITNO_4(x) (((x) >> 2) ? 2 + BITNO_2((x) >> 2) : BITNO_2((x)))
-#define	BITNO_2(x) (((x) & 2) ? 1 : 0)
-#define	BIT(n)	(1U << n)
 #define	IS_EXTENDED(__p)	\
-	    (EXTRACT_LE_32BITS(__p) & BIT(IEEE80211_RADIOTAP_EXT)) != 0
+	    (EXTRACT_LE_32BITS(__p) & (1U << IEEE80211_RADIOTAP_EXT)) != 0
+	const struct ieee80211_radiotap_header *hdr;
+	const u_int32_t *last_presentp;
 
-	struct cpack_state cpacker;
+	hdr = (const struct ieee80211_radiotap_header *)p;
+	for (last_presentp = &hdr->it_present;
+	     IS_EXTENDED(last_presentp) &&
+	     (const u_char *)(last_presentp + 1) <= p + len;
+	     last_presentp++)
+		continue;
+
+	/* are there more bitmap extensions than bytes in header? */
+	if (IS_EXTENDED(last_presentp))
+		return 0;
+	return last_presentp - &hdr->it_present + 1;
+#undef IS_EXTENDED
+}
+
+static u_int
+ieee802_11_radio_print(const u_char *p, u_int length, u_int caplen)
+{
 	struct ieee80211_radiotap_header *hdr;
-	u_int32_t present, next_present;
-	u_int32_t presentflags = 0;
-	u_int32_t *presentp, *last_presentp;
-	enum ieee80211_radiotap_type bit;
-	int bit0;
+	u_int32_t presentflags;
+	struct radiotap_layout tmp;
+	const struct radiotap_layout *l;
+	const struct radiotap_step *step;
+	u_int i, nbitmaps;
 	u_int len;
 	u_int8_t flags;
 	int pad;
@@ -2842,16 +2866,8 @@ ieee802_11_radio_print(const u_char *p, u_int length, u_int caplen)
 		printf("%s", tstr);
 		return caplen;
 	}
-	cpack_init(&cpacker, (u_int8_t *)hdr, len); /* align against header start */
-	cpack_advance(&cpacker, sizeof(*hdr)); /* includes the 1st bitmap */
-	for (last_presentp = &hdr->it_present;
-	     IS_EXTENDED(last_presentp) &&
-	     (u_char*)(last_presentp + 1) <= p + len;
-	     last_presentp++)
-	  cpack_advance(&cpacker, sizeof(hdr->it_present)); /* more bitmaps */
-
-	/* are there more bitmap extensions than bytes in header? */
-	if (IS_EXTENDED(last_presentp)) {
+	nbitmaps = radiotap_bitmaps(p, len);
+	if (nbitmaps == 0) {
 		printf("%s", tstr);
 		return caplen;
 	}
@@ -2862,40 +2878,33 @@ ieee802_11_radio_print(const u_char *p, u_int length, u_int caplen)
 	pad = 0;
 	/* Assume no FCS at end of frame */
 	fcslen = 0;
-	for (bit0 = 0, presentp = &hdr->it_present; presentp <= last_presentp;
-	     presentp++, bit0 += 32) {
-		presentflags = EXTRACT_LE_32BITS(presentp);
-
-		/* Clear state. */
-		memset(&state, 0, sizeof(state));
 
-		for (present = EXTRACT_LE_32BITS(presentp); present;
-		     present = next_present) {
-			/* clear the least significant bit that is set */
-			next_present = present & (present - 1);
+	presentflags = EXTRACT_LE_32BITS(&hdr->it_present);
+	l = radiotap_layout_get(&tmp, p, len, nbitmaps, presentflags);
 
-			/* extract the least significant bit that is set */
-			bit = (enum ieee80211_radiotap_type)
-			    (bit0 + BITNO_32(present ^ next_present));
+	/* Clear state. */
+	memset(&state, 0, sizeof(state));
 
-			if (print_radiotap_field(&cpacker, bit, &flags, &state, presentflags) != 0)
-				goto out;
+	for (i = 0, step = l->steps; i < l->nsteps; i++, step++) {
+		if (step->kind == RADIOTAP_UNKNOWN) {
+			/* Just print the bit number. */
+			printf("[bit %u] ", step->bit);
+			break;
+		}
+		if (step->kind == RADIOTAP_TRUNC) {
+			printf("%s", tstr);
+			break;
 		}
+		print_radiotap_field(p + step->offset, step->bit, &flags,
+		    &state, presentflags);
 	}
 
-out:
 	if (flags & IEEE80211_RADIOTAP_F_DATAPAD)
 		pad = 1;	/* Atheros padding */
 	if (flags & IEEE80211_RADIOTAP_F_FCS)
 		fcslen = 4;	/* FCS at end of packet */
 	return len + ieee802_11_print(p + len, length - len, caplen - len, pad,
 	    fcslen);
-#undef BITNO_32
-#undef BITNO_16
-#undef BITNO_8
-#undef BITNO_4
-#undef BITNO_2
-#undef BIT
 }
 
 static u_int
@@ -2928,6 +2937,536 @@ ieee802_11_avs_radio_print(const u_char *p, u_int length, u_int caplen)
 	    length - caphdr_len, caplen - caphdr_len, 0, 0);
 }
 
+/*
+ * Statistics for "-o wlan-stats": instead of printing frames, count
+ * them per BSS and per transmitting station, with the rates, signal
+ * levels and retries seen and an estimate of the time each spent on
+ * the air, from the radiotap header if there is one.
+ */
+struct wlan_radio {
+	u_int8_t	flags;		/* IEEE80211_RADIOTAP_F_ */
+	u_int8_t	rate;		/* in 500 kb/s units, 0 if not known */
+	int		mcs;		/* -1 if not known */
+	float		htrate;		/* Mb/s for "mcs", 0 if not known */
+	int		sgi;		/* short guard interval */
+	int		has_signal;
+	int		signal;		/* dBm */
+};
+
+struct wlan_node {
+	struct wlan_node *next;
+	u_int8_t	addr[6];
+	u_int8_t	bssid[6];	/* station: BSS it was last seen in */
+	int		has_bssid;
+	u_char		ssid[33];	/* BSS: from beacons and probe responses */
+	u_int		channel;	/* BSS: from the DS parameter set */
+	u_int64_t	frames;
+	u_int64_t	beacons;
+	u_int64_t	data;
+	u_int64_t	retries;
+	u_int64_t	bytes;
+	u_int64_t	airtime;	/* microseconds */
+	u_int64_t	signal_frames;
+	int64_t		signal_sum;
+	int		signal_min;
+	int		signal_max;
+};
+
+#define WLAN_HASHSIZE		256
+#define WLAN_NODE_MAX		65536	/* BSSes and stations tracked */
+#define WLAN_SIGNAL_BUCKETS	10	/* of 10 dB, from -100 dBm */
+
+static struct wlan_node		*wlan_bsses[WLAN_HASHSIZE];
+static struct wlan_node		*wlan_stations[WLAN_HASHSIZE];
+static u_int			wlan_bss_count, wlan_station_count;
+static u_int64_t		wlan_frames, wlan_types[4], wlan_retries;
+static u_int64_t		wlan_bytes, wlan_airtime, wlan_badfcs;
+static u_int64_t		wlan_truncated, wlan_untracked;
+static u_int64_t		wlan_rates[256], wlan_mcs[MAX_MCS_INDEX + 1];
+static u_int64_t		wlan_norate;
+static u_int64_t		wlan_signal[WLAN_SIGNAL_BUCKETS];
+static struct timeval		wlan_first, wlan_last;
+
+/*
+ * Fills in "r" from the radiotap header "p"; returns the length of
+ * the header, or 0 if it's truncated.
+ */
+static u_int
+wlan_radio_info(const u_char *p, u_int caplen, struct wlan_radio *r)
+{
+	const struct ieee80211_radiotap_header *hdr;
+	struct radiotap_layout tmp;
+	const struct radiotap_layout *l;
+	const struct radiotap_step *step;
+	const u_char *f;
+	u_int i, len, nbitmaps;
+	int bw40 = 0;
+
+	if (caplen < sizeof(*hdr))
+		return 0;
+	hdr = (const struct ieee80211_radiotap_header *)p;
+	len = EXTRACT_LE_16BITS(&hdr->it_len);
+	if (caplen < len || len < sizeof(*hdr))
+		return 0;
+	nbitmaps = radiotap_bitmaps(p, len);
+	if (nbitmaps == 0)
+		return 0;
+	l = radiotap_layout_get(&tmp, p, len, nbitmaps,
+	    EXTRACT_LE_32BITS(&hdr->it_present));
+
+	for (i = 0, step = l->steps; i < l->nsteps; i++, step++) {
+		if (step->kind != RADIOTAP_FIELD)
+			break;
+		f = p + step->offset;
+		switch (step->bit) {
+		case IEEE80211_RADIOTAP_FLAGS:
+			r->flags = f[0];
+			break;
+		case IEEE80211_RADIOTAP_RATE:
+			/* see print_radiotap_field() */
+			if (f[0] >= 0x80 && f[0] <= 0x8f)
+				r->mcs = f[0] & 0x7f;
+			else
+				r->rate = f[0];
+			break;
+		case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
+			r->has_signal = 1;
+			r->signal = (int8_t)f[0];
+			break;
+		case IEEE80211_RADIOTAP_MCS:
+			if (!(f[0] & IEEE80211_RADIOTAP_MCS_MCS_INDEX_KNOWN) ||
+			    f[2] > MAX_MCS_INDEX)
+				break;
+			r->mcs = f[2];
+			bw40 = (f[0] & IEEE80211_RADIOTAP_MCS_BANDWIDTH_KNOWN) &&
+			    (f[1] & IEEE80211_RADIOTAP_MCS_BANDWIDTH_MASK) ==
+			    IEEE80211_RADIOTAP_MCS_BANDWIDTH_40;
+			r->sgi = (f[0] & IEEE80211_RADIOTAP_MCS_GUARD_INTERVAL_KNOWN) &&
+			    (f[1] & IEEE80211_RADIOTAP_MCS_SHORT_GI);
+			break;
+		}
+	}
+	if (r->mcs >= 0)
+		r->htrate = ieee80211_float_htrates[r->mcs][bw40][r->sgi];
+	return len;
+}
+
+/*
+ * Estimates how long "len" bytes, FCS included, were on the air, in
+ * microseconds: the PHY preamble and header, then the frame at the
+ * rate from the radio header (SIFS, ACKs and backoff aren't counted).
+ * Returns 0 if the rate isn't known.
+ */
+static u_int
+wlan_airtime_estimate(const struct wlan_radio *r, u_int len)
+{
+	u_int bits = 8 * len, bps, nsym;
+
+	if (r->mcs >= 0) {
+		if (r->htrate == 0)
+			return 0;
+		/*
+		 * HT mixed format with one spatial stream's training
+		 * fields, then 4us symbols (3.6us with a short GI)
+		 * holding SERVICE, the frame and the tail bits.
+		 */
+		bps = (u_int)(r->htrate * (r->sgi ? 3.6 : 4.0) + 0.5);
+		nsym = (16 + bits + 6 + bps - 1) / bps;
+		return 36 + (r->sgi ? (nsym * 36 + 9) / 10 : nsym * 4);
+	}
+	switch (r->rate) {
+
+	case 0:
+		return 0;
+
+	case 2:
+	case 4:
+	case 11:
+	case 22:
+		/* DSSS and CCK, with a long or short PLCP preamble */
+		return ((r->flags & IEEE80211_RADIOTAP_F_SHORTPRE) &&
+		    r->rate != 2 ? 96 : 192) + bits * 2 / r->rate;
+
+	default:
+		/* OFDM: 20us of preamble and SIGNAL, then 4us symbols */
+		bps = r->rate * 2;
+		nsym = (16 + bits + 6 + bps - 1) / bps;
+		return 20 + nsym * 4;
+	}
+}
+
+static struct wlan_node *
+wlan_node(struct wlan_node **tab, u_int *countp, const u_int8_t *addr)
+{
+	struct wlan_node *n, **head;
+	u_int h = 2166136261U;
+	u_int i;
+
+	for (i = 0; i < 6; i++)
+		h = (h ^ addr[i]) * 16777619U;
+	head = &tab[h % WLAN_HASHSIZE];
+	for (n = *head; n != NULL; n = n->next)
+		if (memcmp(n->addr, addr, 6) == 0)
+			return n;
+	if (wlan_bss_count + wlan_station_count >= WLAN_NODE_MAX) {
+		wlan_untracked++;
+		return NULL;
+	}
+	n = (struct wlan_node *)pool_alloc(sizeof(*n));
+	memcpy(n->addr, addr, 6);
+	n->next = *head;
+	*head = n;
+	(*countp)++;
+	return n;
+}
+
+static void
+wlan_node_count(struct wlan_node *n, u_int16_t fc, u_int len, u_int airtime)
+{
+	n->frames++;
+	if (FC_TYPE(fc) == T_DATA)
+		n->data++;
+	if (FC_RETRY(fc))
+		n->retries++;
+	n->bytes += len;
+	n->airtime += airtime;
+}
+
+/*
+ * Counts the frame "p", with a radiotap header if "radiotap" is set,
+ * as ieee802_11_radio_if_print() and ieee802_11_if_print() would see
+ * it, but without printing anything.
+ */
+void
+ieee802_11_stats_packet(const u_char *p, u_int length, u_int caplen,
+			int radiotap)
+{
+	struct wlan_radio r;
+	struct mgmt_body_t pbody;
+	struct wlan_node *bss = NULL, *sta;
+	const u_int8_t *ta = NULL, *bssid = NULL;
+	u_int16_t fc;
+	u_int hdrlen, len, fcslen, airtime;
+	int bucket;
+
+	if (wlan_first.tv_sec == 0 && wlan_first.tv_usec == 0)
+		wlan_first = gndo->ndo_ts;
+	wlan_last = gndo->ndo_ts;
+
+	memset(&r, 0, sizeof(r));
+	r.mcs = -1;
+	if (radiotap) {
+		hdrlen = wlan_radio_info(p, caplen, &r);
+		if (hdrlen == 0 || length < hdrlen) {
+			wlan_truncated++;
+			return;
+		}
+		p += hdrlen;
+		length -= hdrlen;
+		caplen -= hdrlen;
+	}
+	if (caplen < IEEE802_11_FC_LEN) {
+		wlan_truncated++;
+		return;
+	}
+
+	/* what was sent, with the FCS whether or not it was captured */
+	fcslen = (r.flags & IEEE80211_RADIOTAP_F_FCS) ? IEEE802_11_FCS_LEN : 0;
+	len = length + IEEE802_11_FCS_LEN - fcslen;
+	airtime = wlan_airtime_estimate(&r, len);
+
+	fc = EXTRACT_LE_16BITS(p);
+	wlan_frames++;
+	wlan_types[FC_TYPE(fc)]++;
+	if (FC_RETRY(fc))
+		wlan_retries++;
+	wlan_bytes += len;
+	wlan_airtime += airtime;
+	if (r.mcs >= 0)
+		wlan_mcs[r.mcs]++;
+	else if (r.rate != 0)
+		wlan_rates[r.rate]++;
+	else
+		wlan_norate++;
+	if (r.has_signal) {
+		bucket = (r.signal + 100) / 10;
+		if (r.signal < -100)
+			bucket = 0;
+		else if (bucket >= WLAN_SIGNAL_BUCKETS)
+			bucket = WLAN_SIGNAL_BUCKETS - 1;
+		wlan_signal[bucket]++;
+	}
+	if (r.flags & IEEE80211_RADIOTAP_F_BADFCS) {
+		/* the addresses can't be trusted */
+		wlan_badfcs++;
+		return;
+	}
+
+	/* find the transmitter and the BSS, as data_header_print() does */
+	switch (FC_TYPE(fc)) {
+
+	case T_MGMT:
+		if (caplen < MGMT_HDRLEN)
+			break;
+		ta = p + 10;
+		bssid = p + 16;
+		break;
+
+	case T_CTRL:
+		switch (FC_SUBTYPE(fc)) {
+		case CTRL_PS_POLL:
+			if (caplen >= CTRL_PS_POLL_HDRLEN)
+				bssid = p + 4;
+			/* FALLTHROUGH */
+		case CTRL_RTS:
+		case CTRL_BAR:
+		case CTRL_BA:
+			if (caplen >= 16)
+				ta = p + 10;
+			break;
+		}
+		break;
+
+	case T_DATA:
+		if (caplen < 24)
+			break;
+		ta = p + 10;
+		if (!FC_TO_DS(fc) && !FC_FROM_DS(fc))
+			bssid = p + 16;
+		else if (!FC_TO_DS(fc) && FC_FROM_DS(fc))
+			bssid = p + 10;
+		else if (FC_TO_DS(fc) && !FC_FROM_DS(fc))
+			bssid = p + 4;
+		break;
+	}
+
+	/* probe requests can be sent to the broadcast BSSID */
+	if (bssid != NULL && (bssid[0] & 0x01))
+		bssid = NULL;
+	if (bssid != NULL &&
+	    (bss = wlan_node(wlan_bsses, &wlan_bss_count, bssid)) != NULL) {
+		wlan_node_count(bss, fc, len, airtime);
+		if (FC_TYPE(fc) == T_MGMT &&
+		    (FC_SUBTYPE(fc) == ST_BEACON ||
+		    FC_SUBTYPE(fc) == ST_PROBE_RESPONSE) &&
+		    length >= MGMT_HDRLEN + fcslen + 12) {
+			if (FC_SUBTYPE(fc) == ST_BEACON)
+				bss->beacons++;
+			/* the fixed fields are as in handle_beacon() */
+			memset(&pbody, 0, sizeof(pbody));
+			parse_elements(&pbody, p + MGMT_HDRLEN, 12,
+			    length - MGMT_HDRLEN - fcslen - 12);
+			/* don't let a hidden SSID replace a known one */
+			if (pbody.ssid != NULL && E_LENGTH(pbody.ssid) != 0 &&
+			    E_BODY(pbody.ssid)[0] != '\0') {
+				memcpy(bss->ssid, E_BODY(pbody.ssid),
+				    E_LENGTH(pbody.ssid));
+				bss->ssid[E_LENGTH(pbody.ssid)] = '\0';
+			}
+			if (pbody.ds != NULL)
+				bss->channel = E_BODY(pbody.ds)[0];
+		}
+	}
+	if (ta != NULL &&
+	    (sta = wlan_node(wlan_stations, &wlan_station_count, ta)) != NULL) {
+		wlan_node_count(sta, fc, len, airtime);
+		if (r.has_signal) {
+			if (sta->signal_frames == 0 || r.signal < sta->signal_min)
+				sta->signal_min = r.signal;
+			if (sta->signal_frames == 0 || r.signal > sta->signal_max)
+				sta->signal_max = r.signal;
+			sta->signal_frames++;
+			sta->signal_sum += r.signal;
+		}
+		if (bssid != NULL && memcmp(ta, bssid, 6) != 0) {
+			memcpy(sta->bssid, bssid, 6);
+			sta->has_bssid = 1;
+		}
+	}
+}
+
+static int
+wlan_node_cmp(const void *va, const void *vb)
+{
+	const struct wlan_node *a = *(const struct wlan_node * const *)va;
+	const struct wlan_node *b = *(const struct wlan_node * const *)vb;
+
+	if (a->airtime != b->airtime)
+		return a->airtime < b->airtime ? 1 : -1;
+	if (a->frames != b->frames)
+		return a->frames < b->frames ? 1 : -1;
+	return memcmp(a->addr, b->addr, 6);
+}
+
+/*
+ * Returns the nodes of "tab" that have frames, busiest first; sets *np
+ * to how many of them are to be shown.
+ */
+static struct wlan_node **
+wlan_sorted(struct wlan_node **tab, u_int count, u_int *np)
+{
+	struct wlan_node **sorted, *n;
+	u_int i, top = gndo->ndo_summary_top;
+
+	sorted = (struct wlan_node **)malloc((count + 1) * sizeof(*sorted));
+	if (sorted == NULL)
+		error("ieee802_11_stats_print: malloc");
+	*np = 0;
+	for (i = 0; i < WLAN_HASHSIZE; i++)
+		for (n = tab[i]; n != NULL; n = n->next)
+			if (n->frames != 0)
+				sorted[(*np)++] = n;
+	qsort(sorted, *np, sizeof(*sorted), wlan_node_cmp);
+	if (top != 0 && *np > top)
+		*np = top;
+	return sorted;
+}
+
+static double
+wlan_percent(u_int64_t n, u_int64_t total)
+{
+	return total != 0 ? 100.0 * n / total : 0.0;
+}
+
+void
+ieee802_11_stats_print(void)
+{
+	struct wlan_node **sorted, *n;
+	struct timeval dur;
+	u_int i, count;
+	int lo;
+
+	dur.tv_sec = wlan_last.tv_sec - wlan_first.tv_sec;
+	dur.tv_usec = wlan_last.tv_usec - wlan_first.tv_usec;
+	if (dur.tv_usec < 0) {
+		dur.tv_sec--;
+		dur.tv_usec += 1000000;
+	}
+	printf("802.11 summary: %" PRIu64 " frame%s (%" PRIu64 " management, %" PRIu64 " control, %" PRIu64 " data), %" PRIu64 " retr%s (%.1f%%), %u.%06u seconds of airtime in %u.%06u seconds",
+	    wlan_frames, PLURAL_SUFFIX(wlan_frames),
+	    wlan_types[T_MGMT], wlan_types[T_CTRL], wlan_types[T_DATA],
+	    wlan_retries, wlan_retries == 1 ? "y" : "ies",
+	    wlan_percent(wlan_retries, wlan_frames),
+	    (unsigned)(wlan_airtime / 1000000),
+	    (unsigned)(wlan_airtime % 1000000),
+	    (unsigned)dur.tv_sec, (unsigned)dur.tv_usec);
+	if (wlan_badfcs != 0)
+		printf(", %" PRIu64 " with a bad FCS", wlan_badfcs);
+	if (wlan_truncated != 0)
+		printf(", %" PRIu64 " truncated", wlan_truncated);
+	if (wlan_untracked != 0)
+		printf(", %" PRIu64 " from untracked stations", wlan_untracked);
+	printf("\n");
+	if (wlan_frames == 0)
+		return;
+
+	printf("%12s  %s\n", "frames", "rate");
+	for (i = 0; i < sizeof(wlan_rates)/sizeof(wlan_rates[0]); i++)
+		if (wlan_rates[i] != 0)
+			printf("%12" PRIu64 "  %.1f Mb/s\n", wlan_rates[i],
+			    .5 * i);
+	for (i = 0; i <= MAX_MCS_INDEX; i++)
+		if (wlan_mcs[i] != 0)
+			printf("%12" PRIu64 "  MCS %u\n", wlan_mcs[i], i);
+	if (wlan_norate != 0)
+		printf("%12" PRIu64 "  unknown\n", wlan_norate);
+
+	for (i = 0; i < WLAN_SIGNAL_BUCKETS; i++)
+		if (wlan_signal[i] != 0)
+			break;
+	if (i < WLAN_SIGNAL_BUCKETS) {
+		printf("%12s  %s\n", "frames", "signal");
+		for (i = 0; i < WLAN_SIGNAL_BUCKETS; i++) {
+			if (wlan_signal[i] == 0)
+				continue;
+			lo = -100 + 10 * (int)i;
+			if (i == 0)
+				printf("%12" PRIu64 "  below %d dBm\n",
+				    wlan_signal[i], lo + 10);
+			else if (i == WLAN_SIGNAL_BUCKETS - 1)
+				printf("%12" PRIu64 "  %d dBm and above\n",
+				    wlan_signal[i], lo);
+			else
+				printf("%12" PRIu64 "  %d to %d dBm\n",
+				    wlan_signal[i], lo, lo + 9);
+		}
+	}
+
+	if (wlan_bss_count != 0) {
+		sorted = wlan_sorted(wlan_bsses, wlan_bss_count, &count);
+		printf("%10s %8s %10s %6s %12s %15s %4s  %-17s  %s\n",
+		    "frames", "beacons", "data", "retry", "bytes", "airtime",
+		    "chan", "BSSID", "SSID");
+		for (i = 0; i < count; i++) {
+			n = sorted[i];
+			printf("%10" PRIu64 " %8" PRIu64 " %10" PRIu64 " %5.1f%% %12" PRIu64 " %8u.%06u ",
+			    n->frames, n->beacons, n->data,
+			    wlan_percent(n->retries, n->frames), n->bytes,
+			    (unsigned)(n->airtime / 1000000),
+			    (unsigned)(n->airtime % 1000000));
+			if (n->channel != 0)
+				printf("%4u", n->channel);
+			else
+				printf("%4s", "-");
+			printf("  %-17s  ", etheraddr_string(n->addr));
+			fn_print(n->ssid, NULL);
+			printf("\n");
+		}
+		free(sorted);
+	}
+
+	if (wlan_station_count != 0) {
+		sorted = wlan_sorted(wlan_stations, wlan_station_count, &count);
+		printf("%10s %6s %12s %15s %14s  %-17s  %s\n",
+		    "frames", "retry", "bytes", "airtime", "signal",
+		    "station", "BSSID");
+		for (i = 0; i < count; i++) {
+			n = sorted[i];
+			printf("%10" PRIu64 " %5.1f%% %12" PRIu64 " %8u.%06u ",
+			    n->frames, wlan_percent(n->retries, n->frames),
+			    n->bytes, (unsigned)(n->airtime / 1000000),
+			    (unsigned)(n->airtime % 1000000));
+			if (n->signal_frames != 0)
+				printf("%4d/%4d/%4d",
+				    n->signal_min,
+				    (int)(n->signal_sum / (int64_t)n->signal_frames),
+				    n->signal_max);
+			else
+				printf("%14s", "-");
+			printf("  %-17s  ", etheraddr_string(n->addr));
+			printf("%s\n", n->has_bssid ?
+			    etheraddr_string(n->bssid) : "-");
+		}
+		free(sorted);
+	}
+}
+
+void
+ieee802_11_stats_reset(void)
+{
+	struct wlan_node *n;
+	u_int i;
+
+	for (i = 0; i < WLAN_HASHSIZE; i++) {
+		for (n = wlan_bsses[i]; n != NULL; n = n->next)
+			n->frames = n->beacons = n->data = n->retries =
+			    n->bytes = n->airtime = 0;
+		for (n = wlan_stations[i]; n != NULL; n = n->next) {
+			n->frames = n->beacons = n->data = n->retries =
+			    n->bytes = n->airtime = 0;
+			n->signal_frames = 0;
+			n->signal_sum = 0;
+		}
+	}
+	wlan_frames = wlan_retries = wlan_bytes = wlan_airtime = 0;
+	wlan_badfcs = wlan_truncated = wlan_untracked = wlan_norate = 0;
+	memset(wlan_types, 0, sizeof(wlan_types));
+	memset(wlan_rates, 0, sizeof(wlan_rates));
+	memset(wlan_mcs, 0, sizeof(wlan_mcs));
+	memset(wlan_signal, 0, sizeof(wlan_signal));
+	wlan_first = wlan_last = gndo->ndo_ts;
+}
+
 #define PRISM_HDR_LEN		144
 
 #define WLANCAP_MAGIC_COOKIE_BASE 0x80211000
@@ -2948,7 +3487,8 @@ ieee802_11_avs_radio_print(const u_char *p, u_int length, u_int caplen)
  * indicate whether it's a Prism header or an AVS header).
  */
 u_int
-prism_if_print(const struct pcap_pkthdr *h, const u_char *p)
+prism_if_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, const u_char *p)
 {
 	u_int caplen = h->caplen;
 	u_int length = h->len;
@@ -2978,7 +3518,8 @@ prism_if_print(const struct pcap_pkthdr *h, const u_char *p)
  * header, containing information such as radio information.
  */
 u_int
-ieee802_11_radio_if_print(const struct pcap_pkthdr *h, const u_char *p)
+ieee802_11_radio_if_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, const u_char *p)
 {
 	return ieee802_11_radio_print(p, h->len, h->caplen);
 }
@@ -2989,7 +3530,8 @@ ieee802_11_radio_if_print(const struct pcap_pkthdr *h, const u_char *p)
  * which we currently ignore.
  */
 u_int
-ieee802_11_radio_avs_if_print(const struct pcap_pkthdr *h, const u_char *p)
+ieee802_11_radio_avs_if_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, const u_char *p)
 {
 	return ieee802_11_avs_radio_print(p, h->len, h->caplen);
 }
@@ -36,6 +36,7 @@
 #include "ethertype.h"
 #include "extract.h"			/* must come after interface.h */
 #include "appletalk.h"
+#include "scratch.h"
 
 static const char tstr[] = "[|atalk]";
 
@@ -76,7 +77,8 @@ static const char *ddpskt_string(int);
  * Print LLAP packets received on a physical LocalTalk interface.
  */
 u_int
-ltalk_if_print(const struct pcap_pkthdr *h, const u_char *p)
+ltalk_if_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, const u_char *p)
 {
 	return (llap_print(p, h->caplen));
 }
@@ -564,7 +566,7 @@ ataddr_string(u_short atnet, u_char athost)
 				;
 			tp->addr = i2;
 			tp->nxt = newhnamemem();
-			tp->name = strdup(nambuf);
+			tp->name = pool_strdup(nambuf);
 		}
 		fclose(fp);
 	}
@@ -581,7 +583,7 @@ ataddr_string(u_short atnet, u_char athost)
 			tp->nxt = newhnamemem();
 			(void)snprintf(nambuf, sizeof(nambuf), "%s.%d",
 			    tp2->name, athost);
-			tp->name = strdup(nambuf);
+			tp->name = pool_strdup(nambuf);
 			return (tp->name);
 		}
 
@@ -591,7 +593,7 @@ ataddr_string(u_short atnet, u_char athost)
 		(void)snprintf(nambuf, sizeof(nambuf), "%d.%d", atnet, athost);
 	else
 		(void)snprintf(nambuf, sizeof(nambuf), "%d", atnet);
-	tp->name = strdup(nambuf);
+	tp->name = pool_strdup(nambuf);
 
 	return (tp->name);
 }
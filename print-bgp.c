@@ -37,6 +37,7 @@
 #include <tcpdump-stdinc.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "interface.h"
@@ -45,6 +46,7 @@
 #include "bgp.h"
 #include "af.h"
 #include "l2vpn.h"
+#include "scratch.h"
 
 struct bgp {
 	u_int8_t bgp_marker[16];
@@ -479,6 +481,55 @@ as_printf (char *str, int size, u_int asnum)
 
 #define ITEMCHECK(minlen) if (itemlen < minlen) goto badtlv;
 
+/* Room for the longest prefix bgp_prefix_format() writes with -n */
+#define BGP_PREFIX_STRLEN sizeof("ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255/128")
+
+/*
+ * Write the prefix "addr"/"plen" of address family "af" to "buf" and
+ * return a pointer to the terminating '\0'.  With -n, and room in
+ * "buf", the address is formatted in place; a full table has hundreds
+ * of thousands of prefixes, each seen once, and putting them in the
+ * getname() cache only makes its hash chains long.
+ */
+static char *
+bgp_prefix_format(char *buf, u_int buflen, int af, const u_char *addr,
+		  u_int plen)
+{
+	char *cp;
+	int n;
+
+	if (nflag && buflen >= BGP_PREFIX_STRLEN) {
+#ifdef INET6
+		if (af == AF_INET6)
+			cp = ip6addr_format(buf, addr);
+		else
+#endif
+			cp = ipaddr_format(buf, addr);
+		*cp++ = '/';
+		if (plen >= 100) {
+			*cp++ = plen / 100 + '0';
+			plen %= 100;
+			*cp++ = plen / 10 + '0';
+		} else if (plen >= 10)
+			*cp++ = plen / 10 + '0';
+		*cp++ = plen % 10 + '0';
+		*cp = '\0';
+		return cp;
+	}
+
+#ifdef INET6
+	if (af == AF_INET6)
+		n = snprintf(buf, buflen, "%s/%u", getname6(addr), plen);
+	else
+#endif
+		n = snprintf(buf, buflen, "%s/%u", getname(addr), plen);
+	if (n < 0)
+		n = 0;
+	else if ((u_int)n >= buflen)
+		n = buflen - 1;
+	return buf + n;
+}
+
 int
 decode_prefix4(const u_char *pptr, u_int itemlen, char *buf, u_int buflen)
 {
@@ -501,7 +552,7 @@ decode_prefix4(const u_char *pptr, u_int itemlen, char *buf, u_int buflen)
 		((u_char *)&addr)[plenbytes - 1] &=
 			((0xff00 >> (plen % 8)) & 0xff);
 	}
-	snprintf(buf, buflen, "%s/%d", getname((u_char *)&addr), plen);
+	bgp_prefix_format(buf, buflen, AF_INET, (u_char *)&addr, plen);
 	return 1 + plenbytes;
 
 trunc:
@@ -516,6 +567,7 @@ decode_labeled_prefix4(const u_char *pptr, u_int itemlen, char *buf, u_int bufle
 {
 	struct in_addr addr;
 	u_int plen, plenbytes;
+	char *cp;
 
 	/* prefix length and label = 4 bytes */
 	TCHECK2(pptr[0], 4);
@@ -548,10 +600,9 @@ decode_labeled_prefix4(const u_char *pptr, u_int itemlen, char *buf, u_int bufle
 		((u_char *)&addr)[plenbytes - 1] &=
 			((0xff00 >> (plen % 8)) & 0xff);
 	}
+	cp = bgp_prefix_format(buf, buflen, AF_INET, (u_char *)&addr, plen);
         /* the label may get offsetted by 4 bits so lets shift it right */
-	snprintf(buf, buflen, "%s/%d, label:%u %s",
-                 getname((u_char *)&addr),
-                 plen,
+	snprintf(cp, buflen - (cp - buf), ", label:%u %s",
                  EXTRACT_24BITS(pptr+1)>>4,
                  ((pptr[3]&1)==0) ? "(BOGUS: Bottom of Stack NOT set!)" : "(bottom)" );
 
@@ -742,6 +793,7 @@ decode_labeled_vpn_prefix4(const u_char *pptr, char *buf, u_int buflen)
 {
 	struct in_addr addr;
 	u_int plen;
+	char pfx[MAXHOSTNAMELEN + 8];
 
 	TCHECK(pptr[0]);
 	plen = pptr[0];   /* get prefix length */
@@ -761,11 +813,11 @@ decode_labeled_vpn_prefix4(const u_char *pptr, char *buf, u_int buflen)
 		((u_char *)&addr)[(plen + 7) / 8 - 1] &=
 			((0xff00 >> (plen % 8)) & 0xff);
 	}
+	bgp_prefix_format(pfx, sizeof(pfx), AF_INET, (u_char *)&addr, plen);
         /* the label may get offsetted by 4 bits so lets shift it right */
-	snprintf(buf, buflen, "RD: %s, %s/%d, label:%u %s",
+	snprintf(buf, buflen, "RD: %s, %s, label:%u %s",
                  bgp_vpn_rd_print(pptr+4),
-                 getname((u_char *)&addr),
-                 plen,
+                 pfx,
                  EXTRACT_24BITS(pptr+1)>>4,
                  ((pptr[3]&1)==0) ? "(BOGUS: Bottom of Stack NOT set!)" : "(bottom)" );
 
@@ -1063,7 +1115,7 @@ decode_prefix6(const u_char *pd, u_int itemlen, char *buf, u_int buflen)
 		addr.s6_addr[plenbytes - 1] &=
 			((0xff00 >> (plen % 8)) & 0xff);
 	}
-	snprintf(buf, buflen, "%s/%d", getname6((u_char *)&addr), plen);
+	bgp_prefix_format(buf, buflen, AF_INET6, (u_char *)&addr, plen);
 	return 1 + plenbytes;
 
 trunc:
@@ -1078,6 +1130,7 @@ decode_labeled_prefix6(const u_char *pptr, u_int itemlen, char *buf, u_int bufle
 {
 	struct in6_addr addr;
 	u_int plen, plenbytes;
+	char *cp;
 
 	/* prefix length and label = 4 bytes */
 	TCHECK2(pptr[0], 4);
@@ -1101,10 +1154,9 @@ decode_labeled_prefix6(const u_char *pptr, u_int itemlen, char *buf, u_int bufle
 		addr.s6_addr[plenbytes - 1] &=
 			((0xff00 >> (plen % 8)) & 0xff);
 	}
+	cp = bgp_prefix_format(buf, buflen, AF_INET6, (u_char *)&addr, plen);
         /* the label may get offsetted by 4 bits so lets shift it right */
-	snprintf(buf, buflen, "%s/%d, label:%u %s",
-                 getname6((u_char *)&addr),
-                 plen,
+	snprintf(cp, buflen - (cp - buf), ", label:%u %s",
                  EXTRACT_24BITS(pptr+1)>>4,
                  ((pptr[3]&1)==0) ? "(BOGUS: Bottom of Stack NOT set!)" : "(bottom)" );
 
@@ -1122,6 +1174,7 @@ decode_labeled_vpn_prefix6(const u_char *pptr, char *buf, u_int buflen)
 {
 	struct in6_addr addr;
 	u_int plen;
+	char pfx[MAXHOSTNAMELEN + 8];
 
 	TCHECK(pptr[0]);
 	plen = pptr[0];   /* get prefix length */
@@ -1141,11 +1194,11 @@ decode_labeled_vpn_prefix6(const u_char *pptr, char *buf, u_int buflen)
 		addr.s6_addr[(plen + 7) / 8 - 1] &=
 			((0xff00 >> (plen % 8)) & 0xff);
 	}
+	bgp_prefix_format(pfx, sizeof(pfx), AF_INET6, (u_char *)&addr, plen);
         /* the label may get offsetted by 4 bits so lets shift it right */
-	snprintf(buf, buflen, "RD: %s, %s/%d, label:%u %s",
+	snprintf(buf, buflen, "RD: %s, %s, label:%u %s",
                  bgp_vpn_rd_print(pptr+4),
-                 getname6((u_char *)&addr),
-                 plen,
+                 pfx,
                  EXTRACT_24BITS(pptr+1)>>4,
                  ((pptr[3]&1)==0) ? "(BOGUS: Bottom of Stack NOT set!)" : "(bottom)" );
 
@@ -2348,6 +2401,179 @@ trunc:
 	printf("[|BGP]");
 }
 
+/*
+ * Walk an UPDATE message, less the BGP header, without printing it.
+ * "nlri" is called with the withdrawn routes, the prefixes in each
+ * MP_REACH_NLRI and MP_UNREACH_NLRI attribute and the announced routes,
+ * and "aspath", if not NULL, with the AS_PATH.  The message must have
+ * been captured in full.  Returns 0 if it doesn't parse.
+ */
+static int
+bgp_update_walk(const u_char *p, u_int len,
+		int (*nlri)(void *, u_int, u_int, const u_char *, u_int, int),
+		void (*aspath)(void *, const u_char *, u_int), void *arg)
+{
+	u_int wlen, alen, aflags, atype, lenlen, attrlen, afi, safi, nhlen;
+	const u_char *attr;
+
+	if (len < 2)
+		return 0;
+	wlen = EXTRACT_16BITS(p);
+	if (2 + wlen > len)
+		return 0;
+	if (!(*nlri)(arg, AFNUM_INET, SAFNUM_UNICAST, p + 2, wlen, 1))
+		return 0;
+	p += 2 + wlen;
+	len -= 2 + wlen;
+
+	if (len < 2)
+		return 0;
+	alen = EXTRACT_16BITS(p);
+	if (2 + alen > len)
+		return 0;
+	attr = p + 2;
+	p += 2 + alen;
+	len -= 2 + alen;
+	while (alen > 0) {
+		if (alen < 3)
+			return 0;
+		aflags = attr[0];
+		atype = attr[1];
+		lenlen = aflags & 0x10 ? 2 : 1;
+		if (alen < 2 + lenlen)
+			return 0;
+		attrlen = lenlen == 2 ? EXTRACT_16BITS(attr + 2) : attr[2];
+		attr += 2 + lenlen;
+		alen -= 2 + lenlen;
+		if (attrlen > alen)
+			return 0;
+
+		switch (atype) {
+
+		case BGPTYPE_AS_PATH:
+			if (aspath != NULL)
+				(*aspath)(arg, attr, attrlen);
+			break;
+
+		case BGPTYPE_MP_REACH_NLRI:
+			/* AFI, SAFI, next hop, reserved octet, NLRI */
+			if (attrlen < 5)
+				return 0;
+			afi = EXTRACT_16BITS(attr);
+			safi = attr[2];
+			nhlen = attr[3];
+			if (5 + nhlen > attrlen)
+				return 0;
+			if (!(*nlri)(arg, afi, safi, attr + 5 + nhlen,
+			    attrlen - 5 - nhlen, 0))
+				return 0;
+			break;
+
+		case BGPTYPE_MP_UNREACH_NLRI:
+			if (attrlen < 3)
+				return 0;
+			afi = EXTRACT_16BITS(attr);
+			safi = attr[2];
+			if (!(*nlri)(arg, afi, safi, attr + 3, attrlen - 3, 1))
+				return 0;
+			break;
+		}
+		attr += attrlen;
+		alen -= attrlen;
+	}
+
+	return (*nlri)(arg, AFNUM_INET, SAFNUM_UNICAST, p, len, 0);
+}
+
+/*
+ * For "-o bgp-counts": UPDATEs are shown as the number of prefixes
+ * announced and withdrawn for each AFI/SAFI, without decoding the
+ * attributes or formatting a single prefix.  Beyond the first
+ * BGP_COUNTS_MAX AFI/SAFIs, prefixes are counted together as "other".
+ */
+#define BGP_COUNTS_MAX	8		/* AFI/SAFIs shown per UPDATE */
+
+struct bgp_update_counts {
+	u_int	n;
+	struct {
+		u_int16_t afi;
+		u_int8_t  safi;
+		u_int	  announced;
+		u_int	  withdrawn;
+	} afi[BGP_COUNTS_MAX];
+	u_int	other_announced;	/* for AFI/SAFIs past the last */
+	u_int	other_withdrawn;
+};
+
+static int
+bgp_count_nlri(void *arg, u_int afi, u_int safi, const u_char *p, u_int len,
+	       int withdraw)
+{
+	struct bgp_update_counts *c = (struct bgp_update_counts *)arg;
+	u_int i, plenbytes, n = 0;
+
+	while (len > 0) {
+		plenbytes = (p[0] + 7) / 8;
+		if (1 + plenbytes > len)
+			return 0;
+		n++;
+		p += 1 + plenbytes;
+		len -= 1 + plenbytes;
+	}
+	if (n == 0)
+		return 1;
+
+	for (i = 0; i < c->n; i++)
+		if (c->afi[i].afi == afi && c->afi[i].safi == safi)
+			break;
+	if (i == c->n) {
+		if (c->n == BGP_COUNTS_MAX) {
+			if (withdraw)
+				c->other_withdrawn += n;
+			else
+				c->other_announced += n;
+			return 1;
+		}
+		c->n++;
+		c->afi[i].afi = afi;
+		c->afi[i].safi = safi;
+		c->afi[i].announced = c->afi[i].withdrawn = 0;
+	}
+	if (withdraw)
+		c->afi[i].withdrawn += n;
+	else
+		c->afi[i].announced += n;
+	return 1;
+}
+
+static void
+bgp_update_counts_print(const u_char *dat, int length)
+{
+	struct bgp_update_counts c;
+	char tokbuf[TOKBUFSIZE], tokbuf2[TOKBUFSIZE];
+	u_int i;
+
+	c.n = 0;
+	c.other_announced = c.other_withdrawn = 0;
+	if (!bgp_update_walk(dat + BGP_SIZE, length - BGP_SIZE,
+	    bgp_count_nlri, NULL, &c)) {
+		printf("\n\t  [|BGP]");
+		return;
+	}
+	if (c.n == 0)
+		printf("\n\t  no prefixes");
+	for (i = 0; i < c.n; i++)
+		printf("\n\t  %s %s: announced %u, withdrawn %u",
+		    tok2strbuf(af_values, "AFI %u", c.afi[i].afi,
+			tokbuf, sizeof(tokbuf)),
+		    tok2strbuf(bgp_safi_values, "SAFI %u", c.afi[i].safi,
+			tokbuf2, sizeof(tokbuf2)),
+		    c.afi[i].announced, c.afi[i].withdrawn);
+	if (c.other_announced != 0 || c.other_withdrawn != 0)
+		printf("\n\t  other AFI/SAFIs: announced %u, withdrawn %u",
+		    c.other_announced, c.other_withdrawn);
+}
+
 static void
 bgp_update_print(const u_char *dat, int length)
 {
@@ -2649,7 +2875,10 @@ bgp_header_print(const u_char *dat, int length)
 		bgp_open_print(dat, length);
 		break;
 	case BGP_UPDATE:
-		bgp_update_print(dat, length);
+		if (gndo->ndo_bgp_counts)
+			bgp_update_counts_print(dat, length);
+		else
+			bgp_update_print(dat, length);
 		break;
 	case BGP_NOTIFICATION:
 		bgp_notification_print(dat, length);
@@ -2692,7 +2921,7 @@ bgp_print(const u_char *dat, int length)
 
 	printf(": BGP, length: %u",length);
 
-        if (vflag < 1) /* lets be less chatty */
+        if (vflag < 1 && !gndo->ndo_bgp_counts) /* lets be less chatty */
                 return;
 
 	p = dat;
@@ -2747,6 +2976,534 @@ trunc:
 	printf(" [|BGP]");
 }
 
+/*
+ * Statistics for "-o bgp-stats", a summary mode: UPDATE messages are
+ * walked in their binary form, without printing anything.  For each
+ * peer (the sender of the UPDATEs) a path-compressed binary trie per
+ * AFI/SAFI remembers the unicast and multicast prefixes announced and
+ * withdrawn, so that a prefix announced again after being withdrawn
+ * is counted as a flap.  Announcements and withdrawals are also
+ * counted per AFI/SAFI (for all SAFIs), and AS_PATH lengths are
+ * counted per UPDATE.  Prefixes are only formatted when a report is
+ * printed.  BGP messages that don't fit in one TCP segment are not
+ * seen.
+ */
+struct bgp_prefix {
+	struct bgp_prefix *child[2];
+	u_int8_t	addr[16];	/* masked to plen */
+	u_int8_t	plen;
+	u_int8_t	state;
+#define BGP_PFX_NONE		0	/* only branches here */
+#define BGP_PFX_ANNOUNCED	1
+#define BGP_PFX_WITHDRAWN	2
+	u_int		announced;
+	u_int		withdrawn;
+	u_int		flaps;		/* announced after a withdrawal */
+};
+
+#define BGP_TRIES	4		/* IPv4/IPv6 x unicast/multicast */
+#define BGP_TRIE(afi, safi)	(((afi) - AFNUM_INET) * 2 + (safi) - SAFNUM_UNICAST)
+
+struct bgp_peer {
+	struct bgp_peer	*next;
+	u_int8_t	af;
+	u_int8_t	addr[16];
+	u_int64_t	updates;
+	u_int64_t	announced;
+	u_int64_t	withdrawn;
+	u_int		prefixes;	/* currently announced */
+	u_int		flaps;
+	struct bgp_prefix *trie[BGP_TRIES];
+};
+
+struct bgp_afi_stats {
+	u_int16_t	afi;
+	u_int8_t	safi;
+	u_int64_t	announced;
+	u_int64_t	withdrawn;
+};
+
+#define BGP_PEER_HASHSIZE	64
+#define BGP_AFI_STATS_MAX	32
+#define BGP_ASPATH_MAX		32	/* longer AS_PATHs are counted together */
+#define BGP_PREFIX_MAX		4194304	/* trie nodes, about 200MB */
+
+static struct bgp_peer		*bgp_peers[BGP_PEER_HASHSIZE];
+static u_int			bgp_peer_count;
+static struct bgp_afi_stats	bgp_afi_stats[BGP_AFI_STATS_MAX];
+static u_int			bgp_afi_count;
+static u_int64_t		bgp_aspath_len[BGP_ASPATH_MAX + 1];
+static u_int64_t		bgp_updates, bgp_announced, bgp_withdrawn;
+static u_int64_t		bgp_bad_updates, bgp_untracked;
+static u_int			bgp_prefix_nodes;
+static struct timeval		bgp_first, bgp_last;
+
+static struct bgp_peer *
+bgp_stats_peer(int af, const u_char *addr)
+{
+	struct bgp_peer *peer, **head;
+	size_t len = af == 6 ? 16 : 4;
+	u_int h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ addr[i]) * 16777619U;
+	head = &bgp_peers[h % BGP_PEER_HASHSIZE];
+	for (peer = *head; peer != NULL; peer = peer->next)
+		if (peer->af == af && memcmp(peer->addr, addr, len) == 0)
+			return peer;
+	peer = (struct bgp_peer *)pool_alloc(sizeof(*peer));
+	peer->af = af;
+	memcpy(peer->addr, addr, len);
+	peer->next = *head;
+	*head = peer;
+	bgp_peer_count++;
+	return peer;
+}
+
+#define BGP_BIT(a, n)	(((a)[(n) / 8] >> (7 - (n) % 8)) & 1)
+
+static struct bgp_prefix *
+bgp_prefix_new(const u_int8_t *addr, u_int plen)
+{
+	struct bgp_prefix *n;
+
+	n = (struct bgp_prefix *)pool_alloc(sizeof(*n));
+	memcpy(n->addr, addr, (plen + 7) / 8);
+	n->plen = plen;
+	bgp_prefix_nodes++;
+	return n;
+}
+
+/*
+ * Return the node for "addr"/"plen" in the trie at "*rootp", adding
+ * it (and a branch node, if needed) unless the trie is full.
+ */
+static struct bgp_prefix *
+bgp_prefix_get(struct bgp_prefix **rootp, const u_int8_t *addr, u_int plen)
+{
+	struct bgp_prefix **np = rootp, *n, *new, *branch;
+	u_int max, diff;
+
+	while ((n = *np) != NULL) {
+		/* bits in common with this node */
+		max = plen < n->plen ? plen : n->plen;
+		for (diff = 0; diff + 8 <= max &&
+		    addr[diff / 8] == n->addr[diff / 8]; diff += 8)
+			continue;
+		while (diff < max && BGP_BIT(addr, diff) == BGP_BIT(n->addr, diff))
+			diff++;
+
+		if (diff == n->plen) {
+			if (plen == n->plen)
+				return n;
+			np = &n->child[BGP_BIT(addr, n->plen)];
+			continue;
+		}
+		if (bgp_prefix_nodes + 2 > BGP_PREFIX_MAX)
+			return NULL;
+		new = bgp_prefix_new(addr, plen);
+		if (diff == plen) {
+			/* the new prefix covers this node */
+			new->child[BGP_BIT(n->addr, plen)] = n;
+			*np = new;
+			return new;
+		}
+		branch = bgp_prefix_new(addr, diff);
+		if (diff % 8)
+			branch->addr[diff / 8] &= 0xff00 >> (diff % 8);
+		branch->child[BGP_BIT(addr, diff)] = new;
+		branch->child[BGP_BIT(n->addr, diff)] = n;
+		*np = branch;
+		return new;
+	}
+	if (bgp_prefix_nodes + 1 > BGP_PREFIX_MAX)
+		return NULL;
+	return *np = bgp_prefix_new(addr, plen);
+}
+
+static struct bgp_afi_stats *
+bgp_stats_afi(u_int afi, u_int safi)
+{
+	struct bgp_afi_stats *as;
+	u_int i;
+
+	for (i = 0; i < bgp_afi_count; i++) {
+		as = &bgp_afi_stats[i];
+		if (as->afi == afi && as->safi == safi)
+			return as;
+	}
+	if (bgp_afi_count == BGP_AFI_STATS_MAX)
+		return NULL;
+	as = &bgp_afi_stats[bgp_afi_count++];
+	as->afi = afi;
+	as->safi = safi;
+	return as;
+}
+
+/*
+ * Count the NLRI in "p"/"len", announced or withdrawn by the peer "arg",
+ * for "afi" and "safi".  Returns 0 if they don't parse.
+ */
+static int
+bgp_stats_nlri(void *arg, u_int afi, u_int safi, const u_char *p, u_int len,
+	       int withdraw)
+{
+	struct bgp_peer *peer = (struct bgp_peer *)arg;
+	struct bgp_afi_stats *as;
+	struct bgp_prefix *pfx;
+	const u_char *q;
+	u_int8_t addr[16];
+	u_int plen, plenbytes, left, n = 0, maxlen = 255;
+	int track;
+
+	track = (afi == AFNUM_INET || afi == AFNUM_INET6) &&
+	    (safi == SAFNUM_UNICAST || safi == SAFNUM_MULTICAST);
+	if (track)
+		maxlen = afi == AFNUM_INET ? 32 : 128;
+
+	/* check all the prefixes before touching the trie */
+	for (q = p, left = len; left > 0; q += 1 + plenbytes,
+	    left -= 1 + plenbytes) {
+		plenbytes = (q[0] + 7) / 8;
+		if (q[0] > maxlen || 1 + plenbytes > left)
+			return 0;
+		n++;
+	}
+
+	while (len > 0) {
+		plen = p[0];
+		plenbytes = (plen + 7) / 8;
+		if (track) {
+			memcpy(addr, p + 1, plenbytes);
+			if (plen % 8)
+				addr[plenbytes - 1] &= 0xff00 >> (plen % 8);
+			pfx = bgp_prefix_get(&peer->trie[BGP_TRIE(afi, safi)],
+			    addr, plen);
+			if (pfx == NULL)
+				bgp_untracked++;
+			else if (withdraw) {
+				if (pfx->state == BGP_PFX_ANNOUNCED)
+					peer->prefixes--;
+				pfx->state = BGP_PFX_WITHDRAWN;
+				pfx->withdrawn++;
+			} else {
+				if (pfx->state == BGP_PFX_WITHDRAWN) {
+					pfx->flaps++;
+					peer->flaps++;
+				}
+				if (pfx->state != BGP_PFX_ANNOUNCED)
+					peer->prefixes++;
+				pfx->state = BGP_PFX_ANNOUNCED;
+				pfx->announced++;
+			}
+		}
+		p += 1 + plenbytes;
+		len -= 1 + plenbytes;
+	}
+
+	if (withdraw) {
+		peer->withdrawn += n;
+		bgp_withdrawn += n;
+	} else {
+		peer->announced += n;
+		bgp_announced += n;
+	}
+	if ((as = bgp_stats_afi(afi, safi)) != NULL) {
+		if (withdraw)
+			as->withdrawn += n;
+		else
+			as->announced += n;
+	}
+	return 1;
+}
+
+/* Count the length of an AS_PATH, counting an AS_SET as 1 */
+static void
+bgp_stats_aspath(void *arg _U_, const u_char *p, u_int len)
+{
+	u_int as_size, pathlen = 0, seglen;
+
+	as_size = bgp_attr_get_as_size(BGPTYPE_AS_PATH, p, len);
+	while (len >= 2) {
+		seglen = 2 + p[1] * as_size;
+		if (seglen > len)
+			break;
+		if (p[0] == BGP_AS_SEQUENCE)
+			pathlen += p[1];
+		else if (p[0] == BGP_AS_SET)
+			pathlen++;
+		p += seglen;
+		len -= seglen;
+	}
+	bgp_aspath_len[min(pathlen, BGP_ASPATH_MAX)]++;
+}
+
+/*
+ * Count the UPDATEs in the TCP payload "dat"/"length" from the BGP
+ * speaker with address "src" (IPv4 if "af" is 4, IPv6 if 6).
+ */
+void
+bgp_stats_packet(const u_char *dat, u_int length, int af, const u_char *src)
+{
+	struct bgp_peer *peer = NULL;
+	const u_char *p, *ep;
+	u_int hlen;
+
+	ep = dat + length;
+	if (ep > snapend)
+		ep = snapend;
+	for (p = dat; p + BGP_SIZE <= ep; p += hlen) {
+		if (p[0] != 0xff || memcmp(p, p + 1, 15) != 0) {
+			/* not at a message; look for the next marker */
+			hlen = 1;
+			continue;
+		}
+		hlen = EXTRACT_16BITS(p + 16);
+		if (hlen < BGP_SIZE || p + hlen > ep)
+			break;
+		if (p[18] != BGP_UPDATE)
+			continue;
+
+		if (peer == NULL) {
+			peer = bgp_stats_peer(af, src);
+			if (bgp_first.tv_sec == 0 && bgp_first.tv_usec == 0)
+				bgp_first = gndo->ndo_ts;
+			bgp_last = gndo->ndo_ts;
+		}
+		peer->updates++;
+		bgp_updates++;
+		if (!bgp_update_walk(p + BGP_SIZE, hlen - BGP_SIZE,
+		    bgp_stats_nlri, bgp_stats_aspath, peer))
+			bgp_bad_updates++;
+	}
+}
+
+static const char *
+bgp_prefix_string(u_int afi, const struct bgp_prefix *pfx, char *buf,
+		  size_t buflen)
+{
+	char addr[INET6_ADDRSTRLEN];
+
+	if (inet_ntop(afi == AFNUM_INET6 ? AF_INET6 : AF_INET, pfx->addr,
+	    addr, sizeof(addr)) == NULL)
+		strlcpy(addr, "?", sizeof(addr));
+	snprintf(buf, buflen, "%s/%u", addr, pfx->plen);
+	return buf;
+}
+
+static const char *
+bgp_peer_string(const struct bgp_peer *peer)
+{
+#ifdef INET6
+	if (peer->af == 6)
+		return ip6addr_string(peer->addr);
+#endif
+	return ipaddr_string(peer->addr);
+}
+
+static int
+bgp_peer_cmp(const void *va, const void *vb)
+{
+	const struct bgp_peer *a = *(const struct bgp_peer * const *)va;
+	const struct bgp_peer *b = *(const struct bgp_peer * const *)vb;
+	u_int64_t ca = a->announced + a->withdrawn;
+	u_int64_t cb = b->announced + b->withdrawn;
+
+	if (ca != cb)
+		return ca < cb ? 1 : -1;
+	return memcmp(a->addr, b->addr, sizeof(a->addr));
+}
+
+struct bgp_flap {
+	const struct bgp_peer *peer;
+	u_int afi;
+	const struct bgp_prefix *pfx;
+};
+
+static int
+bgp_flap_cmp(const void *va, const void *vb)
+{
+	const struct bgp_flap *a = (const struct bgp_flap *)va;
+	const struct bgp_flap *b = (const struct bgp_flap *)vb;
+
+	if (a->pfx->flaps != b->pfx->flaps)
+		return a->pfx->flaps < b->pfx->flaps ? 1 : -1;
+	if (a->afi != b->afi)
+		return a->afi < b->afi ? -1 : 1;
+	if (a->pfx->plen != b->pfx->plen)
+		return a->pfx->plen < b->pfx->plen ? -1 : 1;
+	return memcmp(a->pfx->addr, b->pfx->addr, sizeof(a->pfx->addr));
+}
+
+/*
+ * Call "fn" for each prefix node in the trie at "n".  Tries are at
+ * most 129 levels deep.
+ */
+static void
+bgp_prefix_walk(struct bgp_prefix *n, void (*fn)(struct bgp_prefix *, void *),
+		void *arg)
+{
+	for (; n != NULL; n = n->child[1]) {
+		if (n->state != BGP_PFX_NONE)
+			(*fn)(n, arg);
+		bgp_prefix_walk(n->child[0], fn, arg);
+	}
+}
+
+struct bgp_flap_list {
+	struct bgp_flap	*flaps;
+	u_int		count;
+	u_int		size;
+	const struct bgp_peer *peer;
+	u_int		afi;
+};
+
+static void
+bgp_flap_add(struct bgp_prefix *pfx, void *arg)
+{
+	struct bgp_flap_list *fl = (struct bgp_flap_list *)arg;
+
+	if (pfx->flaps == 0)
+		return;
+	if (fl->count == fl->size) {
+		fl->size = fl->size ? fl->size * 2 : 64;
+		fl->flaps = (struct bgp_flap *)realloc(fl->flaps,
+		    fl->size * sizeof(*fl->flaps));
+		if (fl->flaps == NULL)
+			error("bgp_stats_print: realloc");
+	}
+	fl->flaps[fl->count].peer = fl->peer;
+	fl->flaps[fl->count].afi = fl->afi;
+	fl->flaps[fl->count].pfx = pfx;
+	fl->count++;
+}
+
+void
+bgp_stats_print(void)
+{
+	struct bgp_peer **sorted, *peer;
+	struct bgp_flap_list fl;
+	struct bgp_afi_stats *as;
+	struct timeval dur;
+	char tokbuf[TOKBUFSIZE], tokbuf2[TOKBUFSIZE], buf[INET6_ADDRSTRLEN + 8];
+	u_int i, n, t, top = gndo->ndo_summary_top;
+	double secs;
+
+	dur.tv_sec = bgp_last.tv_sec - bgp_first.tv_sec;
+	dur.tv_usec = bgp_last.tv_usec - bgp_first.tv_usec;
+	if (dur.tv_usec < 0) {
+		dur.tv_sec--;
+		dur.tv_usec += 1000000;
+	}
+	printf("BGP summary: %" PRIu64 " UPDATE%s, %" PRIu64 " announcement%s, %" PRIu64 " withdrawal%s in %u.%06u seconds",
+	    bgp_updates, PLURAL_SUFFIX(bgp_updates),
+	    bgp_announced, PLURAL_SUFFIX(bgp_announced),
+	    bgp_withdrawn, PLURAL_SUFFIX(bgp_withdrawn),
+	    (unsigned)dur.tv_sec, (unsigned)dur.tv_usec);
+	secs = dur.tv_sec + dur.tv_usec / 1000000.0;
+	if (secs > 0)
+		printf(" (%.1f prefix changes/s)",
+		    (bgp_announced + bgp_withdrawn) / secs);
+	if (bgp_bad_updates != 0)
+		printf(", %" PRIu64 " malformed", bgp_bad_updates);
+	if (bgp_untracked != 0)
+		printf(", %" PRIu64 " untracked prefix%s", bgp_untracked,
+		    bgp_untracked == 1 ? "" : "es");
+	printf("\n");
+	if (bgp_updates == 0)
+		return;
+
+	printf("%12s %12s  %s\n", "announced", "withdrawn", "AFI/SAFI");
+	for (i = 0; i < bgp_afi_count; i++) {
+		as = &bgp_afi_stats[i];
+		printf("%12" PRIu64 " %12" PRIu64 "  %s %s\n",
+		    as->announced, as->withdrawn,
+		    tok2strbuf(af_values, "AFI %u", as->afi,
+			tokbuf, sizeof(tokbuf)),
+		    tok2strbuf(bgp_safi_values, "SAFI %u", as->safi,
+			tokbuf2, sizeof(tokbuf2)));
+	}
+
+	sorted = (struct bgp_peer **)malloc(bgp_peer_count * sizeof(*sorted));
+	if (sorted == NULL)
+		error("bgp_stats_print: malloc");
+	for (i = n = 0; i < BGP_PEER_HASHSIZE; i++)
+		for (peer = bgp_peers[i]; peer != NULL; peer = peer->next)
+			sorted[n++] = peer;
+	qsort(sorted, n, sizeof(*sorted), bgp_peer_cmp);
+	printf("%10s %12s %12s %10s %8s  %s\n", "updates", "announced",
+	    "withdrawn", "prefixes", "flaps", "peer");
+	for (i = 0; i < n && (top == 0 || i < top); i++) {
+		peer = sorted[i];
+		printf("%10" PRIu64 " %12" PRIu64 " %12" PRIu64 " %10u %8u  %s\n",
+		    peer->updates, peer->announced, peer->withdrawn,
+		    peer->prefixes, peer->flaps, bgp_peer_string(peer));
+	}
+
+	printf("%12s  %s\n", "UPDATEs", "AS_PATH length");
+	for (i = 0; i <= BGP_ASPATH_MAX; i++)
+		if (bgp_aspath_len[i] != 0)
+			printf("%12" PRIu64 "  %u%s\n", bgp_aspath_len[i], i,
+			    i == BGP_ASPATH_MAX ? "+" : "");
+
+	memset(&fl, 0, sizeof(fl));
+	for (i = 0; i < n; i++) {
+		fl.peer = sorted[i];
+		for (t = 0; t < BGP_TRIES; t++) {
+			fl.afi = AFNUM_INET + t / 2;
+			bgp_prefix_walk(sorted[i]->trie[t], bgp_flap_add, &fl);
+		}
+	}
+	if (fl.count != 0) {
+		qsort(fl.flaps, fl.count, sizeof(*fl.flaps), bgp_flap_cmp);
+		printf("%8s %10s %10s  %s\n", "flaps", "announced",
+		    "withdrawn", "prefix");
+		for (i = 0; i < fl.count && (top == 0 || i < top); i++) {
+			printf("%8u %10u %10u  %s from %s\n",
+			    fl.flaps[i].pfx->flaps, fl.flaps[i].pfx->announced,
+			    fl.flaps[i].pfx->withdrawn,
+			    bgp_prefix_string(fl.flaps[i].afi, fl.flaps[i].pfx,
+				buf, sizeof(buf)),
+			    bgp_peer_string(fl.flaps[i].peer));
+		}
+	}
+	free(fl.flaps);
+	free(sorted);
+}
+
+static void
+bgp_prefix_clear(struct bgp_prefix *pfx, void *arg _U_)
+{
+	pfx->announced = pfx->withdrawn = pfx->flaps = 0;
+}
+
+/*
+ * Start counting again for the next -o interval.  What is announced
+ * is remembered, so flaps across the boundary are still seen.
+ */
+void
+bgp_stats_reset(void)
+{
+	struct bgp_peer *peer;
+	u_int i, t;
+
+	for (i = 0; i < BGP_PEER_HASHSIZE; i++)
+		for (peer = bgp_peers[i]; peer != NULL; peer = peer->next) {
+			peer->updates = peer->announced = peer->withdrawn = 0;
+			peer->flaps = 0;
+			for (t = 0; t < BGP_TRIES; t++)
+				bgp_prefix_walk(peer->trie[t],
+				    bgp_prefix_clear, NULL);
+		}
+	for (i = 0; i < bgp_afi_count; i++)
+		bgp_afi_stats[i].announced = bgp_afi_stats[i].withdrawn = 0;
+	memset(bgp_aspath_len, 0, sizeof(bgp_aspath_len));
+	bgp_updates = bgp_announced = bgp_withdrawn = 0;
+	bgp_bad_updates = bgp_untracked = 0;
+	bgp_first = bgp_last = gndo->ndo_ts;
+}
+
 /*
  * Local Variables:
  * c-style: whitesmith
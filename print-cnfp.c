@@ -39,6 +39,7 @@
 #include <tcpdump-stdinc.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "interface.h"
@@ -47,6 +48,8 @@
 
 #include "tcp.h"
 #include "ipproto.h"
+#include "scratch.h"
+#include "statecache.h"
 
 struct nfhdr {
 	u_int32_t	ver_cnt;	/* version [15], and # of records */
@@ -183,3 +186,762 @@ cnfp_print(const u_char *cp, const u_char *bp _U_)
 		       EXTRACT_32BITS(&nr->octets), buf);
 	}
 }
+
+/*
+ * Collector mode, for "-o netflow-stats": the flow records of NetFlow
+ * v1, v5, v6, v7 and v9 and IPFIX export datagrams are added up per
+ * source and destination address, per protocol and per exporter,
+ * instead of being printed.
+ *
+ * v9 and IPFIX data records are laid out by templates that exporters
+ * send now and then; templates are kept per exporter (address, port
+ * and source ID or observation domain) in a state cache.  When a
+ * template arrives, it's compiled into the offsets of the fields we
+ * want, so that a data set is decoded with a fixed-stride loop over
+ * its records rather than by walking the template for each of them.
+ * Only templates with variable-length fields are walked.
+ */
+#define CNFP_F_SRC4		0
+#define CNFP_F_DST4		1
+#define CNFP_F_SRC6		2
+#define CNFP_F_DST6		3
+#define CNFP_F_PROTO		4
+#define CNFP_F_OCTETS		5
+#define CNFP_F_PACKETS		6
+#define CNFP_F_COUNT		7
+#define CNFP_F_NONE		0xff
+
+#define CNFP_TEMPLATE_FIELDS	64	/* of a variable-length template */
+#define CNFP_VARLEN		65535	/* field length of a variable-length field */
+#define CNFP_ENTERPRISE		0x8000	/* IPFIX enterprise-specific IE */
+
+#define IPFIX_VERSION		10
+#define IPFIX_HDRLEN		16
+#define NFV9_HDRLEN		20
+
+struct cnfp_field {
+	u_int16_t	off;		/* in the record */
+	u_int16_t	len;		/* 0 if the template doesn't have it */
+};
+
+struct cnfp_template {
+	int		valid;
+	int		options;	/* options template; not flows */
+	u_int16_t	reclen;		/* 0 if some fields have variable length */
+	u_int16_t	minlen;		/* of a record */
+	u_int16_t	nfields;
+	struct cnfp_field field[CNFP_F_COUNT];
+	/* for walking the records of variable-length templates */
+	u_int16_t	len[CNFP_TEMPLATE_FIELDS];
+	u_int8_t	which[CNFP_TEMPLATE_FIELDS];
+};
+
+struct cnfp_exporter_key {
+	u_int8_t	af;
+	u_int8_t	version;
+	u_int16_t	port;
+	u_int8_t	addr[16];
+	u_int32_t	domain;		/* v9 source ID, IPFIX domain, v5 engine */
+};
+
+struct cnfp_template_key {
+	struct cnfp_exporter_key exporter;
+	u_int16_t	id;
+	u_int16_t	pad;
+};
+
+struct cnfp_exporter {
+	struct cnfp_exporter *next;
+	struct cnfp_exporter_key key;
+	u_int64_t	datagrams;
+	u_int64_t	records;
+	u_int64_t	lost;		/* from sequence number gaps */
+	u_int		templates;
+	u_int64_t	notemplate;	/* data sets without a template */
+	int		seq_valid;
+	u_int32_t	next_seq;
+};
+
+struct cnfp_talker {
+	struct cnfp_talker *next;
+	u_int8_t	af;
+	u_int8_t	addr[16];
+	u_int64_t	flows;
+	u_int64_t	packets;
+	u_int64_t	octets;
+};
+
+#define CNFP_EXPORTER_HASHSIZE	64
+#define CNFP_TALKER_HASHSIZE	4096
+#define CNFP_TALKER_MAX		262144	/* sources and destinations tracked */
+#define CNFP_TEMPLATE_MAX	4096
+
+static struct state_cache	*cnfp_templates;
+static struct cnfp_exporter	*cnfp_exporters[CNFP_EXPORTER_HASHSIZE];
+static u_int			cnfp_exporter_count;
+static struct cnfp_talker	*cnfp_sources[CNFP_TALKER_HASHSIZE];
+static struct cnfp_talker	*cnfp_dests[CNFP_TALKER_HASHSIZE];
+static u_int			cnfp_source_count, cnfp_dest_count;
+static u_int64_t		cnfp_datagrams, cnfp_flows, cnfp_packets;
+static u_int64_t		cnfp_octets;
+static u_int64_t		cnfp_notemplate, cnfp_malformed, cnfp_untracked;
+static u_int64_t		cnfp_proto_octets[256];
+static struct timeval		cnfp_first, cnfp_last;
+
+static u_int
+cnfp_hash(const u_int8_t *p, size_t len)
+{
+	u_int h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ p[i]) * 16777619U;
+	return h;
+}
+
+static struct cnfp_exporter *
+cnfp_exporter(const struct cnfp_exporter_key *key)
+{
+	struct cnfp_exporter *exp, **head;
+
+	head = &cnfp_exporters[cnfp_hash((const u_int8_t *)key, sizeof(*key)) %
+	    CNFP_EXPORTER_HASHSIZE];
+	for (exp = *head; exp != NULL; exp = exp->next)
+		if (memcmp(&exp->key, key, sizeof(*key)) == 0)
+			return exp;
+	exp = (struct cnfp_exporter *)pool_alloc(sizeof(*exp));
+	exp->key = *key;
+	exp->next = *head;
+	*head = exp;
+	cnfp_exporter_count++;
+	return exp;
+}
+
+static struct cnfp_talker *
+cnfp_talker(struct cnfp_talker **tab, u_int *countp, int af,
+	    const u_int8_t *addr)
+{
+	struct cnfp_talker *t, **head;
+	size_t len = af == 6 ? 16 : 4;
+
+	head = &tab[cnfp_hash(addr, len) % CNFP_TALKER_HASHSIZE];
+	for (t = *head; t != NULL; t = t->next)
+		if (t->af == af && memcmp(t->addr, addr, len) == 0)
+			return t;
+	if (cnfp_source_count + cnfp_dest_count >= CNFP_TALKER_MAX)
+		return NULL;
+	t = (struct cnfp_talker *)pool_alloc(sizeof(*t));
+	t->af = af;
+	memcpy(t->addr, addr, len);
+	t->next = *head;
+	*head = t;
+	(*countp)++;
+	return t;
+}
+
+static void
+cnfp_stats_flow(int af, const u_int8_t *src, const u_int8_t *dst,
+		u_int proto, u_int64_t packets, u_int64_t octets)
+{
+	struct cnfp_talker *t;
+	int tracked = 1;
+
+	cnfp_flows++;
+	cnfp_packets += packets;
+	cnfp_octets += octets;
+	cnfp_proto_octets[proto] += octets;
+	if (af == 0)
+		return;
+	if ((t = cnfp_talker(cnfp_sources, &cnfp_source_count, af, src)) != NULL) {
+		t->flows++;
+		t->packets += packets;
+		t->octets += octets;
+	} else
+		tracked = 0;
+	if ((t = cnfp_talker(cnfp_dests, &cnfp_dest_count, af, dst)) != NULL) {
+		t->flows++;
+		t->packets += packets;
+		t->octets += octets;
+	} else
+		tracked = 0;
+	if (!tracked)
+		cnfp_untracked++;
+}
+
+/*
+ * Checks the sequence number "seq" of a datagram against what the
+ * exporter's last one said it would be, and sets what the next one
+ * should be, "count" further on.
+ */
+static void
+cnfp_stats_seq(struct cnfp_exporter *exp, u_int32_t seq, u_int32_t count)
+{
+	u_int32_t gap;
+
+	if (exp->seq_valid) {
+		gap = seq - exp->next_seq;
+		/* ignore reordering and restarts */
+		if (gap != 0 && gap < 0x10000000)
+			exp->lost += gap;
+	}
+	exp->next_seq = seq + count;
+	exp->seq_valid = 1;
+}
+
+/* The flow record formats of versions 1, 5, 6 and 7 */
+static void
+cnfp_stats_fixed(struct cnfp_exporter_key *key, u_int ver,
+		 const u_char *dat, const u_char *ep)
+{
+	struct cnfp_exporter *exp;
+	const u_char *r;
+	u_int hdrlen, reclen, count, i;
+
+	hdrlen = ver == 1 ? 16 : 24;
+	reclen = ver == 1 || ver == 5 ? 48 : 52;
+	if (dat + hdrlen > ep) {
+		cnfp_malformed++;
+		return;
+	}
+	count = EXTRACT_16BITS(dat + 2);
+	if (ver == 5)
+		key->domain = EXTRACT_16BITS(dat + 20);	/* engine type and ID */
+	exp = cnfp_exporter(key);
+	exp->datagrams++;
+	if (ver != 1)
+		cnfp_stats_seq(exp, EXTRACT_32BITS(dat + 16), count);
+
+	/* the fields we want are where struct nfrec has them */
+	for (i = 0, r = dat + hdrlen; i < count && r + reclen <= ep;
+	    i++, r += reclen)
+		cnfp_stats_flow(4, r, r + 4, r[38], EXTRACT_32BITS(r + 16),
+		    EXTRACT_32BITS(r + 20));
+	exp->records += i;
+	if (i < count)
+		cnfp_malformed++;
+}
+
+/* Which of the fields we want IE "ie", of "len" bytes, is */
+static u_int
+cnfp_ie_field(u_int ie, u_int len)
+{
+	switch (ie) {
+
+	case 1:		/* octetDeltaCount */
+	case 85:	/* octetTotalCount */
+		return len >= 1 && len <= 8 ? CNFP_F_OCTETS : CNFP_F_NONE;
+
+	case 2:		/* packetDeltaCount */
+	case 86:	/* packetTotalCount */
+		return len >= 1 && len <= 8 ? CNFP_F_PACKETS : CNFP_F_NONE;
+
+	case 4:		/* protocolIdentifier */
+		return len == 1 ? CNFP_F_PROTO : CNFP_F_NONE;
+
+	case 8:		/* sourceIPv4Address */
+		return len == 4 ? CNFP_F_SRC4 : CNFP_F_NONE;
+
+	case 12:	/* destinationIPv4Address */
+		return len == 4 ? CNFP_F_DST4 : CNFP_F_NONE;
+
+	case 27:	/* sourceIPv6Address */
+		return len == 16 ? CNFP_F_SRC6 : CNFP_F_NONE;
+
+	case 28:	/* destinationIPv6Address */
+		return len == 16 ? CNFP_F_DST6 : CNFP_F_NONE;
+	}
+	return CNFP_F_NONE;
+}
+
+static u_int64_t
+cnfp_uint(const u_char *p, u_int len)
+{
+	u_int64_t v;
+
+	switch (len) {
+	case 1:
+		return p[0];
+	case 2:
+		return EXTRACT_16BITS(p);
+	case 4:
+		return EXTRACT_32BITS(p);
+	case 8:
+		return EXTRACT_64BITS(p);
+	}
+	for (v = 0; len != 0; len--)
+		v = (v << 8) | *p++;
+	return v;
+}
+
+/*
+ * Reads a v9 (if not "ipfix") or IPFIX template, or options template
+ * (if "options"), from "p", and adds it to the cache.  Returns where
+ * the next template starts, or NULL if the template is cut short.
+ */
+static const u_char *
+cnfp_template_add(struct cnfp_exporter *exp, const u_char *p,
+		  const u_char *end, int ipfix, int options)
+{
+	struct cnfp_template_key key;
+	struct cnfp_template t, *tp;
+	u_int nfields, ie, len, i, which, off = 0, var = 0;
+
+	if (p + 4 > end)
+		return NULL;
+	memset(&key, 0, sizeof(key));
+	key.exporter = exp->key;
+	key.id = EXTRACT_16BITS(p);
+	nfields = EXTRACT_16BITS(p + 2);
+	p += 4;
+	if (options && !ipfix) {
+		/* scope and option lengths, in bytes, not fields */
+		if (p + 2 > end)
+			return NULL;
+		nfields = (nfields + EXTRACT_16BITS(p)) / 4;
+		p += 2;
+	} else if (options) {
+		/* scope field count */
+		if (nfields != 0) {
+			if (p + 2 > end)
+				return NULL;
+			p += 2;
+		}
+	}
+	if (cnfp_templates == NULL)
+		cnfp_templates = state_cache_create(gndo, sizeof(key),
+		    sizeof(t), CNFP_TEMPLATE_MAX, 0);
+	if (nfields == 0) {
+		/* an IPFIX template withdrawal */
+		tp = (struct cnfp_template *)state_cache_lookup(gndo,
+		    cnfp_templates, &key);
+		if (tp != NULL)
+			tp->valid = 0;
+		return p;
+	}
+
+	memset(&t, 0, sizeof(t));
+	t.options = options;
+	t.nfields = nfields;
+	for (i = 0; i < nfields; i++) {
+		if (p + 4 > end)
+			return NULL;
+		ie = EXTRACT_16BITS(p);
+		len = EXTRACT_16BITS(p + 2);
+		p += 4;
+		which = CNFP_F_NONE;
+		if (ipfix && (ie & CNFP_ENTERPRISE)) {
+			if (p + 4 > end)
+				return NULL;
+			p += 4;
+		} else if (!options)
+			which = cnfp_ie_field(ie, len);
+		if (i < CNFP_TEMPLATE_FIELDS) {
+			t.len[i] = len;
+			t.which[i] = which;
+		}
+		if (ipfix && len == CNFP_VARLEN) {
+			var = 1;
+			off += 1;
+			continue;
+		}
+		if (which != CNFP_F_NONE && t.field[which].len == 0) {
+			t.field[which].off = off;
+			t.field[which].len = len;
+		}
+		off += len;
+	}
+	t.minlen = off > 65535 ? 65535 : off;
+	t.reclen = var ? 0 : t.minlen;
+	/* records we can't find the end of, or that take no room */
+	t.valid = t.minlen != 0 && (!var || nfields <= CNFP_TEMPLATE_FIELDS);
+
+	tp = (struct cnfp_template *)state_cache_enter(gndo, cnfp_templates,
+	    &key);
+	*tp = t;
+	exp->templates++;
+	return p;
+}
+
+/* Adds up a record laid out by a template without variable-length fields */
+static void
+cnfp_stats_record(const struct cnfp_template *t, const u_char *r)
+{
+	const struct cnfp_field *f = t->field;
+	u_int64_t packets, octets;
+	u_int proto;
+
+	packets = f[CNFP_F_PACKETS].len ?
+	    cnfp_uint(r + f[CNFP_F_PACKETS].off, f[CNFP_F_PACKETS].len) : 0;
+	octets = f[CNFP_F_OCTETS].len ?
+	    cnfp_uint(r + f[CNFP_F_OCTETS].off, f[CNFP_F_OCTETS].len) : 0;
+	proto = f[CNFP_F_PROTO].len ? r[f[CNFP_F_PROTO].off] : 0;
+	if (f[CNFP_F_SRC4].len && f[CNFP_F_DST4].len)
+		cnfp_stats_flow(4, r + f[CNFP_F_SRC4].off,
+		    r + f[CNFP_F_DST4].off, proto, packets, octets);
+	else if (f[CNFP_F_SRC6].len && f[CNFP_F_DST6].len)
+		cnfp_stats_flow(6, r + f[CNFP_F_SRC6].off,
+		    r + f[CNFP_F_DST6].off, proto, packets, octets);
+	else
+		cnfp_stats_flow(0, NULL, NULL, proto, packets, octets);
+}
+
+/*
+ * Adds up a record laid out by a template with variable-length fields;
+ * returns where the next one starts, or NULL if it runs past "end".
+ */
+static const u_char *
+cnfp_stats_varlen_record(const struct cnfp_template *t, const u_char *r,
+			 const u_char *end)
+{
+	struct cnfp_template fixed;
+	const u_char *p = r;
+	u_int i, len;
+
+	/* make a fixed-length template for this record */
+	memset(fixed.field, 0, sizeof(fixed.field));
+	for (i = 0; i < t->nfields; i++) {
+		len = t->len[i];
+		if (len == CNFP_VARLEN) {
+			if (p + 1 > end)
+				return NULL;
+			len = *p++;
+			if (len == 255) {
+				if (p + 2 > end)
+					return NULL;
+				len = EXTRACT_16BITS(p);
+				p += 2;
+			}
+		}
+		if (p + len > end)
+			return NULL;
+		if (t->which[i] != CNFP_F_NONE &&
+		    fixed.field[t->which[i]].len == 0) {
+			fixed.field[t->which[i]].off = p - r;
+			fixed.field[t->which[i]].len = len;
+		}
+		p += len;
+	}
+	if (!t->options)
+		cnfp_stats_record(&fixed, r);
+	return p;
+}
+
+/*
+ * Adds up the records of data set "id", from "p" to "end"; returns the
+ * number of records, or -1 if there's no template for them.
+ */
+static int
+cnfp_stats_data(struct cnfp_exporter *exp, u_int id, const u_char *p,
+		const u_char *end)
+{
+	struct cnfp_template_key key;
+	const struct cnfp_template *t = NULL;
+	const u_char *next;
+	u_int n, i;
+
+	memset(&key, 0, sizeof(key));
+	key.exporter = exp->key;
+	key.id = id;
+	if (cnfp_templates != NULL)
+		t = (const struct cnfp_template *)state_cache_lookup(gndo,
+		    cnfp_templates, &key);
+	if (t == NULL || !t->valid) {
+		exp->notemplate++;
+		cnfp_notemplate++;
+		return -1;
+	}
+
+	if (t->reclen != 0) {
+		/* what's left over is padding */
+		n = (end - p) / t->reclen;
+		if (!t->options)
+			for (i = 0; i < n; i++, p += t->reclen)
+				cnfp_stats_record(t, p);
+	} else {
+		for (n = 0; end - p >= t->minlen; n++, p = next)
+			if ((next = cnfp_stats_varlen_record(t, p, end)) == NULL) {
+				cnfp_malformed++;
+				break;
+			}
+	}
+	if (!t->options)
+		exp->records += n;
+	return n;
+}
+
+/* v9 (if not "ipfix") and IPFIX messages */
+static void
+cnfp_stats_sets(struct cnfp_exporter_key *key, int ipfix,
+		const u_char *dat, const u_char *ep)
+{
+	struct cnfp_exporter *exp;
+	const u_char *p, *set, *end;
+	u_int hdrlen, id, setlen;
+	u_int32_t seq, records = 0;
+	int n, complete = 1;
+
+	hdrlen = ipfix ? IPFIX_HDRLEN : NFV9_HDRLEN;
+	if (dat + hdrlen > ep) {
+		cnfp_malformed++;
+		return;
+	}
+	if (ipfix) {
+		/* the message length, which must fit in what was captured */
+		if (dat + EXTRACT_16BITS(dat + 2) < ep)
+			ep = dat + EXTRACT_16BITS(dat + 2);
+		seq = EXTRACT_32BITS(dat + 8);
+		key->domain = EXTRACT_32BITS(dat + 12);
+	} else {
+		seq = EXTRACT_32BITS(dat + 12);
+		key->domain = EXTRACT_32BITS(dat + 16);
+	}
+	exp = cnfp_exporter(key);
+	exp->datagrams++;
+
+	for (set = dat + hdrlen; set + 4 <= ep; set += setlen) {
+		id = EXTRACT_16BITS(set);
+		setlen = EXTRACT_16BITS(set + 2);
+		if (setlen < 4 || set + setlen > ep) {
+			cnfp_malformed++;
+			complete = 0;
+			break;
+		}
+		end = set + setlen;
+		p = set + 4;
+		if (id == (ipfix ? 2 : 0) || id == (ipfix ? 3 : 1)) {
+			/* templates, until what's left is padding */
+			while (p != NULL && end - p >= 4)
+				p = cnfp_template_add(exp, p, end, ipfix,
+				    id == (ipfix ? 3 : 1));
+			if (p == NULL)
+				cnfp_malformed++;
+		} else if (id >= 256) {
+			n = cnfp_stats_data(exp, id, p, end);
+			if (n < 0)
+				complete = 0;
+			else
+				records += n;
+		}
+	}
+
+	/*
+	 * An IPFIX sequence number counts data records, which we can
+	 * only do if we had all of the templates; v9 ones count
+	 * datagrams.
+	 */
+	if (!ipfix)
+		cnfp_stats_seq(exp, seq, 1);
+	else if (complete)
+		cnfp_stats_seq(exp, seq, records);
+	else
+		exp->seq_valid = 0;
+}
+
+/*
+ * Adds up the export datagram "dat", sent from port "sport" of the
+ * exporter at "src" of address family "af".
+ */
+void
+cnfp_stats_packet(const u_char *dat, u_int length, int af,
+		  const u_char *src, u_int sport)
+{
+	struct cnfp_exporter_key key;
+	const u_char *ep;
+	u_int ver;
+
+	if (cnfp_first.tv_sec == 0 && cnfp_first.tv_usec == 0)
+		cnfp_first = gndo->ndo_ts;
+	cnfp_last = gndo->ndo_ts;
+	cnfp_datagrams++;
+
+	ep = dat + length;
+	if (ep > snapend)
+		ep = snapend;
+	if (dat + 4 > ep) {
+		cnfp_malformed++;
+		return;
+	}
+	memset(&key, 0, sizeof(key));
+	key.af = af;
+	memcpy(key.addr, src, af == 6 ? 16 : 4);
+	key.port = sport;
+	ver = EXTRACT_16BITS(dat);
+	key.version = ver;
+	switch (ver) {
+
+	case 1:
+	case 5:
+	case 6:
+	case 7:
+		cnfp_stats_fixed(&key, ver, dat, ep);
+		break;
+
+	case 9:
+		cnfp_stats_sets(&key, 0, dat, ep);
+		break;
+
+	case IPFIX_VERSION:
+		cnfp_stats_sets(&key, 1, dat, ep);
+		break;
+
+	default:
+		cnfp_malformed++;
+		break;
+	}
+}
+
+static int
+cnfp_talker_cmp(const void *va, const void *vb)
+{
+	const struct cnfp_talker *a = *(const struct cnfp_talker * const *)va;
+	const struct cnfp_talker *b = *(const struct cnfp_talker * const *)vb;
+
+	if (a->octets != b->octets)
+		return a->octets < b->octets ? 1 : -1;
+	if (a->flows != b->flows)
+		return a->flows < b->flows ? 1 : -1;
+	if (a->af != b->af)
+		return a->af < b->af ? -1 : 1;
+	return memcmp(a->addr, b->addr, sizeof(a->addr));
+}
+
+static const char *
+cnfp_addr_string(int af, const u_int8_t *addr)
+{
+#ifdef INET6
+	if (af == 6)
+		return ip6addr_string(addr);
+#endif
+	return ipaddr_string(addr);
+}
+
+static void
+cnfp_talkers_print(struct cnfp_talker **tab, u_int count, const char *what)
+{
+	struct cnfp_talker **sorted, *t;
+	u_int i, n, top = gndo->ndo_summary_top;
+
+	sorted = (struct cnfp_talker **)malloc((count + 1) * sizeof(*sorted));
+	if (sorted == NULL)
+		error("cnfp_stats_print: malloc");
+	for (i = n = 0; i < CNFP_TALKER_HASHSIZE; i++)
+		for (t = tab[i]; t != NULL; t = t->next)
+			if (t->flows != 0)
+				sorted[n++] = t;
+	qsort(sorted, n, sizeof(*sorted), cnfp_talker_cmp);
+	if (top != 0 && n > top)
+		n = top;
+	printf("%10s %14s %16s  %s\n", "flows", "packets", "octets", what);
+	for (i = 0; i < n; i++) {
+		t = sorted[i];
+		printf("%10" PRIu64 " %14" PRIu64 " %16" PRIu64 "  %s\n",
+		    t->flows, t->packets, t->octets,
+		    cnfp_addr_string(t->af, t->addr));
+	}
+	free(sorted);
+}
+
+void
+cnfp_stats_print(void)
+{
+	struct cnfp_exporter *exp;
+	struct protoent *pent;
+	struct timeval dur;
+	u_int i;
+	double secs;
+
+	dur.tv_sec = cnfp_last.tv_sec - cnfp_first.tv_sec;
+	dur.tv_usec = cnfp_last.tv_usec - cnfp_first.tv_usec;
+	if (dur.tv_usec < 0) {
+		dur.tv_sec--;
+		dur.tv_usec += 1000000;
+	}
+	printf("NetFlow summary: %" PRIu64 " datagram%s, %" PRIu64 " flow%s, %" PRIu64 " packet%s, %" PRIu64 " octet%s in %u.%06u seconds",
+	    cnfp_datagrams, PLURAL_SUFFIX(cnfp_datagrams),
+	    cnfp_flows, PLURAL_SUFFIX(cnfp_flows),
+	    cnfp_packets, PLURAL_SUFFIX(cnfp_packets),
+	    cnfp_octets, PLURAL_SUFFIX(cnfp_octets),
+	    (unsigned)dur.tv_sec, (unsigned)dur.tv_usec);
+	secs = dur.tv_sec + dur.tv_usec / 1000000.0;
+	if (secs > 0)
+		printf(" (%.1f flows/s)", cnfp_flows / secs);
+	if (cnfp_notemplate != 0)
+		printf(", %" PRIu64 " data set%s without a template",
+		    cnfp_notemplate, PLURAL_SUFFIX(cnfp_notemplate));
+	if (cnfp_malformed != 0)
+		printf(", %" PRIu64 " malformed", cnfp_malformed);
+	if (cnfp_untracked != 0)
+		printf(", %" PRIu64 " untracked flow%s", cnfp_untracked,
+		    PLURAL_SUFFIX(cnfp_untracked));
+	printf("\n");
+	if (cnfp_datagrams == 0)
+		return;
+
+	printf("%10s %10s %10s %10s  %-7s %s\n", "datagrams", "flows",
+	    "templates", "lost", "version", "exporter");
+	for (i = 0; i < CNFP_EXPORTER_HASHSIZE; i++)
+		for (exp = cnfp_exporters[i]; exp != NULL; exp = exp->next) {
+			if (exp->datagrams == 0)
+				continue;
+			printf("%10" PRIu64 " %10" PRIu64 " %10u %10" PRIu64 "  %-7s %s.%u",
+			    exp->datagrams, exp->records, exp->templates,
+			    exp->lost,
+			    exp->key.version == IPFIX_VERSION ? "IPFIX" :
+			    exp->key.version == 9 ? "v9" :
+			    exp->key.version == 7 ? "v7" :
+			    exp->key.version == 6 ? "v6" :
+			    exp->key.version == 5 ? "v5" : "v1",
+			    cnfp_addr_string(exp->key.af, exp->key.addr),
+			    exp->key.port);
+			if (exp->key.domain != 0)
+				printf(" domain %u", exp->key.domain);
+			if (exp->notemplate != 0)
+				printf(", %" PRIu64 " data set%s without a template",
+				    exp->notemplate,
+				    PLURAL_SUFFIX(exp->notemplate));
+			printf("\n");
+		}
+	if (cnfp_flows == 0)
+		return;
+
+	printf("%16s  %s\n", "octets", "protocol");
+	for (i = 0; i < 256; i++) {
+		if (cnfp_proto_octets[i] == 0)
+			continue;
+		pent = nflag ? NULL : getprotobynumber(i);
+		if (pent != NULL)
+			printf("%16" PRIu64 "  %s\n", cnfp_proto_octets[i],
+			    pent->p_name);
+		else
+			printf("%16" PRIu64 "  %u\n", cnfp_proto_octets[i], i);
+	}
+	if (cnfp_source_count != 0)
+		cnfp_talkers_print(cnfp_sources, cnfp_source_count, "source");
+	if (cnfp_dest_count != 0)
+		cnfp_talkers_print(cnfp_dests, cnfp_dest_count, "destination");
+}
+
+void
+cnfp_stats_reset(void)
+{
+	struct cnfp_exporter *exp;
+	struct cnfp_talker *t;
+	u_int i;
+
+	for (i = 0; i < CNFP_EXPORTER_HASHSIZE; i++)
+		for (exp = cnfp_exporters[i]; exp != NULL; exp = exp->next) {
+			exp->datagrams = exp->records = exp->lost = 0;
+			exp->notemplate = 0;
+			exp->templates = 0;
+		}
+	for (i = 0; i < CNFP_TALKER_HASHSIZE; i++) {
+		for (t = cnfp_sources[i]; t != NULL; t = t->next)
+			t->flows = t->packets = t->octets = 0;
+		for (t = cnfp_dests[i]; t != NULL; t = t->next)
+			t->flows = t->packets = t->octets = 0;
+	}
+	cnfp_datagrams = cnfp_flows = cnfp_packets = cnfp_octets = 0;
+	cnfp_notemplate = cnfp_malformed = cnfp_untracked = 0;
+	memset(cnfp_proto_octets, 0, sizeof(cnfp_proto_octets));
+	cnfp_first = cnfp_last = gndo->ndo_ts;
+}
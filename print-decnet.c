@@ -40,6 +40,7 @@ struct rtentry;
 #include "extract.h"
 #include "interface.h"
 #include "addrtoname.h"
+#include "scratch.h"
 
 static const char tstr[] = "[|decnet]";
 
@@ -856,9 +857,8 @@ dnnum_string(u_short dnaddr)
 	int area = (u_short)(dnaddr & AREAMASK) >> AREASHIFT;
 	int node = dnaddr & NODEMASK;
 
-	str = (char *)malloc(siz = sizeof("00.0000"));
-	if (str == NULL)
-		error("dnnum_string: malloc");
+	/* the result is kept in the name cache */
+	str = (char *)pool_alloc(siz = sizeof("00.0000"));
 	snprintf(str, siz, "%d.%d", area, node);
 	return(str);
 }
@@ -871,7 +871,7 @@ dnname_string(u_short dnaddr)
 
 	dna.a_len = sizeof(short);
 	memcpy((char *)dna.a_addr, (char *)&dnaddr, sizeof(short));
-	return (strdup(dnet_htoa(&dna)));
+	return (pool_strdup(dnet_htoa(&dna)));
 #else
 	return(dnnum_string(dnaddr));	/* punt */
 #endif
@@ -27,12 +27,16 @@
 
 #include "nameser.h"
 
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "interface.h"
 #include "addrtoname.h"
 #include "extract.h"                    /* must come after interface.h */
+#include "scratch.h"
+#include "statecache.h"
 
 static const char *ns_ops[] = {
 	"", " inv_q", " stat", " op3", " notify", " update", " op6", " op7",
@@ -79,9 +83,125 @@ ns_nskip(register const u_char *cp)
 	return (cp);
 }
 
+/*
+ * Names are decoded into a buffer rather than printed a label at a
+ * time.  While ns_print() is printing a message, the text of each name
+ * decoded in it is kept, and the offset of each of the name's labels is
+ * mapped to the text of the rest of the name from that label on.  A
+ * compression pointer to a label that has already been decoded copies
+ * that text instead of walking the labels again, so each target of a
+ * pointer is decoded once per message, however many records use it.
+ *
+ * A walk that processes as many characters as there are in the message
+ * must be looking at some of them again, so it is stopped as a loop;
+ * the characters a remembered suffix took to decode count towards that.
+ */
+#define NS_NAME_OFFSETS	0x4000		/* offsets a pointer can reach */
+#define NS_NAME_TEXT	65536		/* text remembered per message */
+#define NS_NAME_BUF	(4 * MAXDNAME)	/* text buffered per name */
+#define NS_NAME_LABELS	128		/* labels remembered per name */
+
+struct ns_suffix {
+	u_int	gen;		/* ns_name_gen when it was set */
+	u_int	start;		/* in ns_name_text */
+	u_int	len;
+	u_int	work;		/* characters processed to decode it */
+};
+
+struct ns_label {
+	u_int	off;		/* in the message */
+	u_int	pos;		/* in the name's text */
+	u_int	chars;		/* characters processed before it */
+};
+
+struct ns_namebuf {
+	char	buf[NS_NAME_BUF];
+	u_int	len;
+	int	flushed;	/* some of the text has been written out */
+};
+
+static const u_char *ns_name_msg;	/* message ns_print() is printing */
+static u_int ns_name_gen;
+static struct ns_suffix ns_suffixes[NS_NAME_OFFSETS];
+static char ns_name_text[NS_NAME_TEXT];
+static u_int ns_name_textlen;
+
+static void
+ns_nb_flush(struct ns_namebuf *nb)
+{
+	fwrite(nb->buf, 1, nb->len, stdout);
+	nb->len = 0;
+	nb->flushed = 1;
+}
+
+static void
+ns_nb_write(struct ns_namebuf *nb, const char *s, u_int len)
+{
+	u_int n;
+
+	while (len != 0) {
+		if (nb->len == sizeof(nb->buf))
+			ns_nb_flush(nb);
+		n = sizeof(nb->buf) - nb->len;
+		if (n > len)
+			n = len;
+		memcpy(nb->buf + nb->len, s, n);
+		nb->len += n;
+		s += n;
+		len -= n;
+	}
+}
+
+static void
+ns_nb_putc(struct ns_namebuf *nb, int c)
+{
+	if (nb->len == sizeof(nb->buf))
+		ns_nb_flush(nb);
+	nb->buf[nb->len++] = c;
+}
+
+static void
+ns_nb_printf(struct ns_namebuf *nb, const char *fmt, ...)
+{
+	char buf[32];
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (n > 0)
+		ns_nb_write(nb, buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+}
+
+/* as fn_printn(), to the buffer */
+static int
+ns_nb_printn(struct ns_namebuf *nb, const u_char *s, u_int n)
+{
+	u_char c;
+
+	while (n > 0 && s < snapend) {
+		n--;
+		c = *s++;
+		if (nb->len + 4 > sizeof(nb->buf))
+			ns_nb_flush(nb);
+		if (!ND_ISASCII(c)) {
+			c = ND_TOASCII(c);
+			nb->buf[nb->len++] = 'M';
+			nb->buf[nb->len++] = '-';
+		}
+		if (!ND_ISPRINT(c)) {
+			c ^= 0x40;	/* DEL to ?, others to alpha */
+			nb->buf[nb->len++] = '^';
+		}
+		nb->buf[nb->len++] = c;
+	}
+	return (n == 0) ? 0 : 1;
+}
+
 /* print a <domain-name> */
 static const u_char *
-blabel_print(const u_char *cp)
+blabel_print(struct ns_namebuf *nb, const u_char *cp)
 {
 	int bitlen, slen, b;
 	const u_char *bitp, *lim;
@@ -95,29 +215,29 @@ blabel_print(const u_char *cp)
 	lim = cp + 1 + slen;
 
 	/* print the bit string as a hex string */
-	printf("\\[x");
+	ns_nb_write(nb, "\\[x", 3);
 	for (bitp = cp + 1, b = bitlen; bitp < lim && b > 7; b -= 8, bitp++) {
 		TCHECK(*bitp);
-		printf("%02x", *bitp);
+		ns_nb_printf(nb, "%02x", *bitp);
 	}
 	if (b > 4) {
 		TCHECK(*bitp);
 		tc = *bitp++;
-		printf("%02x", tc & (0xff << (8 - b)));
+		ns_nb_printf(nb, "%02x", tc & (0xff << (8 - b)));
 	} else if (b > 0) {
 		TCHECK(*bitp);
 		tc = *bitp++;
-		printf("%1x", ((tc >> 4) & 0x0f) & (0x0f << (4 - b)));
+		ns_nb_printf(nb, "%1x", ((tc >> 4) & 0x0f) & (0x0f << (4 - b)));
 	}
-	printf("/%d]", bitlen);
+	ns_nb_printf(nb, "/%d]", bitlen);
 	return lim;
 trunc:
-	printf(".../%d]", bitlen);
+	ns_nb_printf(nb, ".../%d]", bitlen);
 	return NULL;
 }
 
 static int
-labellen(const u_char *cp)
+labellen(struct ns_namebuf *nb, const u_char *cp)
 {
 	register u_int i;
 
@@ -127,7 +247,7 @@ labellen(const u_char *cp)
 	if ((i & INDIR_MASK) == EDNS0_MASK) {
 		int bitlen, elt;
 		if ((elt = (i & ~INDIR_MASK)) != EDNS0_ELT_BITLABEL) {
-			printf("<ELT %d>", elt);
+			ns_nb_printf(nb, "<ELT %d>", elt);
 			return(-1);
 		}
 		if (!TTEST2(*(cp + 1), 1))
@@ -139,21 +259,70 @@ labellen(const u_char *cp)
 		return(i);
 }
 
+/* Notes that the label at "cp" starts at the current end of the text */
+static void
+ns_name_label(struct ns_label *labels, u_int *nlabels, const u_char *cp,
+	      const u_char *bp, const struct ns_namebuf *nb, int chars)
+{
+	struct ns_label *lp;
+
+	if (cp < bp || cp - bp >= NS_NAME_OFFSETS || *nlabels == NS_NAME_LABELS)
+		return;
+	lp = &labels[(*nlabels)++];
+	lp->off = cp - bp;
+	lp->pos = nb->len;
+	lp->chars = chars;
+}
+
+/*
+ * Keeps the text of a name that was decoded completely, for the
+ * labels noted while decoding it.
+ */
+static void
+ns_name_remember(const struct ns_label *labels, u_int nlabels,
+		 const struct ns_namebuf *nb, int chars)
+{
+	struct ns_suffix *sfx;
+	u_int i;
+
+	if (nb->flushed || nlabels == 0 ||
+	    nb->len > sizeof(ns_name_text) - ns_name_textlen)
+		return;
+	memcpy(ns_name_text + ns_name_textlen, nb->buf, nb->len);
+	for (i = 0; i < nlabels; i++) {
+		sfx = &ns_suffixes[labels[i].off];
+		sfx->gen = ns_name_gen;
+		sfx->start = ns_name_textlen + labels[i].pos;
+		sfx->len = nb->len - labels[i].pos;
+		sfx->work = chars - labels[i].chars;
+	}
+	ns_name_textlen += nb->len;
+}
+
 const u_char *
 ns_nprint(register const u_char *cp, register const u_char *bp)
 {
+	struct ns_namebuf nb;
+	struct ns_label labels[NS_NAME_LABELS];
+	const struct ns_suffix *sfx;
+	u_int nlabels = 0;
 	register u_int i, l;
 	register const u_char *rp = NULL;
 	register int compress = 0;
 	int chars_processed;
 	int elt;
 	int data_size = snapend - bp;
+	int memo = (bp == ns_name_msg);
 
-	if ((l = labellen(cp)) == (u_int)-1)
-		return(NULL);
+	nb.len = 0;
+	nb.flushed = 0;
+	if ((l = labellen(&nb, cp)) == (u_int)-1)
+		goto fail;
 	if (!TTEST2(*cp, 1))
-		return(NULL);
+		goto fail;
 	chars_processed = 1;
+	if (memo)
+		ns_name_label(labels, &nlabels, cp, bp, &nb, chars_processed);
 	if (((i = *cp++) & INDIR_MASK) != INDIR_MASK) {
 		compress = 0;
 		rp = cp + l;
@@ -167,14 +336,29 @@ ns_nprint(register const u_char *cp, register const u_char *bp)
 					compress = 1;
 				}
 				if (!TTEST2(*cp, 1))
-					return(NULL);
+					goto fail;
 				cp = bp + (((i << 8) | *cp) & 0x3fff);
-				if ((l = labellen(cp)) == (u_int)-1)
-					return(NULL);
+				chars_processed++;
+				sfx = &ns_suffixes[cp - bp];
+				if (memo && sfx->gen == ns_name_gen) {
+					/* decoded before; use its text */
+					chars_processed += sfx->work;
+					if (chars_processed >= data_size) {
+						ns_nb_write(&nb, "<LOOP>", 6);
+						goto fail;
+					}
+					ns_nb_write(&nb, ns_name_text + sfx->start,
+					    sfx->len);
+					break;
+				}
+				if ((l = labellen(&nb, cp)) == (u_int)-1)
+					goto fail;
 				if (!TTEST2(*cp, 1))
-					return(NULL);
+					goto fail;
+				if (memo)
+					ns_name_label(labels, &nlabels, cp, bp,
+					    &nb, chars_processed);
 				i = *cp++;
-				chars_processed++;
 
 				/*
 				 * If we've looked at every character in
@@ -183,8 +367,8 @@ ns_nprint(register const u_char *cp, register const u_char *bp)
 				 * which means we're looping.
 				 */
 				if (chars_processed >= data_size) {
-					printf("<LOOP>");
-					return (NULL);
+					ns_nb_write(&nb, "<LOOP>", 6);
+					goto fail;
 				}
 				continue;
 			}
@@ -192,34 +376,45 @@ ns_nprint(register const u_char *cp, register const u_char *bp)
 				elt = (i & ~INDIR_MASK);
 				switch(elt) {
 				case EDNS0_ELT_BITLABEL:
-					if (blabel_print(cp) == NULL)
-						return (NULL);
+					if (blabel_print(&nb, cp) == NULL)
+						goto fail;
 					break;
 				default:
 					/* unknown ELT */
-					printf("<ELT %d>", elt);
-					return(NULL);
+					ns_nb_printf(&nb, "<ELT %d>", elt);
+					goto fail;
 				}
 			} else {
-				if (fn_printn(cp, l, snapend))
-					return(NULL);
+				if (ns_nb_printn(&nb, cp, l))
+					goto fail;
 			}
 
 			cp += l;
 			chars_processed += l;
-			putchar('.');
-			if ((l = labellen(cp)) == (u_int)-1)
-				return(NULL);
+			ns_nb_putc(&nb, '.');
+			if ((l = labellen(&nb, cp)) == (u_int)-1)
+				goto fail;
 			if (!TTEST2(*cp, 1))
-				return(NULL);
-			i = *cp++;
+				goto fail;
 			chars_processed++;
+			if (memo)
+				ns_name_label(labels, &nlabels, cp, bp, &nb,
+				    chars_processed);
+			i = *cp++;
 			if (!compress)
 				rp += l + 1;
 		}
-	else
-		putchar('.');
+	else {
+		ns_nb_putc(&nb, '.');
+		memo = 0;	/* a pointer to it prints nothing */
+	}
+	if (memo)
+		ns_name_remember(labels, nlabels, &nb, chars_processed);
+	fwrite(nb.buf, 1, nb.len, stdout);
 	return (rp);
+fail:
+	fwrite(nb.buf, 1, nb.len, stdout);
+	return (NULL);
 }
 
 /* print a <character-string> */
@@ -580,6 +775,13 @@ ns_print(register const u_char *bp, u_int length, int is_mdns)
 
 	np = (const HEADER *)bp;
 	TCHECK(*np);
+	/* names are remembered for this message only */
+	ns_name_msg = bp;
+	ns_name_textlen = 0;
+	if (++ns_name_gen == 0) {
+		memset(ns_suffixes, 0, sizeof(ns_suffixes));
+		ns_name_gen = 1;
+	}
 	/* get the byte-order right */
 	qdcount = EXTRACT_16BITS(&np->qdcount);
 	ancount = EXTRACT_16BITS(&np->ancount);
@@ -738,9 +940,572 @@ ns_print(register const u_char *bp, u_int length, int is_mdns)
 		}
 	}
 	printf(" (%d)", length);
+	ns_name_msg = NULL;
 	return;
 
   trunc:
 	printf("[|domain]");
+	ns_name_msg = NULL;
 	return;
 }
+
+/*
+ * Analytics mode, for "-o dns-stats": DNS messages are counted instead
+ * of being printed, and nothing is formatted until a report is printed.
+ *
+ * Queries are remembered in a state cache keyed by client address and
+ * port, server address and ID, so that each response can be matched
+ * to its query; the time between them goes into a latency histogram
+ * for the server.  Response codes are counted per server.
+ *
+ * Query names are counted in a count-min sketch: each name increments
+ * one counter in each of DNS_CMS_DEPTH rows, and its count is
+ * estimated as the smallest of them, which is never too low and is
+ * close for the busy names.  The names with the highest estimates are
+ * kept, in wire format, in a small table of candidates; they're only
+ * turned into text for the report.  There are few enough query types
+ * to count each of them exactly.
+ */
+#define DNS_CMS_DEPTH		4
+#define DNS_CMS_WIDTH		16384	/* a power of 2 */
+#define DNS_NAME_CANDIDATES	256
+#define DNS_SERVER_HASHSIZE	256
+#define DNS_SERVER_MAX		65536
+
+/* Upper bounds, in microseconds, of the latency histogram buckets */
+static const u_int32_t dns_latency_bounds[] = {
+	100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000,
+	200000, 500000, 1000000
+};
+#define DNS_LATENCY_BUCKETS \
+	(sizeof(dns_latency_bounds) / sizeof(dns_latency_bounds[0]) + 1)
+
+static const char *dns_latency_labels[DNS_LATENCY_BUCKETS] = {
+	"0.1ms", "0.2ms", "0.5ms", "1ms", "2ms", "5ms", "10ms", "20ms",
+	"50ms", "100ms", "200ms", "500ms", "1s", ">1s"
+};
+
+struct dns_query_key {
+	u_int8_t	af;
+	u_int8_t	pad;
+	u_int16_t	id;		/* network byte order */
+	u_int16_t	cport;		/* client port */
+	u_int16_t	pad2;
+	u_int8_t	client[16];
+	u_int8_t	server[16];
+};
+
+struct dns_query {
+	struct timeval	ts;
+	int		answered;
+};
+
+struct dns_server {
+	struct dns_server *next;
+	u_int8_t	af;
+	u_int8_t	addr[16];
+	u_int64_t	queries;
+	u_int64_t	responses;
+	u_int64_t	answered;	/* responses matched to a query */
+	u_int64_t	nxdomain;
+	u_int64_t	servfail;
+	u_int64_t	usec;		/* total latency */
+	u_int32_t	min;
+	u_int32_t	max;
+	u_int64_t	hist[DNS_LATENCY_BUCKETS];
+};
+
+struct dns_name {
+	u_int32_t	hash;
+	u_int		len;
+	u_int64_t	count;		/* estimated */
+	u_char		name[MAXDNAME];
+};
+
+static struct state_cache	*dns_queries;
+static struct dns_server	*dns_servers[DNS_SERVER_HASHSIZE];
+static u_int			dns_server_count;
+static u_int32_t		dns_cms[DNS_CMS_DEPTH][DNS_CMS_WIDTH];
+static struct dns_name		dns_names[DNS_NAME_CANDIDATES];
+static u_int32_t		dns_name_hashes[DNS_NAME_CANDIDATES];
+static u_int			dns_name_count;
+static u_int64_t		dns_qtypes[65536];
+static u_int64_t		dns_rcodes[16];
+static u_int64_t		dns_query_count, dns_response_count;
+static u_int64_t		dns_answered, dns_malformed, dns_untracked;
+static struct timeval		dns_first, dns_last;
+
+static struct dns_server *
+dns_server(int af, const u_int8_t *addr)
+{
+	struct dns_server *s, **head;
+	size_t len = af == 6 ? 16 : 4;
+	u_int h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ addr[i]) * 16777619U;
+	head = &dns_servers[h % DNS_SERVER_HASHSIZE];
+	for (s = *head; s != NULL; s = s->next)
+		if (s->af == af && memcmp(s->addr, addr, len) == 0)
+			return s;
+	if (dns_server_count >= DNS_SERVER_MAX)
+		return NULL;
+	s = (struct dns_server *)pool_alloc(sizeof(*s));
+	s->af = af;
+	memcpy(s->addr, addr, len);
+	s->next = *head;
+	*head = s;
+	dns_server_count++;
+	return s;
+}
+
+/*
+ * Copies the name at "cp", in message "msg", to "buf" in wire format,
+ * in lower case and without compression, and sets *lenp to its length.
+ * Returns a pointer past the name at "cp", or NULL if it's malformed or
+ * goes past "ep".  Only pointers to earlier in the message are
+ * followed, so every one of them gets closer to its start.
+ */
+static const u_char *
+dns_stats_name(const u_char *cp, const u_char *msg, const u_char *ep,
+	       u_char *buf, u_int *lenp)
+{
+	const u_char *next = NULL;
+	u_int len = 0, l, off, i;
+
+	for (;;) {
+		if (cp >= ep)
+			return (NULL);
+		l = *cp;
+		if ((l & INDIR_MASK) == INDIR_MASK) {
+			if (cp + 1 >= ep)
+				return (NULL);
+			off = ((l & ~INDIR_MASK) << 8) | cp[1];
+			if (next == NULL)
+				next = cp + 2;
+			if (msg + off >= cp)
+				return (NULL);
+			cp = msg + off;
+			continue;
+		}
+		if (l > MAXLABEL || cp + 1 + l > ep || len + 1 + l > MAXDNAME - 1)
+			return (NULL);
+		buf[len++] = l;
+		for (i = 1; i <= l; i++)
+			buf[len++] = (cp[i] >= 'A' && cp[i] <= 'Z') ?
+			    cp[i] + ('a' - 'A') : cp[i];
+		cp += 1 + l;
+		if (l == 0)
+			break;
+	}
+	*lenp = len;
+	return (next != NULL ? next : cp);
+}
+
+/* Counts a query for the name "name" of "len" octets in wire format */
+static void
+dns_stats_qname(const u_char *name, u_int len)
+{
+	struct dns_name *n;
+	u_int32_t h1 = 2166136261U, h2 = 0x9747b28cU, est, c;
+	u_int i, min;
+
+	for (i = 0; i < len; i++) {
+		h1 = (h1 ^ name[i]) * 16777619U;
+		h2 = (h2 ^ name[i]) * 0x5bd1e995U;
+	}
+	h2 |= 1;
+	est = 0xffffffffU;
+	for (i = 0; i < DNS_CMS_DEPTH; i++) {
+		c = ++dns_cms[i][(h1 + i * h2) & (DNS_CMS_WIDTH - 1)];
+		if (c < est)
+			est = c;
+	}
+
+	for (i = 0; i < dns_name_count; i++)
+		if (dns_name_hashes[i] == h1 && dns_names[i].len == len &&
+		    memcmp(dns_names[i].name, name, len) == 0) {
+			dns_names[i].count = est;
+			return;
+		}
+	if (dns_name_count < DNS_NAME_CANDIDATES)
+		i = dns_name_count++;
+	else {
+		/* replace the least counted candidate, if this beats it */
+		for (i = min = 0; i < DNS_NAME_CANDIDATES; i++)
+			if (dns_names[i].count < dns_names[min].count)
+				min = i;
+		if (dns_names[min].count >= est)
+			return;
+		i = min;
+	}
+	n = &dns_names[i];
+	dns_name_hashes[i] = h1;
+	n->hash = h1;
+	n->len = len;
+	n->count = est;
+	memcpy(n->name, name, len);
+}
+
+static void
+dns_stats_latency(struct dns_server *s, const struct timeval *query)
+{
+	long sec, usec;
+	u_int64_t us;
+	u_int32_t t;
+	u_int b;
+
+	sec = gndo->ndo_ts.tv_sec - query->tv_sec;
+	usec = gndo->ndo_ts.tv_usec - query->tv_usec;
+	if (sec < 0 || (sec == 0 && usec < 0))
+		t = 0;
+	else {
+		/* in 64 bits, as a long holds only 2147 seconds on ILP32 */
+		us = (u_int64_t)sec * 1000000 + usec;
+		t = us > 4000000000U ? 4000000000U : (u_int32_t)us;
+	}
+	for (b = 0; b < DNS_LATENCY_BUCKETS - 1; b++)
+		if (t < dns_latency_bounds[b])
+			break;
+	if (s->answered == 0 || t < s->min)
+		s->min = t;
+	if (t > s->max)
+		s->max = t;
+	s->answered++;
+	s->usec += t;
+	s->hist[b]++;
+}
+
+/*
+ * Counts the DNS message "bp" from address "src", port "sport" to
+ * "dst", "dport", of address family "af".
+ */
+void
+dns_stats_packet(const u_char *bp, u_int length, int af, const u_char *src,
+		 const u_char *dst, u_int sport, u_int dport)
+{
+	const HEADER *np;
+	const u_char *ep, *cp;
+	struct dns_query_key key;
+	struct dns_query *q;
+	struct dns_server *s;
+	u_char name[MAXDNAME];
+	u_int namelen, rcode;
+	size_t alen = af == 6 ? 16 : 4;
+
+	if (dns_first.tv_sec == 0 && dns_first.tv_usec == 0)
+		dns_first = gndo->ndo_ts;
+	dns_last = gndo->ndo_ts;
+
+	ep = bp + length;
+	if (ep > snapend)
+		ep = snapend;
+	if (ep - bp < (int)sizeof(HEADER)) {
+		dns_malformed++;
+		return;
+	}
+	np = (const HEADER *)bp;
+	if (dns_queries == NULL)
+		dns_queries = state_cache_create(gndo, sizeof(struct dns_query_key),
+		    sizeof(struct dns_query), gndo->ndo_dns_queries,
+		    gndo->ndo_dns_timeout);
+	memset(&key, 0, sizeof(key));
+	key.af = af;
+	memcpy(&key.id, &np->id, sizeof(key.id));
+
+	if (!DNS_QR(np)) {
+		dns_query_count++;
+		key.cport = sport;
+		memcpy(key.client, src, alen);
+		memcpy(key.server, dst, alen);
+		q = (struct dns_query *)state_cache_enter(gndo, dns_queries, &key);
+		q->ts = gndo->ndo_ts;
+		q->answered = 0;
+		if ((s = dns_server(af, dst)) != NULL)
+			s->queries++;
+		else
+			dns_untracked++;
+
+		if (EXTRACT_16BITS(&np->qdcount) == 0)
+			return;
+		cp = dns_stats_name((const u_char *)(np + 1), bp, ep, name,
+		    &namelen);
+		if (cp == NULL || ep - cp < 4) {
+			dns_malformed++;
+			return;
+		}
+		dns_qtypes[EXTRACT_16BITS(cp)]++;
+		dns_stats_qname(name, namelen);
+		return;
+	}
+
+	dns_response_count++;
+	rcode = DNS_RCODE(np);
+	dns_rcodes[rcode]++;
+	if ((s = dns_server(af, src)) == NULL) {
+		dns_untracked++;
+		return;
+	}
+	s->responses++;
+	if (rcode == NXDOMAIN)
+		s->nxdomain++;
+	else if (rcode == SERVFAIL)
+		s->servfail++;
+	key.cport = dport;
+	memcpy(key.client, dst, alen);
+	memcpy(key.server, src, alen);
+	q = (struct dns_query *)state_cache_lookup(gndo, dns_queries, &key);
+	if (q == NULL || q->answered)
+		return;
+	q->answered = 1;
+	dns_answered++;
+	dns_stats_latency(s, &q->ts);
+}
+
+static const char *
+dns_addr_string(int af, const u_int8_t *addr)
+{
+#ifdef INET6
+	if (af == 6)
+		return ip6addr_string(addr);
+#endif
+	return ipaddr_string(addr);
+}
+
+/* Formats a name kept by dns_stats_name() */
+static const char *
+dns_name_string(const u_char *name, u_int len)
+{
+	static char buf[4 * MAXDNAME + 2];
+	char *bp = buf;
+	u_int i, l;
+
+	if (len <= 1)
+		return ".";
+	for (i = 0; i < len && (l = name[i]) != 0; i += l + 1) {
+		if (bp != buf)
+			*bp++ = '.';
+		for (l += i, i++; i <= l; i++) {
+			if (name[i] == '.' || name[i] == '\\') {
+				*bp++ = '\\';
+				*bp++ = name[i];
+			} else if (name[i] > ' ' && name[i] < 0x7f)
+				*bp++ = name[i];
+			else {
+				snprintf(bp, 5, "\\%03u", name[i]);
+				bp += 4;
+			}
+		}
+		i = l;
+		l = 0;
+	}
+	*bp = '\0';
+	return buf;
+}
+
+/* The upper bound of the bucket with the "pct"th percentile latency */
+static const char *
+dns_percentile(const struct dns_server *s, u_int pct)
+{
+	u_int64_t want, sum;
+	u_int b;
+
+	want = (s->answered * pct + 99) / 100;
+	for (b = sum = 0; b < DNS_LATENCY_BUCKETS - 1; b++) {
+		sum += s->hist[b];
+		if (sum >= want)
+			break;
+	}
+	return dns_latency_labels[b];
+}
+
+static int
+dns_server_cmp(const void *va, const void *vb)
+{
+	const struct dns_server *a = *(const struct dns_server * const *)va;
+	const struct dns_server *b = *(const struct dns_server * const *)vb;
+
+	if (a->queries + a->responses != b->queries + b->responses)
+		return a->queries + a->responses < b->queries + b->responses ?
+		    1 : -1;
+	if (a->af != b->af)
+		return a->af < b->af ? -1 : 1;
+	return memcmp(a->addr, b->addr, sizeof(a->addr));
+}
+
+static int
+dns_name_cmp(const void *va, const void *vb)
+{
+	const struct dns_name *a = *(const struct dns_name * const *)va;
+	const struct dns_name *b = *(const struct dns_name * const *)vb;
+
+	if (a->count != b->count)
+		return a->count < b->count ? 1 : -1;
+	if (a->len != b->len)
+		return a->len < b->len ? -1 : 1;
+	return memcmp(a->name, b->name, a->len);
+}
+
+static int
+dns_qtype_cmp(const void *va, const void *vb)
+{
+	u_int a = *(const u_int *)va, b = *(const u_int *)vb;
+
+	if (dns_qtypes[a] != dns_qtypes[b])
+		return dns_qtypes[a] < dns_qtypes[b] ? 1 : -1;
+	return a < b ? -1 : 1;
+}
+
+static void
+dns_rate_print(u_int64_t n, u_int64_t of)
+{
+	if (of == 0)
+		printf(" %8s", "-");
+	else
+		printf(" %7.1f%%", n * 100.0 / of);
+}
+
+static void
+dns_servers_print(void)
+{
+	struct dns_server **sorted, *s;
+	u_int i, n, b, avg, top = gndo->ndo_summary_top;
+
+	sorted = (struct dns_server **)malloc((dns_server_count + 1) *
+	    sizeof(*sorted));
+	if (sorted == NULL)
+		error("dns_stats_print: malloc");
+	for (i = n = 0; i < DNS_SERVER_HASHSIZE; i++)
+		for (s = dns_servers[i]; s != NULL; s = s->next)
+			if (s->queries != 0 || s->responses != 0)
+				sorted[n++] = s;
+	qsort(sorted, n, sizeof(*sorted), dns_server_cmp);
+	if (top != 0 && n > top)
+		n = top;
+
+	printf("%10s %10s %10s %8s %8s %12s %12s %12s %6s %6s %6s  %s\n",
+	    "queries", "responses", "unanswered", "nxdomain", "servfail",
+	    "min", "avg", "max", "p50", "p90", "p99", "server");
+	for (i = 0; i < n; i++) {
+		s = sorted[i];
+		printf("%10" PRIu64 " %10" PRIu64 " %10" PRIu64, s->queries,
+		    s->responses,
+		    s->queries > s->answered ? s->queries - s->answered : 0);
+		dns_rate_print(s->nxdomain, s->responses);
+		dns_rate_print(s->servfail, s->responses);
+		if (s->answered != 0) {
+			avg = (u_int)(s->usec / s->answered);
+			printf(" %5u.%06u %5u.%06u %5u.%06u %6s %6s %6s",
+			    s->min / 1000000, s->min % 1000000,
+			    avg / 1000000, avg % 1000000,
+			    s->max / 1000000, s->max % 1000000,
+			    dns_percentile(s, 50), dns_percentile(s, 90),
+			    dns_percentile(s, 99));
+		} else
+			printf(" %12s %12s %12s %6s %6s %6s", "-", "-", "-",
+			    "-", "-", "-");
+		printf("  %s\n", dns_addr_string(s->af, s->addr));
+	}
+
+	printf("latency");
+	for (b = 0; b < DNS_LATENCY_BUCKETS; b++)
+		printf(" %6s", dns_latency_labels[b]);
+	printf("  server\n");
+	for (i = 0; i < n; i++) {
+		s = sorted[i];
+		if (s->answered == 0)
+			continue;
+		printf("%7s", "");
+		for (b = 0; b < DNS_LATENCY_BUCKETS; b++)
+			printf(" %6" PRIu64, s->hist[b]);
+		printf("  %s\n", dns_addr_string(s->af, s->addr));
+	}
+	free(sorted);
+}
+
+void
+dns_stats_print(void)
+{
+	struct dns_name *sorted[DNS_NAME_CANDIDATES];
+	u_int *types;
+	struct timeval dur;
+	u_int i, n, top = gndo->ndo_summary_top;
+	double secs;
+
+	dur.tv_sec = dns_last.tv_sec - dns_first.tv_sec;
+	dur.tv_usec = dns_last.tv_usec - dns_first.tv_usec;
+	if (dur.tv_usec < 0) {
+		dur.tv_sec--;
+		dur.tv_usec += 1000000;
+	}
+	printf("DNS summary: %" PRIu64 " quer%s, %" PRIu64 " response%s (%" PRIu64 " matched), %" PRIu64 " NXDOMAIN, %" PRIu64 " SERVFAIL in %u.%06u seconds",
+	    dns_query_count, dns_query_count == 1 ? "y" : "ies",
+	    dns_response_count, PLURAL_SUFFIX(dns_response_count),
+	    dns_answered, dns_rcodes[NXDOMAIN], dns_rcodes[SERVFAIL],
+	    (unsigned)dur.tv_sec, (unsigned)dur.tv_usec);
+	secs = dur.tv_sec + dur.tv_usec / 1000000.0;
+	if (secs > 0)
+		printf(" (%.1f queries/s)", dns_query_count / secs);
+	if (dns_malformed != 0)
+		printf(", %" PRIu64 " malformed", dns_malformed);
+	if (dns_untracked != 0)
+		printf(", %" PRIu64 " untracked", dns_untracked);
+	printf("\n");
+	if (dns_query_count == 0 && dns_response_count == 0)
+		return;
+
+	dns_servers_print();
+
+	if (dns_name_count != 0) {
+		for (i = 0; i < dns_name_count; i++)
+			sorted[i] = &dns_names[i];
+		qsort(sorted, dns_name_count, sizeof(sorted[0]), dns_name_cmp);
+		n = dns_name_count;
+		if (top != 0 && n > top)
+			n = top;
+		printf("%10s  %s\n", "queries", "qname (estimated)");
+		for (i = 0; i < n; i++)
+			printf("%10" PRIu64 "  %s\n", sorted[i]->count,
+			    dns_name_string(sorted[i]->name, sorted[i]->len));
+	}
+
+	types = (u_int *)malloc(65536 * sizeof(*types));
+	if (types == NULL)
+		error("dns_stats_print: malloc");
+	for (i = n = 0; i < 65536; i++)
+		if (dns_qtypes[i] != 0)
+			types[n++] = i;
+	if (n != 0) {
+		qsort(types, n, sizeof(*types), dns_qtype_cmp);
+		if (top != 0 && n > top)
+			n = top;
+		printf("%10s  %s\n", "queries", "qtype");
+		for (i = 0; i < n; i++)
+			printf("%10" PRIu64 "  %s\n", dns_qtypes[types[i]],
+			    tok2str(ns_type2str, "Type%d", types[i]));
+	}
+	free(types);
+}
+
+void
+dns_stats_reset(void)
+{
+	struct dns_server *s;
+	u_int i;
+
+	for (i = 0; i < DNS_SERVER_HASHSIZE; i++)
+		for (s = dns_servers[i]; s != NULL; s = s->next) {
+			s->queries = s->responses = s->answered = 0;
+			s->nxdomain = s->servfail = s->usec = 0;
+			s->min = s->max = 0;
+			memset(s->hist, 0, sizeof(s->hist));
+		}
+	memset(dns_cms, 0, sizeof(dns_cms));
+	dns_name_count = 0;
+	memset(dns_qtypes, 0, sizeof(dns_qtypes));
+	memset(dns_rcodes, 0, sizeof(dns_rcodes));
+	dns_query_count = dns_response_count = dns_answered = 0;
+	dns_malformed = dns_untracked = 0;
+	dns_first = dns_last = gndo->ndo_ts;
+}
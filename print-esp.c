@@ -44,6 +44,10 @@
 #endif
 
 #include <stdio.h>
+#ifdef HAVE_LIBCRYPTO
+#include <sys/stat.h>
+#include <errno.h>
+#endif
 
 #include "ip.h"
 #ifdef INET6
@@ -106,6 +110,7 @@ union inaddr_u {
 };
 struct sa_list {
 	struct sa_list	*next;
+	struct sa_list	*hnext;		/* hash chain, see esp_sa_hash() */
 	u_int		daddr_version;
 	union inaddr_u	daddr;
 	u_int32_t	spi;          /* if == 0, then IKEv2 */
@@ -113,6 +118,8 @@ struct sa_list {
 	u_char          spii[8];      /* for IKEv2 */
 	u_char          spir[8];
 	const EVP_CIPHER *evp;
+	EVP_CIPHER_CTX	*ctx;		/* keyed on first use, then reused */
+	int		aead;		/* AES-GCM (RFC 4106) */
 	int		ivlen;
 	int		authlen;
 	u_char          authsecret[256];
@@ -121,6 +128,155 @@ struct sa_list {
 	int		secretlen;
 };
 
+#define SA_HASHSIZE	1024	/* must be a power of 2 */
+
+/*
+ * Secrets files named with -E "file name", watched for changes with
+ * -o esp-reload.
+ */
+struct esp_watch {
+	struct esp_watch *next;
+	char		*name;
+	ino_t		ino;
+	time_t		mtime;
+	off_t		size;
+	time_t		read;		/* when it was read */
+};
+
+static char *esp_secret_copy;		/* the -E argument, as given */
+static struct esp_watch *esp_watched;
+static time_t esp_next_check;
+static int esp_reloading;		/* re-reading the secrets */
+static int esp_reload_failed;
+
+static void esp_check_reload(netdissect_options *);
+
+static void
+esp_watch_file(netdissect_options *ndo, FILE *f, const char *name)
+{
+	struct esp_watch *w;
+	struct stat st;
+
+	if (fstat(fileno(f), &st) != 0)
+		return;
+	w = (struct esp_watch *)malloc(sizeof(*w));
+	if (w == NULL || (w->name = strdup(name)) == NULL)
+		(*ndo->ndo_error)(ndo, "esp_watch_file: out of memory");
+	w->ino = st.st_ino;
+	w->mtime = st.st_mtime;
+	w->size = st.st_size;
+	w->read = time(NULL);
+	w->next = esp_watched;
+	esp_watched = w;
+}
+
+#define GCM_SALTLEN	4	/* RFC 4106: salt at the end of the key */
+#define GCM_NONCELEN	12
+
+static u_int
+esp_sa_hash_bytes(u_int h, const u_char *p, size_t len)
+{
+	while (len-- != 0)
+		h = (h ^ *p++) * 16777619U;
+	return h;
+}
+
+/*
+ * SAs for ESP are looked up by SPI and destination address, SAs for
+ * IKEv2 (spi == 0) by the initiator and responder SPIs.
+ */
+static u_int
+esp_sa_hash(u_int32_t spi, u_int daddr_version, const void *daddr)
+{
+	u_int h = 2166136261U;
+
+	h = esp_sa_hash_bytes(h, (const u_char *)&spi, sizeof(spi));
+	if (daddr_version == 4)
+		h = esp_sa_hash_bytes(h, daddr, sizeof(struct in_addr));
+#ifdef INET6
+	else if (daddr_version == 6)
+		h = esp_sa_hash_bytes(h, daddr, sizeof(struct in6_addr));
+#endif
+	return h & (SA_HASHSIZE - 1);
+}
+
+static u_int
+ikev2_sa_hash(const u_char spii[8], const u_char spir[8])
+{
+	u_int h = 2166136261U;
+
+	h = esp_sa_hash_bytes(h, spii, 8);
+	h = esp_sa_hash_bytes(h, spir, 8);
+	return h & (SA_HASHSIZE - 1);
+}
+
+/*
+ * Get the cipher context for an SA.  The key schedule is set up once;
+ * for each packet only the IV is set.
+ */
+USES_APPLE_DEPRECATED_API
+static EVP_CIPHER_CTX *
+esp_sa_cipher(netdissect_options *ndo, struct sa_list *sa)
+{
+	EVP_CIPHER_CTX *ctx;
+
+	if (sa->ctx != NULL)
+		return sa->ctx;
+	ctx = EVP_CIPHER_CTX_new();
+	if (ctx == NULL)
+		(*ndo->ndo_error)(ndo, "esp_sa_cipher: EVP_CIPHER_CTX_new");
+	if (EVP_CipherInit_ex(ctx, sa->evp, NULL, NULL, NULL, 0) <= 0)
+		goto fail;
+#ifdef EVP_CTRL_GCM_SET_IVLEN
+	if (sa->aead &&
+	    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, GCM_NONCELEN, NULL) <= 0)
+		goto fail;
+#endif
+	if (EVP_CipherInit_ex(ctx, NULL, NULL, sa->secret, NULL, 0) <= 0)
+		goto fail;
+	sa->ctx = ctx;
+	return ctx;
+
+fail:
+	(*ndo->ndo_warning)(ndo, "espkey init failed");
+	EVP_CIPHER_CTX_free(ctx);
+	sa->evp = NULL;		/* don't try again */
+	return NULL;
+}
+USES_APPLE_RST
+
+/*
+ * In CBC mode the last block can be decrypted on its own, using the
+ * block before it as the IV.  Check that the pad length found there
+ * fits in the payload, so that a packet for which we have the wrong
+ * key is not printed as garbage; such a packet also costs one block
+ * instead of all of them.
+ */
+USES_APPLE_DEPRECATED_API
+static int
+esp_cbc_trailer_ok(EVP_CIPHER_CTX *ctx, const struct sa_list *sa,
+		   const u_char *iv, const u_char *ct, int ctlen)
+{
+	u_char last[EVP_MAX_BLOCK_LENGTH];
+	int bs;
+
+	if (EVP_CIPHER_mode(sa->evp) != EVP_CIPH_CBC_MODE)
+		return 1;
+	bs = EVP_CIPHER_block_size(sa->evp);
+	if (bs < 2 || bs > EVP_MAX_BLOCK_LENGTH || ctlen < bs ||
+	    ctlen % bs != 0 || sa->ivlen != bs)
+		return 1;
+
+	if (ctlen > bs)
+		iv = ct + ctlen - 2 * bs;
+	EVP_CipherInit_ex(ctx, NULL, NULL, NULL, iv, 0);
+	EVP_Cipher(ctx, last, ct + ctlen - bs, bs);
+
+	/* pad length and next header are the last two bytes */
+	return last[bs - 2] + 2 <= ctlen;
+}
+USES_APPLE_RST
+
 /*
  * this will adjust ndo_packetp and ndo_snapend to new buffer!
  */
@@ -133,13 +289,18 @@ int esp_print_decrypt_buffer_by_ikev2(netdissect_options *ndo,
 	struct sa_list *sa;
 	u_char *iv;
 	int len;
-	EVP_CIPHER_CTX ctx;
+	EVP_CIPHER_CTX *ctx;
 
 	/* initiator arg is any non-zero value */
 	if(initiator) initiator=1;
 
+	esp_check_reload(ndo);
+
 	/* see if we can find the SA, and if so, decode it */
-	for (sa = ndo->ndo_sa_list_head; sa != NULL; sa = sa->next) {
+	if (ndo->ndo_sa_hash == NULL)
+		return 0;
+	for (sa = ndo->ndo_sa_hash[ikev2_sa_hash(spii, spir)]; sa != NULL;
+	     sa = sa->hnext) {
 		if (sa->spi == 0
 		    && initiator == sa->initiator
 		    && memcmp(spii, sa->spii, 8) == 0
@@ -149,6 +310,8 @@ int esp_print_decrypt_buffer_by_ikev2(netdissect_options *ndo,
 
 	if(sa == NULL) return 0;
 	if(sa->evp == NULL) return 0;
+	/* combined-mode ciphers need the IKE header as AAD; not supported */
+	if(sa->aead) return 0;
 
 	/*
 	 * remove authenticator, and see if we still have something to
@@ -161,12 +324,10 @@ int esp_print_decrypt_buffer_by_ikev2(netdissect_options *ndo,
 
 	if(end <= buf) return 0;
 
-	memset(&ctx, 0, sizeof(ctx));
-	if (EVP_CipherInit(&ctx, sa->evp, sa->secret, NULL, 0) < 0)
-		(*ndo->ndo_warning)(ndo, "espkey init failed");
-	EVP_CipherInit(&ctx, NULL, NULL, iv, 0);
-	EVP_Cipher(&ctx, buf, buf, len);
-	EVP_CIPHER_CTX_cleanup(&ctx);
+	if ((ctx = esp_sa_cipher(ndo, sa)) == NULL)
+		return 0;
+	EVP_CipherInit_ex(ctx, NULL, NULL, NULL, iv, 0);
+	EVP_Cipher(ctx, buf, buf, len);
 
 	ndo->ndo_packetp = buf;
 	ndo->ndo_snapend = end;
@@ -182,18 +343,35 @@ static void esp_print_addsa(netdissect_options *ndo,
 	/* copy the "sa" */
 
 	struct sa_list *nsa;
+	u_int h;
 
 	nsa = (struct sa_list *)malloc(sizeof(struct sa_list));
 	if (nsa == NULL)
 		(*ndo->ndo_error)(ndo, "ran out of memory to allocate sa structure");
 
 	*nsa = *sa;
-
-	if (sa_def)
-		ndo->ndo_sa_default = nsa;
+	nsa->ctx = NULL;
 
 	nsa->next = ndo->ndo_sa_list_head;
 	ndo->ndo_sa_list_head = nsa;
+
+	if (sa_def) {
+		ndo->ndo_sa_default = nsa;
+		return;
+	}
+
+	if (ndo->ndo_sa_hash == NULL) {
+		ndo->ndo_sa_hash = (struct sa_list **)calloc(SA_HASHSIZE,
+		    sizeof(struct sa_list *));
+		if (ndo->ndo_sa_hash == NULL)
+			(*ndo->ndo_error)(ndo, "ran out of memory to allocate sa hash table");
+	}
+	if (nsa->spi == 0)
+		h = ikev2_sa_hash(nsa->spii, nsa->spir);
+	else
+		h = esp_sa_hash(nsa->spi, nsa->daddr_version, &nsa->daddr);
+	nsa->hnext = ndo->ndo_sa_hash[h];
+	ndo->ndo_sa_hash[h] = nsa;
 }
 
 
@@ -259,6 +437,8 @@ espprint_decode_encalgo(netdissect_options *ndo,
 	size_t i;
 	const EVP_CIPHER *evp;
 	int authlen = 0;
+	int aead = 0;
+	int ivlen;
 	char *colon, *p;
 
 	colon = strchr(decode, ':');
@@ -280,19 +460,39 @@ espprint_decode_encalgo(netdissect_options *ndo,
 		p = strstr(decode, "-cbc");
 		*p = '\0';
 	}
+	/* AES-GCM may be followed by the ICV length in bytes */
+	p = strrchr(decode, '-');
+	if (p != NULL && p - decode >= 3 && strncmp(p - 3, "gcm", 3) == 0 &&
+	    (!strcmp(p, "-8") || !strcmp(p, "-12") || !strcmp(p, "-16"))) {
+		authlen = atoi(p + 1);
+		*p = '\0';
+	}
 	evp = EVP_get_cipherbyname(decode);
 
 	if (!evp) {
 		(*ndo->ndo_warning)(ndo, "failed to find cipher algo %s\n", decode);
 		sa->evp = NULL;
+		sa->aead = 0;
 		sa->authlen = 0;
 		sa->ivlen = 0;
 		return 0;
 	}
 
+	ivlen = EVP_CIPHER_iv_length(evp);
+#if defined(EVP_CIPH_GCM_MODE) && defined(EVP_CTRL_GCM_SET_IVLEN)
+	if (EVP_CIPHER_mode(evp) == EVP_CIPH_GCM_MODE) {
+		/* RFC 4106: 8 byte explicit IV, 16 byte ICV by default */
+		aead = 1;
+		ivlen = GCM_NONCELEN - GCM_SALTLEN;
+		if (authlen == 0)
+			authlen = 16;
+	}
+#endif
+
 	sa->evp = evp;
+	sa->aead = aead;
 	sa->authlen = authlen;
-	sa->ivlen = EVP_CIPHER_iv_length(evp);
+	sa->ivlen = ivlen;
 
 	colon++;
 	if (colon[0] == '0' && colon[1] == 'x') {
@@ -313,6 +513,14 @@ espprint_decode_encalgo(netdissect_options *ndo,
 		}
 	}
 
+	/* the last 4 bytes of an AES-GCM key are the salt */
+	if (aead && sa->secretlen != EVP_CIPHER_key_length(evp) + GCM_SALTLEN) {
+		(*ndo->ndo_warning)(ndo, "%s needs a %d byte secret (key and salt)\n",
+				    decode, EVP_CIPHER_key_length(evp) + GCM_SALTLEN);
+		sa->evp = NULL;
+		return 0;
+	}
+
 	return 1;
 }
 USES_APPLE_RST
@@ -384,7 +592,7 @@ static void esp_print_decode_ikeline(netdissect_options *ndo, char *line,
 		return;
 	}
 
-	sa1.spi = 0;
+	memset(&sa1, 0, sizeof(struct sa_list));
 	sa1.initiator = (init[0] == 'I');
 	if(espprint_decode_hex(ndo, sa1.spii, sizeof(sa1.spii), icookie+2)!=8)
 		return;
@@ -439,9 +647,17 @@ static void esp_print_decode_onesecret(netdissect_options *ndo, char *line,
 
 		secretfile = fopen(filename, FOPEN_READ_TXT);
 		if (secretfile == NULL) {
+			if (esp_reloading) {
+				/* keep the SAs we have */
+				(*ndo->ndo_warning)(ndo, "%s: %s", filename,
+						    strerror(errno));
+				esp_reload_failed = 1;
+				return;
+			}
 			perror(filename);
 			exit(3);
 		}
+		esp_watch_file(ndo, secretfile, filename);
 
 		while (fgets(fileline, sizeof(fileline)-1, secretfile) != NULL) {
 			lineno++;
@@ -511,6 +727,11 @@ static void esp_init(netdissect_options *ndo _U_)
 
 	OpenSSL_add_all_algorithms();
 	EVP_add_cipher_alias(SN_des_ede3_cbc, "3des");
+#ifdef NID_aes_128_gcm
+	EVP_add_cipher_alias(SN_aes_128_gcm, "aes128-gcm");
+	EVP_add_cipher_alias(SN_aes_192_gcm, "aes192-gcm");
+	EVP_add_cipher_alias(SN_aes_256_gcm, "aes256-gcm");
+#endif
 }
 USES_APPLE_RST
 
@@ -525,6 +746,13 @@ void esp_print_decodesecret(netdissect_options *ndo)
 		initialized = 1;
 	}
 
+	/* parsing takes the string apart; keep it for re-reading */
+	if (esp_secret_copy == NULL && ndo->ndo_espsecret != NULL) {
+		esp_secret_copy = strdup(ndo->ndo_espsecret);
+		if (esp_secret_copy == NULL)
+			(*ndo->ndo_error)(ndo, "esp_print_decodesecret: strdup");
+	}
+
 	p = ndo->ndo_espsecret;
 
 	while (p && p[0] != '\0') {
@@ -540,6 +768,106 @@ void esp_print_decodesecret(netdissect_options *ndo)
 	ndo->ndo_espsecret = NULL;
 }
 
+static void
+esp_free_sas(struct sa_list *sa)
+{
+	struct sa_list *next;
+
+	for (; sa != NULL; sa = next) {
+		next = sa->next;
+		if (sa->ctx != NULL)
+			EVP_CIPHER_CTX_free(sa->ctx);
+		free(sa);
+	}
+}
+
+static void
+esp_free_watches(struct esp_watch *w)
+{
+	struct esp_watch *next;
+
+	for (; w != NULL; w = next) {
+		next = w->next;
+		free(w->name);
+		free(w);
+	}
+}
+
+/*
+ * Read the secrets again.  The new SAs are collected apart from the
+ * ones in use, which are only let go of once the new ones are all
+ * there; if a secrets file can't be read, the old SAs are kept.
+ */
+static void
+esp_reload(netdissect_options *ndo)
+{
+	struct sa_list *old_head = ndo->ndo_sa_list_head;
+	struct sa_list *old_default = ndo->ndo_sa_default;
+	struct sa_list **old_hash = ndo->ndo_sa_hash;
+	struct esp_watch *old_watched = esp_watched;
+	char *secret;
+
+	secret = strdup(esp_secret_copy);
+	if (secret == NULL)
+		(*ndo->ndo_error)(ndo, "esp_reload: strdup");
+
+	ndo->ndo_sa_list_head = NULL;
+	ndo->ndo_sa_default = NULL;
+	ndo->ndo_sa_hash = NULL;
+	esp_watched = NULL;
+	esp_reloading = 1;
+	esp_reload_failed = 0;
+	ndo->ndo_espsecret = secret;
+	esp_print_decodesecret(ndo);
+	esp_reloading = 0;
+	free(secret);
+
+	if (esp_reload_failed) {
+		esp_free_sas(ndo->ndo_sa_list_head);
+		free(ndo->ndo_sa_hash);
+		esp_free_watches(esp_watched);
+		ndo->ndo_sa_list_head = old_head;
+		ndo->ndo_sa_default = old_default;
+		ndo->ndo_sa_hash = old_hash;
+		esp_watched = old_watched;
+		return;
+	}
+	esp_free_sas(old_head);
+	free(old_hash);
+	esp_free_watches(old_watched);
+}
+
+/*
+ * With -o esp-reload, check every so often whether a secrets file has
+ * changed, and if so read the secrets again.  The modification time is
+ * only kept in seconds, so a file that was changed in the second it was
+ * read is read once more, in case it was written again in that second
+ * without changing its size.
+ */
+static void
+esp_check_reload(netdissect_options *ndo)
+{
+	struct esp_watch *w;
+	struct stat st;
+	time_t now;
+
+	if (ndo->ndo_esp_reload == 0 || esp_watched == NULL)
+		return;
+	now = time(NULL);
+	if (now < esp_next_check)
+		return;
+	esp_next_check = now + ndo->ndo_esp_reload;
+
+	for (w = esp_watched; w != NULL; w = w->next) {
+		if (stat(w->name, &st) != 0 || st.st_ino != w->ino ||
+		    st.st_mtime != w->mtime || st.st_size != w->size ||
+		    w->mtime >= w->read)
+			break;
+	}
+	if (w != NULL)
+		esp_reload(ndo);
+}
+
 #endif
 
 #ifdef HAVE_LIBCRYPTO
@@ -577,7 +905,9 @@ esp_print(netdissect_options *ndo,
 	int ivlen = 0;
 	u_char *ivoff;
 	u_char *p;
-	EVP_CIPHER_CTX ctx;
+	EVP_CIPHER_CTX *ctx;
+	u_int32_t spi;
+	u_int h;
 #endif
 
 	esp = (struct newesp *)bp;
@@ -607,16 +937,16 @@ esp_print(netdissect_options *ndo,
 	goto fail;
 #else
 	/* initiailize SAs */
-	if (ndo->ndo_sa_list_head == NULL) {
-		if (!ndo->ndo_espsecret)
-			goto fail;
-
+	if (ndo->ndo_sa_list_head == NULL && ndo->ndo_espsecret)
 		esp_print_decodesecret(ndo);
-	}
+
+	/* before giving up, as the secrets may not have been there yet */
+	esp_check_reload(ndo);
 
 	if (ndo->ndo_sa_list_head == NULL)
 		goto fail;
 
+	spi = EXTRACT_32BITS(&esp->esp_spi);
 	ip = (struct ip *)bp2;
 	switch (IP_V(ip)) {
 #ifdef INET6
@@ -629,8 +959,11 @@ esp_print(netdissect_options *ndo,
 		len = sizeof(struct ip6_hdr) + EXTRACT_16BITS(&ip6->ip6_plen);
 
 		/* see if we can find the SA, and if so, decode it */
-		for (sa = ndo->ndo_sa_list_head; sa != NULL; sa = sa->next) {
-			if (sa->spi == EXTRACT_32BITS(&esp->esp_spi) &&
+		if (ndo->ndo_sa_hash == NULL)
+			break;
+		h = esp_sa_hash(spi, 6, &ip6->ip6_dst);
+		for (sa = ndo->ndo_sa_hash[h]; sa != NULL; sa = sa->hnext) {
+			if (sa->spi == spi &&
 			    sa->daddr_version == 6 &&
 			    UNALIGNED_MEMCMP(&sa->daddr.in6, &ip6->ip6_dst,
 				   sizeof(struct in6_addr)) == 0) {
@@ -646,8 +979,11 @@ esp_print(netdissect_options *ndo,
 		len = EXTRACT_16BITS(&ip->ip_len);
 
 		/* see if we can find the SA, and if so, decode it */
-		for (sa = ndo->ndo_sa_list_head; sa != NULL; sa = sa->next) {
-			if (sa->spi == EXTRACT_32BITS(&esp->esp_spi) &&
+		if (ndo->ndo_sa_hash == NULL)
+			break;
+		h = esp_sa_hash(spi, 4, &ip->ip_dst);
+		for (sa = ndo->ndo_sa_hash[h]; sa != NULL; sa = sa->hnext) {
+			if (sa->spi == spi &&
 			    sa->daddr_version == 4 &&
 			    UNALIGNED_MEMCMP(&sa->daddr.in4, &ip->ip_dst,
 				   sizeof(struct in_addr)) == 0) {
@@ -682,15 +1018,47 @@ esp_print(netdissect_options *ndo,
 	secret = sa->secret;
 	ep = ep - sa->authlen;
 
+	if (ep < ivoff + ivlen)
+		goto fail;
+
 	if (sa->evp) {
-		memset(&ctx, 0, sizeof(ctx));
-		if (EVP_CipherInit(&ctx, sa->evp, secret, NULL, 0) < 0)
-			(*ndo->ndo_warning)(ndo, "espkey init failed");
+		if ((ctx = esp_sa_cipher(ndo, sa)) == NULL)
+			goto fail;
 
 		p = ivoff;
-		EVP_CipherInit(&ctx, NULL, NULL, p, 0);
-		EVP_Cipher(&ctx, p + ivlen, p + ivlen, ep - (p + ivlen));
-		EVP_CIPHER_CTX_cleanup(&ctx);
+#ifdef EVP_CTRL_GCM_SET_IVLEN
+		if (sa->aead) {
+			u_char nonce[GCM_NONCELEN];
+			int outl;
+
+			/*
+			 * RFC 4106: the nonce is the salt followed by the
+			 * explicit IV, the SPI and sequence number are
+			 * authenticated, and the ICV follows the ciphertext.
+			 */
+			memcpy(nonce, secret + sa->secretlen - GCM_SALTLEN,
+			       GCM_SALTLEN);
+			memcpy(nonce + GCM_SALTLEN, p, ivlen);
+			if (EVP_CipherInit_ex(ctx, NULL, NULL, NULL, nonce, 0) <= 0 ||
+			    EVP_CipherUpdate(ctx, NULL, &outl, (const u_char *)esp,
+					     sizeof(struct newesp)) <= 0 ||
+			    EVP_CipherUpdate(ctx, p + ivlen, &outl, p + ivlen,
+					     ep - (p + ivlen)) <= 0 ||
+			    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG,
+						sa->authlen, (void *)ep) <= 0 ||
+			    EVP_CipherFinal_ex(ctx, p + ivlen, &outl) <= 0) {
+				(ndo->ndo_printf)(ndo, " [ICV mismatch]");
+				goto fail;
+			}
+		} else
+#endif
+		{
+			if (!esp_cbc_trailer_ok(ctx, sa, p, p + ivlen,
+						ep - (p + ivlen)))
+				goto fail;
+			EVP_CipherInit_ex(ctx, NULL, NULL, NULL, p, 0);
+			EVP_Cipher(ctx, p + ivlen, p + ivlen, ep - (p + ivlen));
+		}
 		advance = ivoff - (u_char *)esp + ivlen;
 	} else
 		advance = sizeof(struct newesp);
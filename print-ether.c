@@ -29,6 +29,7 @@
 #include "interface.h"
 #include "extract.h"
 #include "addrtoname.h"
+#include "dissector.h"
 #include "ethertype.h"
 #include "ether.h"
 
@@ -318,6 +319,13 @@ ethertype_print(netdissect_options *ndo,
                 u_short ether_type, const u_char *p,
                 u_int length, u_int caplen)
 {
+	dissector_func f;
+
+	if ((f = ethertype_dissector(ether_type)) != NULL) {
+		(*f)(ndo, p, length, NULL);
+		return (1);
+	}
+
 	switch (ether_type) {
 
 	case ETHERTYPE_IP:
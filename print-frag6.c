@@ -28,9 +28,60 @@
 
 #include <tcpdump-stdinc.h>
 
+#include <string.h>
+
 #include "ip6.h"
 #include "interface.h"
 #include "extract.h"
+#include "ipreasm.h"
+
+/*
+ * Hand a fragment to the reassembly cache; if that completes the
+ * datagram, print the reassembled datagram.  The datagram is rebuilt
+ * behind a copy of the fixed IPv6 header; any unfragmentable extension
+ * headers that preceded the fragment header are not carried over.
+ */
+static void
+frag6_reasm_print(netdissect_options *ndo, const struct ip6_frag *dp,
+		  const struct ip6_hdr *ip6, u_int len)
+{
+	struct ip_reasm_key key;
+	struct ip6_hdr hdr;
+	const u_char *cp, *snapend_save;
+	u_char *dgram;
+	u_int dgramlen;
+
+	cp = (const u_char *)(dp + 1);
+	if (!ND_TTEST2(*cp, len))
+		return;
+
+	memset(&key, 0, sizeof(key));
+	key.af = 6;
+	key.proto = dp->ip6f_nxt;
+	memcpy(key.src, &ip6->ip6_src, sizeof(ip6->ip6_src));
+	memcpy(key.dst, &ip6->ip6_dst, sizeof(ip6->ip6_dst));
+	key.id = EXTRACT_32BITS(&dp->ip6f_ident);
+
+	memcpy(&hdr, ip6, sizeof(hdr));
+	hdr.ip6_nxt = dp->ip6f_nxt;
+
+	if (ip_reasm_add(ndo, &key,
+			 EXTRACT_16BITS(&dp->ip6f_offlg) & IP6F_OFF_MASK,
+			 EXTRACT_16BITS(&dp->ip6f_offlg) & IP6F_MORE_FRAG,
+			 cp, len, (const u_char *)&hdr, sizeof(hdr),
+			 &dgram, &dgramlen) != IP_REASM_COMPLETE)
+		return;
+
+	dgram[4] = (dgramlen - sizeof(hdr)) >> 8;
+	dgram[5] = (dgramlen - sizeof(hdr)) & 0xff;
+
+	ND_PRINT((ndo, " [reassembled %u bytes] ", dgramlen));
+	snapend_save = ndo->ndo_snapend;
+	ndo->ndo_snapend = dgram + dgramlen;
+	ip6_print(ndo, dgram, dgramlen);
+	ndo->ndo_snapend = snapend_save;
+	ip_reasm_done(ndo, dgram);
+}
 
 int
 frag6_print(netdissect_options *ndo, register const u_char *bp, register const u_char *bp2)
@@ -56,6 +107,13 @@ frag6_print(netdissect_options *ndo, register const u_char *bp, register const u
 			       (long)(bp - bp2) - sizeof(struct ip6_frag)));
 	}
 
+	if (ndo->ndo_reassemble && !ndo->ndo_nested) {
+		frag6_reasm_print(ndo, dp, ip6,
+		    sizeof(struct ip6_hdr) + EXTRACT_16BITS(&ip6->ip6_plen) -
+		    (bp - bp2) - sizeof(struct ip6_frag));
+		return -1;
+	}
+
 	/* it is meaningless to decode non-first fragment */
 	if ((EXTRACT_16BITS(&dp->ip6f_offlg) & IP6F_OFF_MASK) != 0)
 		return -1;
@@ -582,7 +582,9 @@ icmp_print(netdissect_options *ndo, const u_char *bp, u_int plen, const u_char *
 		ip = (struct ip *)bp;
 		ndo->ndo_snaplen = ndo->ndo_snapend - bp;
                 snapend_save = ndo->ndo_snapend;
+		ndo->ndo_nested++;
 		ip_print(ndo, bp, EXTRACT_16BITS(&ip->ip_len));
+		ndo->ndo_nested--;
                 ndo->ndo_snapend = snapend_save;
 	}
 
@@ -32,9 +32,11 @@
 #include "addrtoname.h"
 #include "interface.h"
 #include "extract.h"			/* must come after interface.h */
+#include "dissector.h"
 
 #include "ip.h"
 #include "ipproto.h"
+#include "ipreasm.h"
 
 static const char tstr[] = "[|ip]";
 
@@ -321,8 +323,14 @@ ip_print_demux(netdissect_options *ndo,
 {
 	struct protoent *proto;
 	struct cksum_vec vec[1];
+	dissector_func f;
 
 again:
+	if ((f = ipproto_dissector(ipds->nh)) != NULL) {
+		(*f)(ndo, ipds->cp, ipds->len, (const u_char *)ipds->ip);
+		return;
+	}
+
 	switch (ipds->nh) {
 
 	case IPPROTO_AH:
@@ -508,6 +516,75 @@ ip_print_inner(netdissect_options *ndo,
 }
 
 
+/*
+ * print a fragment and hand it to the reassembly cache; if that
+ * completes the datagram, print the reassembled datagram as well.
+ */
+static void
+ip_reasm_print(netdissect_options *ndo,
+	       struct ip_print_demux_state *ipds, u_int hlen)
+{
+	struct ip_reasm_key key;
+	struct protoent *proto;
+	struct cksum_vec vec[1];
+	const u_char *cp, *snapend_save;
+	u_char *dgram;
+	u_int dgramlen, foff;
+	u_int16_t sum;
+
+	foff = (ipds->off & IP_OFFMASK) * 8;
+	if (qflag <= 1) {
+		(void)printf("%s > %s:", ipaddr_string(&ipds->ip->ip_src),
+			     ipaddr_string(&ipds->ip->ip_dst));
+		if (!ndo->ndo_nflag && (proto = getprotobynumber(ipds->ip->ip_p)) != NULL)
+			(void)printf(" %s", proto->p_name);
+		else
+			(void)printf(" ip-proto-%d", ipds->ip->ip_p);
+		(void)printf(" (frag %u:%u@%u%s)",
+			     EXTRACT_16BITS(&ipds->ip->ip_id), ipds->len, foff,
+			     (ipds->off & IP_MF) ? "+" : "");
+	}
+
+	/* a fragment we didn't capture completely is of no use */
+	cp = (const u_char *)ipds->ip + hlen;
+	if (!ND_TTEST2(*cp, ipds->len))
+		return;
+
+	memset(&key, 0, sizeof(key));
+	key.af = 4;
+	key.proto = ipds->ip->ip_p;
+	memcpy(key.src, &ipds->ip->ip_src, sizeof(ipds->ip->ip_src));
+	memcpy(key.dst, &ipds->ip->ip_dst, sizeof(ipds->ip->ip_dst));
+	key.id = EXTRACT_16BITS(&ipds->ip->ip_id);
+
+	if (ip_reasm_add(ndo, &key, foff, ipds->off & IP_MF, cp, ipds->len,
+			 (const u_char *)ipds->ip, hlen,
+			 &dgram, &dgramlen) != IP_REASM_COMPLETE)
+		return;
+
+	/*
+	 * Turn the first fragment's header into the header of the whole
+	 * datagram: fix up the length, clear MF and the offset (keeping
+	 * DF and the reserved bit) and recompute the checksum.
+	 */
+	dgram[2] = dgramlen >> 8;
+	dgram[3] = dgramlen & 0xff;
+	dgram[6] &= (IP_RES|IP_DF) >> 8;
+	dgram[7] = 0;
+	dgram[10] = dgram[11] = 0;
+	vec[0].ptr = dgram;
+	vec[0].len = hlen;
+	sum = in_cksum(vec, 1);
+	memcpy(&dgram[10], &sum, sizeof(sum));
+
+	(void)printf(" [reassembled %u bytes] ", dgramlen);
+	snapend_save = ndo->ndo_snapend;
+	ndo->ndo_snapend = dgram + dgramlen;
+	ip_print(ndo, dgram, dgramlen);
+	ndo->ndo_snapend = snapend_save;
+	ip_reasm_done(ndo, dgram);
+}
+
 /*
  * print an IP datagram.
  */
@@ -632,6 +709,17 @@ ip_print(netdissect_options *ndo,
             printf(")\n    ");
 	}
 
+	/*
+	 * When reassembling, fragments (including the first one) are
+	 * held back until the whole datagram can be dissected; fragments
+	 * quoted in ICMP errors or sampled by sFlow are left alone.
+	 */
+	if (ndo->ndo_reassemble && !ndo->ndo_nested &&
+	    (ipds->off & (IP_MF|IP_OFFMASK)) != 0) {
+		ip_reasm_print(ndo, ipds, hlen);
+		return;
+	}
+
 	/*
 	 * If this is fragment zero, hand it to the next higher
 	 * level protocol.
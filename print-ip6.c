@@ -32,6 +32,7 @@
 
 #include "interface.h"
 #include "addrtoname.h"
+#include "dissector.h"
 #include "extract.h"
 
 #include "ip6.h"
@@ -83,6 +84,7 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 	int nh;
 	int fragmented = 0;
 	u_int flow;
+	dissector_func f;
 
 	ip6 = (const struct ip6_hdr *)bp;
 
@@ -151,6 +153,11 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 				     ip6addr_string(&ip6->ip6_dst)));
 		}
 
+		if ((f = ipproto_dissector(nh)) != NULL) {
+			(*f)(ndo, cp, len, (const u_char *)ip6);
+			return;
+		}
+
 		switch (nh) {
 		case IPPROTO_HOPOPTS:
 			advance = hbhopt_print(ndo, cp);
@@ -47,6 +47,7 @@
 #include "interface.h"
 #include "addrtoname.h"
 #include "extract.h"                    /* must come after interface.h */
+#include "statecache.h"
 
 #include "ip.h"
 #ifdef INET6
@@ -644,20 +645,22 @@ ikev1_print(netdissect_options *ndo,
 	    const u_char *bp,  u_int length,
 	    const u_char *bp2, struct isakmp *base);
 
-#define MAXINITIATORS	20
-int ninitiator = 0;
+/*
+ * Initiator cookies we have seen the first packet of an exchange for,
+ * with the addresses of the initiator and the responder.
+ */
 union inaddr_u {
 	struct in_addr in4;
 #ifdef INET6
 	struct in6_addr in6;
 #endif
 };
-struct {
-	cookie_t initiator;
+struct cookie_entry {
 	u_int version;
 	union inaddr_u iaddr;
 	union inaddr_u raddr;
-} cookiecache[MAXINITIATORS];
+};
+static struct state_cache *cookiecache;
 
 /* protocol id */
 static const char *protoidstr[] = {
@@ -763,61 +766,59 @@ iszero(u_char *p, size_t l)
 }
 
 /* find cookie from initiator cache */
-static int
-cookie_find(cookie_t *in)
+static struct cookie_entry *
+cookie_find(netdissect_options *ndo, cookie_t *in)
 {
-	int i;
-
-	for (i = 0; i < MAXINITIATORS; i++) {
-		if (memcmp(in, &cookiecache[i].initiator, sizeof(*in)) == 0)
-			return i;
-	}
-
-	return -1;
+	if (cookiecache == NULL)
+		return NULL;
+	return (struct cookie_entry *)state_cache_lookup(ndo, cookiecache, in);
 }
 
 /* record initiator */
 static void
-cookie_record(cookie_t *in, const u_char *bp2)
+cookie_record(netdissect_options *ndo, cookie_t *in, const u_char *bp2)
 {
-	int i;
+	struct cookie_entry *ce;
 	struct ip *ip;
 #ifdef INET6
 	struct ip6_hdr *ip6;
 #endif
 
-	i = cookie_find(in);
-	if (0 <= i) {
-		ninitiator = (i + 1) % MAXINITIATORS;
+	ip = (struct ip *)bp2;
+	if (IP_V(ip) != 4
+#ifdef INET6
+	    && IP_V(ip) != 6
+#endif
+	    )
 		return;
-	}
 
-	ip = (struct ip *)bp2;
+	if (cookiecache == NULL)
+		cookiecache = state_cache_create(ndo, sizeof(cookie_t),
+		    sizeof(struct cookie_entry), ndo->ndo_ike_cookies,
+		    ndo->ndo_ike_timeout);
+	ce = (struct cookie_entry *)state_cache_enter(ndo, cookiecache, in);
+
 	switch (IP_V(ip)) {
 	case 4:
-		cookiecache[ninitiator].version = 4;
-		UNALIGNED_MEMCPY(&cookiecache[ninitiator].iaddr.in4, &ip->ip_src, sizeof(struct in_addr));
-		UNALIGNED_MEMCPY(&cookiecache[ninitiator].raddr.in4, &ip->ip_dst, sizeof(struct in_addr));
+		ce->version = 4;
+		UNALIGNED_MEMCPY(&ce->iaddr.in4, &ip->ip_src, sizeof(struct in_addr));
+		UNALIGNED_MEMCPY(&ce->raddr.in4, &ip->ip_dst, sizeof(struct in_addr));
 		break;
 #ifdef INET6
 	case 6:
 		ip6 = (struct ip6_hdr *)bp2;
-		cookiecache[ninitiator].version = 6;
-		UNALIGNED_MEMCPY(&cookiecache[ninitiator].iaddr.in6, &ip6->ip6_src, sizeof(struct in6_addr));
-		UNALIGNED_MEMCPY(&cookiecache[ninitiator].raddr.in6, &ip6->ip6_dst, sizeof(struct in6_addr));
+		ce->version = 6;
+		UNALIGNED_MEMCPY(&ce->iaddr.in6, &ip6->ip6_src, sizeof(struct in6_addr));
+		UNALIGNED_MEMCPY(&ce->raddr.in6, &ip6->ip6_dst, sizeof(struct in6_addr));
 		break;
 #endif
-	default:
-		return;
 	}
-	UNALIGNED_MEMCPY(&cookiecache[ninitiator].initiator, in, sizeof(*in));
-	ninitiator = (ninitiator + 1) % MAXINITIATORS;
 }
 
 #define cookie_isinitiator(x, y)	cookie_sidecheck((x), (y), 1)
 #define cookie_isresponder(x, y)	cookie_sidecheck((x), (y), 0)
 static int
-cookie_sidecheck(int i, const u_char *bp2, int initiator)
+cookie_sidecheck(const struct cookie_entry *ce, const u_char *bp2, int initiator)
 {
 	struct ip *ip;
 #ifdef INET6
@@ -827,26 +828,26 @@ cookie_sidecheck(int i, const u_char *bp2, int initiator)
 	ip = (struct ip *)bp2;
 	switch (IP_V(ip)) {
 	case 4:
-		if (cookiecache[i].version != 4)
+		if (ce->version != 4)
 			return 0;
 		if (initiator) {
-			if (UNALIGNED_MEMCMP(&ip->ip_src, &cookiecache[i].iaddr.in4, sizeof(struct in_addr)) == 0)
+			if (UNALIGNED_MEMCMP(&ip->ip_src, &ce->iaddr.in4, sizeof(struct in_addr)) == 0)
 				return 1;
 		} else {
-			if (UNALIGNED_MEMCMP(&ip->ip_src, &cookiecache[i].raddr.in4, sizeof(struct in_addr)) == 0)
+			if (UNALIGNED_MEMCMP(&ip->ip_src, &ce->raddr.in4, sizeof(struct in_addr)) == 0)
 				return 1;
 		}
 		break;
 #ifdef INET6
 	case 6:
-		if (cookiecache[i].version != 6)
+		if (ce->version != 6)
 			return 0;
 		ip6 = (struct ip6_hdr *)bp2;
 		if (initiator) {
-			if (UNALIGNED_MEMCMP(&ip6->ip6_src, &cookiecache[i].iaddr.in6, sizeof(struct in6_addr)) == 0)
+			if (UNALIGNED_MEMCMP(&ip6->ip6_src, &ce->iaddr.in6, sizeof(struct in6_addr)) == 0)
 				return 1;
 		} else {
-			if (UNALIGNED_MEMCMP(&ip6->ip6_src, &cookiecache[i].raddr.in6, sizeof(struct in6_addr)) == 0)
+			if (UNALIGNED_MEMCMP(&ip6->ip6_src, &ce->raddr.in6, sizeof(struct in6_addr)) == 0)
 				return 1;
 		}
 		break;
@@ -2662,7 +2663,7 @@ ikev1_print(netdissect_options *ndo,
 	const struct isakmp *p;
 	const u_char *ep;
 	u_char np;
-	int i;
+	const struct cookie_entry *ce;
 	int phase;
 
 	p = (const struct isakmp *)bp;
@@ -2674,19 +2675,19 @@ ikev1_print(netdissect_options *ndo,
 	else
 		ND_PRINT((ndo," phase %d/others", phase));
 
-	i = cookie_find(&base->i_ck);
-	if (i < 0) {
+	ce = cookie_find(ndo, &base->i_ck);
+	if (ce == NULL) {
 		if (iszero((u_char *)&base->r_ck, sizeof(base->r_ck))) {
 			/* the first packet */
 			ND_PRINT((ndo," I"));
 			if (bp2)
-				cookie_record(&base->i_ck, bp2);
+				cookie_record(ndo, &base->i_ck, bp2);
 		} else
 			ND_PRINT((ndo," ?"));
 	} else {
-		if (bp2 && cookie_isinitiator(i, bp2))
+		if (bp2 && cookie_isinitiator(ce, bp2))
 			ND_PRINT((ndo," I"));
-		else if (bp2 && cookie_isresponder(i, bp2))
+		else if (bp2 && cookie_isresponder(ce, bp2))
 			ND_PRINT((ndo," R"));
 		else
 			ND_PRINT((ndo," ?"));
@@ -450,7 +450,8 @@ static int juniper_parse_header (const u_char *, const struct pcap_pkthdr *, str
 
 #ifdef DLT_JUNIPER_GGSN
 u_int
-juniper_ggsn_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_ggsn_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
         struct juniper_ggsn_header {
@@ -497,7 +498,8 @@ juniper_ggsn_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_ES
 u_int
-juniper_es_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_es_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
         struct juniper_ipsec_header {
@@ -567,7 +569,8 @@ juniper_es_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_MONITOR
 u_int
-juniper_monitor_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_monitor_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
         struct juniper_monitor_header {
@@ -600,7 +603,8 @@ juniper_monitor_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_SERVICES
 u_int
-juniper_services_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_services_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
         struct juniper_services_header {
@@ -634,7 +638,8 @@ juniper_services_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_PPPOE
 u_int
-juniper_pppoe_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_pppoe_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
 
@@ -651,7 +656,8 @@ juniper_pppoe_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_ETHER
 u_int
-juniper_ether_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_ether_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
 
@@ -668,7 +674,8 @@ juniper_ether_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_PPP
 u_int
-juniper_ppp_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_ppp_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
 
@@ -685,7 +692,8 @@ juniper_ppp_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_FRELAY
 u_int
-juniper_frelay_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_frelay_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
 
@@ -702,7 +710,8 @@ juniper_frelay_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_CHDLC
 u_int
-juniper_chdlc_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_chdlc_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
 
@@ -719,7 +728,8 @@ juniper_chdlc_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_PPPOE_ATM
 u_int
-juniper_pppoe_atm_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_pppoe_atm_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
 	u_int16_t extracted_ethertype;
@@ -746,7 +756,8 @@ juniper_pppoe_atm_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_MLPPP
 u_int
-juniper_mlppp_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_mlppp_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
 
@@ -807,7 +818,8 @@ juniper_mlppp_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_MFR
 u_int
-juniper_mfr_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_mfr_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
 
@@ -868,7 +880,8 @@ juniper_mfr_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_MLFR
 u_int
-juniper_mlfr_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_mlfr_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         struct juniper_l2info_t l2info;
 
@@ -909,7 +922,8 @@ juniper_mlfr_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_ATM1
 u_int
-juniper_atm1_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_atm1_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         u_int16_t extracted_ethertype;
 
@@ -957,7 +971,8 @@ juniper_atm1_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 #ifdef DLT_JUNIPER_ATM2
 u_int
-juniper_atm2_print(const struct pcap_pkthdr *h, register const u_char *p)
+juniper_atm2_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
         u_int16_t extracted_ethertype;
 
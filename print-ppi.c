@@ -50,7 +50,6 @@ ppi_print(struct netdissect_options *ndo,
                const struct pcap_pkthdr *h, const u_char *p)
 {
 	if_ndo_printer ndo_printer;
-        if_printer printer;
 	ppi_header_t *hdr;
 	u_int caplen = h->caplen;
 	u_int length = h->len;
@@ -70,9 +69,7 @@ ppi_print(struct netdissect_options *ndo,
 	caplen -= sizeof(ppi_header_t);
 	p += sizeof(ppi_header_t);
 
-	if ((printer = lookup_printer(dlt)) != NULL) {
-		printer(h, p);
-	} else if ((ndo_printer = lookup_ndo_printer(dlt)) != NULL) {
+	if ((ndo_printer = lookup_ndo_printer(dlt)) != NULL) {
 		ndo_printer(ndo, h, p);
 	} else {
 		if (!ndo->ndo_eflag)
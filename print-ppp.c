@@ -42,6 +42,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "interface.h"
 #include "extract.h"
@@ -50,6 +51,7 @@
 #include "chdlc.h"
 #include "ethertype.h"
 #include "oui.h"
+#include "scratch.h"
 
 /*
  * The following constatns are defined by IANA. Please refer to
@@ -1348,32 +1350,42 @@ trunc:
 static void
 ppp_hdlc(const u_char *p, int length)
 {
-	u_char *b, *s, *t, c;
-	int i, proto;
+	u_char *b, *t;
+	const u_char *s, *e, *esc;
+	int proto;
 	const void *se;
+	struct scratch_mark mark;
 
         if (length <= 0)
                 return;
 
-	b = (u_int8_t *)malloc(length);
-	if (b == NULL)
+	/* only what was captured can be unescaped */
+	if (p >= snapend) {
+		printf("[|ppp]");
 		return;
+	}
+	if (length > snapend - p)
+		length = snapend - p;
+
+	scratch_mark(gndo, &mark);
+	b = (u_char *)scratch_alloc(gndo, length);
 
 	/*
 	 * Unescape all the data into a temporary, private, buffer.
 	 * Do this so that we dont overwrite the original packet
-	 * contents.
+	 * contents.  The runs between escape bytes are copied whole.
 	 */
-	for (s = (u_char *)p, t = b, i = length; i > 0; i--) {
-		c = *s++;
-		if (c == 0x7d) {
-			if (i > 1) {
-				i--;
-				c = *s++ ^ 0x20;
-			} else
-				continue;
+	for (s = p, e = p + length, t = b; s < e; s = esc + 2) {
+		esc = (const u_char *)memchr(s, 0x7d, e - s);
+		if (esc == NULL) {
+			memcpy(t, s, e - s);
+			t += e - s;
+			break;
 		}
-		*t++ = c;
+		memcpy(t, s, esc - s);
+		t += esc - s;
+		if (esc + 1 < e)
+			*t++ = esc[1] ^ 0x20;
 	}
 
 	se = snapend;
@@ -1416,12 +1428,12 @@ ppp_hdlc(const u_char *p, int length)
 
 cleanup:
         snapend = se;
-	free(b);
+	scratch_release(gndo, &mark);
         return;
 
 trunc:
         snapend = se;
-	free(b);
+	scratch_release(gndo, &mark);
 	printf("[|ppp]");
 	return;
 }
@@ -1432,7 +1444,7 @@ static void
 handle_ppp(u_int proto, const u_char *p, int length)
 {
         if ((proto & 0xff00) == 0x7e00) {/* is this an escape code ? */
-            ppp_hdlc(p-1, length);
+            ppp_hdlc(p-1, length+1);
             return;
         }
 
@@ -1562,7 +1574,8 @@ trunc:
 
 /* PPP I/F printer */
 u_int
-ppp_if_print(const struct pcap_pkthdr *h, register const u_char *p)
+ppp_if_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
 	register u_int length = h->len;
 	register u_int caplen = h->caplen;
@@ -1628,7 +1641,8 @@ ppp_if_print(const struct pcap_pkthdr *h, register const u_char *p)
  * This handles, for example, DLT_PPP_SERIAL in NetBSD.
  */
 u_int
-ppp_hdlc_if_print(const struct pcap_pkthdr *h, register const u_char *p)
+ppp_hdlc_if_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h, register const u_char *p)
 {
 	register u_int length = h->len;
 	register u_int caplen = h->caplen;
@@ -1689,7 +1703,8 @@ ppp_hdlc_if_print(const struct pcap_pkthdr *h, register const u_char *p)
 
 /* BSD/OS specific PPP printer */
 u_int
-ppp_bsdos_if_print(const struct pcap_pkthdr *h _U_, register const u_char *p _U_)
+ppp_bsdos_if_print(netdissect_options *ndo _U_,
+    const struct pcap_pkthdr *h _U_, register const u_char *p _U_)
 {
 	register int hdrlength;
 #ifdef __bsdi__
@@ -44,6 +44,8 @@
 #include "interface.h"
 #include "addrtoname.h"
 #include "extract.h"
+#include "scratch.h"
+#include "statecache.h"
 
 #include "ip.h"
 
@@ -470,23 +472,25 @@ static const struct tok rx_ack_reasons[] = {
 /*
  * Cache entries we keep around so we can figure out the RX opcode
  * numbers for replies.  This allows us to make sense of RX reply packets.
+ * They're kept in a state_cache, keyed by the call.
  */
 
-struct rx_cache_entry {
+struct rx_cache_key {
 	u_int32_t	callnum;	/* Call number (net order) */
 	struct in_addr	client;		/* client IP address (net order) */
 	struct in_addr	server;		/* server IP address (net order) */
-	int		dport;		/* server port (host order) */
+	u_int16_t	dport;		/* server port (host order) */
 	u_short		serviceId;	/* Service identifier (net order) */
-	u_int32_t	opcode;		/* RX opcode (host order) */
 };
 
-#define RX_CACHE_SIZE	64
+struct rx_cache_entry {
+	u_int32_t	opcode;		/* RX opcode (host order) */
+	struct timeval	ts;		/* when the call was seen */
+	int		answered;	/* seen the first reply packet */
+};
 
-static struct rx_cache_entry	rx_cache[RX_CACHE_SIZE];
+static struct state_cache	*rx_cache;
 
-static int	rx_cache_next = 0;
-static int	rx_cache_hint = 0;
 static void	rx_cache_insert(const u_char *, const struct ip *, int);
 static int	rx_cache_find(const struct rx_header *, const struct ip *,
 			      int, int32_t *);
@@ -667,6 +671,172 @@ rx_print(register const u_char *bp, int length, int sport, int dport,
 	printf(" (%d)", length);
 }
 
+/*
+ * Per-opcode call timing, for -o rx-stats: the time from a call to
+ * the first packet of its reply.
+ */
+
+struct rx_call_stats {
+	struct rx_call_stats *next;
+	int		port;		/* service port */
+	u_int32_t	opcode;
+	u_int		calls;		/* calls answered */
+	u_int64_t	usec;		/* total response time */
+	u_int32_t	min;
+	u_int32_t	max;
+};
+
+#define RX_STATS_HASHSIZE	64
+
+static struct rx_call_stats	*rx_stats[RX_STATS_HASHSIZE];
+static u_int			rx_stats_count;
+
+static void
+rx_stats_record(int port, u_int32_t opcode, const struct timeval *call)
+{
+	struct rx_call_stats *st, **head;
+	long sec, usec;
+	u_int32_t t;
+
+	head = &rx_stats[(port ^ opcode) % RX_STATS_HASHSIZE];
+	for (st = *head; st != NULL; st = st->next)
+		if (st->port == port && st->opcode == opcode)
+			break;
+	if (st == NULL) {
+		st = (struct rx_call_stats *)calloc(1, sizeof(*st));
+		if (st == NULL)
+			error("rx_stats_record: calloc");
+		st->port = port;
+		st->opcode = opcode;
+		st->next = *head;
+		*head = st;
+		rx_stats_count++;
+	}
+
+	sec = gndo->ndo_ts.tv_sec - call->tv_sec;
+	usec = gndo->ndo_ts.tv_usec - call->tv_usec;
+	if (sec < 0 || (sec == 0 && usec < 0))
+		t = 0;
+	else
+		t = (u_int32_t)(sec * 1000000 + usec);
+	if (st->calls == 0 || t < st->min)
+		st->min = t;
+	if (t > st->max)
+		st->max = t;
+	st->calls++;
+	st->usec += t;
+}
+
+static int
+rx_stats_cmp(const void *va, const void *vb)
+{
+	const struct rx_call_stats *a = *(const struct rx_call_stats * const *)va;
+	const struct rx_call_stats *b = *(const struct rx_call_stats * const *)vb;
+
+	if (a->port != b->port)
+		return a->port < b->port ? -1 : 1;
+	if (a->opcode != b->opcode)
+		return a->opcode < b->opcode ? -1 : 1;
+	return 0;
+}
+
+static const char *
+rx_opcode_string(int port, u_int32_t opcode)
+{
+	if (is_ubik(opcode))
+		return tok2str(ubik_req, "op#%d", opcode);
+	switch (port) {
+	case FS_RX_PORT:
+		return tok2str(fs_req, "op#%d", opcode);
+	case CB_RX_PORT:
+		return tok2str(cb_req, "op#%d", opcode);
+	case PROT_RX_PORT:
+		return tok2str(pt_req, "op#%d", opcode);
+	case VLDB_RX_PORT:
+		return tok2str(vldb_req, "op#%d", opcode);
+	case KAUTH_RX_PORT:
+		return tok2str(kauth_req, "op#%d", opcode);
+	case VOL_RX_PORT:
+		return tok2str(vol_req, "op#%d", opcode);
+	case BOS_RX_PORT:
+		return tok2str(bos_req, "op#%d", opcode);
+	}
+	return tok2str(NULL, "op#%d", opcode);
+}
+
+static const struct tok rx_service_values[] = {
+	{ FS_RX_PORT, "fs" },
+	{ CB_RX_PORT, "cb" },
+	{ PROT_RX_PORT, "pt" },
+	{ VLDB_RX_PORT, "vldb" },
+	{ KAUTH_RX_PORT, "kauth" },
+	{ VOL_RX_PORT, "vol" },
+	{ BOS_RX_PORT, "bos" },
+	{ 0, NULL }
+};
+
+void
+rx_stats_print(void)
+{
+	struct rx_call_stats **sorted, *st;
+	u_int i, n, avg;
+
+	printf("Rx call timing: %u opcode%s\n", rx_stats_count,
+	    PLURAL_SUFFIX(rx_stats_count));
+	if (rx_stats_count == 0)
+		return;
+	sorted = (struct rx_call_stats **)malloc(rx_stats_count * sizeof(*sorted));
+	if (sorted == NULL)
+		error("rx_stats_print: malloc");
+	for (i = n = 0; i < RX_STATS_HASHSIZE; i++)
+		for (st = rx_stats[i]; st != NULL; st = st->next)
+			sorted[n++] = st;
+	qsort(sorted, n, sizeof(*sorted), rx_stats_cmp);
+
+	printf("%-7s %-24s %8s %12s %12s %12s\n", "service", "opcode",
+	    "calls", "min", "avg", "max");
+	for (i = 0; i < n; i++) {
+		st = sorted[i];
+		avg = (u_int)(st->usec / st->calls);
+		printf("%-7s %-24s %8u %5u.%06u %5u.%06u %5u.%06u\n",
+		    tok2str(rx_service_values, "%d", st->port),
+		    rx_opcode_string(st->port, st->opcode), st->calls,
+		    st->min / 1000000, st->min % 1000000,
+		    avg / 1000000, avg % 1000000,
+		    st->max / 1000000, st->max % 1000000);
+	}
+	free(sorted);
+}
+
+/* Start counting again after an interval report */
+void
+rx_stats_reset(void)
+{
+	struct rx_call_stats *st, *next;
+	u_int i;
+
+	for (i = 0; i < RX_STATS_HASHSIZE; i++) {
+		for (st = rx_stats[i]; st != NULL; st = next) {
+			next = st->next;
+			free(st);
+		}
+		rx_stats[i] = NULL;
+	}
+	rx_stats_count = 0;
+}
+
+static void
+rx_cache_key(struct rx_cache_key *key, const struct rx_header *rxh,
+	     struct in_addr client, struct in_addr server, int port)
+{
+	memset(key, 0, sizeof(*key));
+	key->callnum = rxh->callNumber;
+	key->client = client;
+	key->server = server;
+	key->dport = port;
+	key->serviceId = rxh->serviceId;
+}
+
 /*
  * Insert an entry into the cache.  Taken from print-nfs.c
  */
@@ -674,23 +844,22 @@ rx_print(register const u_char *bp, int length, int sport, int dport,
 static void
 rx_cache_insert(const u_char *bp, const struct ip *ip, int dport)
 {
+	struct rx_cache_key key;
 	struct rx_cache_entry *rxent;
 	const struct rx_header *rxh = (const struct rx_header *) bp;
 
 	if (snapend - bp + 1 <= (int)(sizeof(struct rx_header) + sizeof(int32_t)))
 		return;
 
-	rxent = &rx_cache[rx_cache_next];
-
-	if (++rx_cache_next >= RX_CACHE_SIZE)
-		rx_cache_next = 0;
-
-	rxent->callnum = rxh->callNumber;
-	rxent->client = ip->ip_src;
-	rxent->server = ip->ip_dst;
-	rxent->dport = dport;
-	rxent->serviceId = rxh->serviceId;
+	if (rx_cache == NULL)
+		rx_cache = state_cache_create(gndo, sizeof(struct rx_cache_key),
+		    sizeof(struct rx_cache_entry), gndo->ndo_rx_calls,
+		    gndo->ndo_rx_timeout);
+	rx_cache_key(&key, rxh, ip->ip_src, ip->ip_dst, dport);
+	rxent = (struct rx_cache_entry *)state_cache_enter(gndo, rx_cache, &key);
 	rxent->opcode = EXTRACT_32BITS(bp + sizeof(struct rx_header));
+	rxent->ts = gndo->ndo_ts;
+	rxent->answered = 0;
 }
 
 /*
@@ -704,34 +873,21 @@ static int
 rx_cache_find(const struct rx_header *rxh, const struct ip *ip, int sport,
 	      int32_t *opcode)
 {
-	int i;
+	struct rx_cache_key key;
 	struct rx_cache_entry *rxent;
-	u_int32_t clip = ip->ip_dst.s_addr;
-	u_int32_t sip = ip->ip_src.s_addr;
 
-	/* Start the search where we last left off */
-
-	i = rx_cache_hint;
-	do {
-		rxent = &rx_cache[i];
-		if (rxent->callnum == rxh->callNumber &&
-		    rxent->client.s_addr == clip &&
-		    rxent->server.s_addr == sip &&
-		    rxent->serviceId == rxh->serviceId &&
-		    rxent->dport == sport) {
-
-			/* We got a match! */
-
-			rx_cache_hint = i;
-			*opcode = rxent->opcode;
-			return(1);
-		}
-		if (++i >= RX_CACHE_SIZE)
-			i = 0;
-	} while (i != rx_cache_hint);
+	if (rx_cache == NULL)
+		return(0);
+	rx_cache_key(&key, rxh, ip->ip_dst, ip->ip_src, sport);
+	rxent = (struct rx_cache_entry *)state_cache_lookup(gndo, rx_cache, &key);
+	if (rxent == NULL)
+		return(0);
 
-	/* Our search failed */
-	return(0);
+	*opcode = rxent->opcode;
+	if (gndo->ndo_rx_stats && !rxent->answered)
+		rx_stats_record(sport, rxent->opcode, &rxent->ts);
+	rxent->answered = 1;
+	return(1);
 }
 
 /*
@@ -1142,8 +1298,8 @@ acl_print(u_char *s, int maxsize, u_char *end)
 	char *user;
 	char fmt[1024];
 
-	if ((user = (char *)malloc(maxsize)) == NULL)
-		return;
+	/* given back when the packet has been printed */
+	user = (char *)scratch_alloc(gndo, maxsize);
 
 	if (sscanf((char *) s, "%d %d\n%n", &pos, &neg, &n) != 2)
 		goto finish;
@@ -1202,7 +1358,6 @@ acl_print(u_char *s, int maxsize, u_char *end)
 	}
 
 finish:
-	free(user);
 	return;
 }
 
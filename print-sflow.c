@@ -32,6 +32,8 @@
 #include "interface.h"
 #include "extract.h"
 #include "addrtoname.h"
+#include "scratch.h"
+#include "summary.h"
 
 /*
  * sFlow datagram
@@ -501,27 +503,27 @@ sflow_print_counter_records(const u_char *pointer, u_int len, u_int records) {
 	if (enterprise == 0) {
 	    switch (counter_type) {
 	    case SFLOW_COUNTER_GENERIC:
-		if (print_sflow_counter_generic(tptr,tlen))
+		if (print_sflow_counter_generic(tptr,counter_len))
 		    return 1;
 		break;
 	    case SFLOW_COUNTER_ETHERNET:
-		if (print_sflow_counter_ethernet(tptr,tlen))
+		if (print_sflow_counter_ethernet(tptr,counter_len))
 		    return 1;
 		break;
 	    case SFLOW_COUNTER_TOKEN_RING:
-		if (print_sflow_counter_token_ring(tptr,tlen))
+		if (print_sflow_counter_token_ring(tptr,counter_len))
 		    return 1;
 		break;
 	    case SFLOW_COUNTER_BASEVG:
-		if (print_sflow_counter_basevg(tptr,tlen))
+		if (print_sflow_counter_basevg(tptr,counter_len))
 		    return 1;
 		break;
 	    case SFLOW_COUNTER_VLAN:
-		if (print_sflow_counter_vlan(tptr,tlen))
+		if (print_sflow_counter_vlan(tptr,counter_len))
 		    return 1;
 		break;
 	    case SFLOW_COUNTER_PROCESSOR:
-		if (print_sflow_counter_processor(tptr,tlen))
+		if (print_sflow_counter_processor(tptr,counter_len))
 		    return 1;
 		break;
 	    default:
@@ -602,20 +604,61 @@ static int
 print_sflow_raw_packet(const u_char *pointer, u_int len) {
 
     const struct sflow_expanded_flow_raw_t *sflow_flow_raw;
+    const u_char *hdr, *snapend_save;
+    u_int protocol, length, stripped, header_size;
 
     if (len < sizeof(struct sflow_expanded_flow_raw_t))
 	return 1;
 
     sflow_flow_raw = (const struct sflow_expanded_flow_raw_t *)pointer;
+    protocol = EXTRACT_32BITS(sflow_flow_raw->protocol);
+    length = EXTRACT_32BITS(sflow_flow_raw->length);
+    stripped = EXTRACT_32BITS(sflow_flow_raw->stripped_bytes);
+    header_size = EXTRACT_32BITS(sflow_flow_raw->header_size);
     printf("\n\t      protocol %s (%u), length %u, stripped bytes %u, header_size %u",
-	   tok2str(sflow_flow_raw_protocol_values,"Unknown",EXTRACT_32BITS(sflow_flow_raw->protocol)),
-	   EXTRACT_32BITS(sflow_flow_raw->protocol),
-	   EXTRACT_32BITS(sflow_flow_raw->length),
-	   EXTRACT_32BITS(sflow_flow_raw->stripped_bytes),
-	   EXTRACT_32BITS(sflow_flow_raw->header_size));
+	   tok2str(sflow_flow_raw_protocol_values,"Unknown",protocol),
+	   protocol,
+	   length,
+	   stripped,
+	   header_size);
 
-    /* QUESTION - should we attempt to print the raw header itself?
-       assuming of course there is wnough data present to do so... */
+    /*
+     * Hand the sampled header to the link-layer or IP printer, with the
+     * snapshot ending where the header does.  It is one sample of many
+     * packets, so it is printed as nested and doesn't update the state
+     * kept for connections.
+     */
+    len -= sizeof(struct sflow_expanded_flow_raw_t);
+    if (header_size > len)
+	return 1;
+    hdr = pointer + sizeof(struct sflow_expanded_flow_raw_t);
+    length = length > stripped ? length - stripped : 0;
+    if (length < header_size)
+	length = header_size;
+    snapend_save = snapend;
+    if (hdr + header_size < snapend)
+	snapend = hdr + header_size;
+    gndo->ndo_nested++;
+    switch (protocol) {
+    case SFLOW_HEADER_PROTOCOL_ETHERNET:
+	printf("\n\t      ");
+	ether_print(gndo, hdr, length, header_size, NULL, NULL);
+	break;
+    case SFLOW_HEADER_PROTOCOL_IPV4:
+	printf("\n\t      ");
+	ip_print(gndo, hdr, length);
+	break;
+#ifdef INET6
+    case SFLOW_HEADER_PROTOCOL_IPV6:
+	printf("\n\t      ");
+	ip6_print(gndo, hdr, length);
+	break;
+#endif
+    default:
+	break;
+    }
+    gndo->ndo_nested--;
+    snapend = snapend_save;
 
     return 0;
 }
@@ -699,15 +742,15 @@ sflow_print_flow_records(const u_char *pointer, u_int len, u_int records) {
 	if (enterprise == 0) {
 	    switch (flow_type) {
 	    case SFLOW_FLOW_RAW_PACKET:
-		if (print_sflow_raw_packet(tptr,tlen))
+		if (print_sflow_raw_packet(tptr,flow_len))
 		    return 1;
 		break;
 	    case SFLOW_FLOW_EXTENDED_SWITCH_DATA:
-		if (print_sflow_extended_switch_data(tptr,tlen))
+		if (print_sflow_extended_switch_data(tptr,flow_len))
 		    return 1;
 		break;
 	    case SFLOW_FLOW_ETHERNET_FRAME:
-		if (print_sflow_ethernet_frame(tptr,tlen))
+		if (print_sflow_ethernet_frame(tptr,flow_len))
 		    return 1;
 		break;
 		/* FIXME these need a decoder */
@@ -887,22 +930,22 @@ sflow_print(const u_char *pptr, u_int len) {
 
 	switch(sflow_sample_type) {
         case SFLOW_FLOW_SAMPLE:
-	    if (sflow_print_flow_sample(tptr,tlen))
+	    if (sflow_print_flow_sample(tptr,sflow_sample_len))
 		goto trunc;
             break;
 
         case SFLOW_COUNTER_SAMPLE:
-	    if (sflow_print_counter_sample(tptr,tlen))
+	    if (sflow_print_counter_sample(tptr,sflow_sample_len))
 		goto trunc;
             break;
 
         case SFLOW_EXPANDED_FLOW_SAMPLE:
-	    if (sflow_print_expanded_flow_sample(tptr,tlen))
+	    if (sflow_print_expanded_flow_sample(tptr,sflow_sample_len))
 		goto trunc;
 	    break;
 
         case SFLOW_EXPANDED_COUNTER_SAMPLE:
-	    if (sflow_print_expanded_counter_sample(tptr,tlen))
+	    if (sflow_print_expanded_counter_sample(tptr,sflow_sample_len))
 		goto trunc;
 	    break;
 
@@ -921,6 +964,698 @@ sflow_print(const u_char *pptr, u_int len) {
     printf("[|SFLOW]");
 }
 
+/*
+ * Collector mode, for "-o sflow-stats": instead of being printed, the
+ * samples in sFlow version 5 datagrams are added up per agent, per
+ * interface and per source and destination address.
+ *
+ * A flow sample stands for as many frames as its sampling rate; their
+ * length is that of the sampled frame, and their addresses and
+ * protocol are found in the sampled packet header with the summary
+ * modes' header walker, or taken from an IPv4 or IPv6 data record.
+ * Generic interface counter samples are turned into the change of each
+ * counter since the agent's previous sample of the interface, timed by
+ * the agent's uptime, from which its utilisation follows.
+ */
+#define SFLOW_AGENT_HASHSIZE	64
+#define SFLOW_IF_HASHSIZE	1024
+#define SFLOW_TALKER_HASHSIZE	4096
+#define SFLOW_TALKER_MAX	262144	/* sources and destinations tracked */
+#define SFLOW_IF_MAX		65536
+
+struct sflow_agent_key {
+    u_int8_t	af;
+    u_int8_t	pad[3];
+    u_int8_t	addr[16];
+    u_int32_t	sub_id;
+};
+
+struct sflow_agent {
+    struct sflow_agent *next;
+    struct sflow_agent_key key;
+    u_int64_t	datagrams;
+    u_int64_t	flow_samples;
+    u_int64_t	counter_samples;
+    u_int64_t	lost;		/* datagrams, from sequence number gaps */
+    u_int64_t	frames;		/* estimated from the flow samples */
+    u_int64_t	octets;
+    u_int	rate;		/* of the last flow sample */
+    int		seq_valid;
+    u_int32_t	next_seq;
+    u_int32_t	uptime;		/* in ms, from the last datagram */
+};
+
+struct sflow_if {
+    struct sflow_if *next;
+    struct sflow_agent *agent;
+    u_int32_t	ifindex;
+    u_int64_t	speed;		/* in bits/s */
+    int		valid;		/* the counters below are set */
+    u_int32_t	uptime;		/* of the agent at the last sample */
+    u_int64_t	in_octets;
+    u_int64_t	out_octets;
+    u_int32_t	errors;		/* in and out */
+    u_int32_t	discards;
+    /* changes since the last report */
+    u_int64_t	d_ms;
+    u_int64_t	d_in_octets;
+    u_int64_t	d_out_octets;
+    u_int64_t	d_errors;
+    u_int64_t	d_discards;
+};
+
+struct sflow_talker {
+    struct sflow_talker *next;
+    u_int8_t	af;
+    u_int8_t	addr[16];
+    u_int64_t	samples;
+    u_int64_t	frames;
+    u_int64_t	octets;
+};
+
+static struct sflow_agent	*sflow_agents[SFLOW_AGENT_HASHSIZE];
+static u_int			sflow_agent_count;
+static struct sflow_if		*sflow_ifs[SFLOW_IF_HASHSIZE];
+static u_int			sflow_if_count;
+static struct sflow_talker	*sflow_sources[SFLOW_TALKER_HASHSIZE];
+static struct sflow_talker	*sflow_dests[SFLOW_TALKER_HASHSIZE];
+static u_int			sflow_source_count, sflow_dest_count;
+static u_int64_t		sflow_datagrams, sflow_flow_samples;
+static u_int64_t		sflow_counter_samples, sflow_frames, sflow_octets;
+static u_int64_t		sflow_malformed, sflow_untracked;
+static u_int64_t		sflow_proto_octets[256];
+static struct timeval		sflow_first, sflow_last;
+
+static u_int
+sflow_hash(const u_int8_t *p, size_t len)
+{
+    u_int h = 2166136261U;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+	h = (h ^ p[i]) * 16777619U;
+    return h;
+}
+
+static struct sflow_agent *
+sflow_agent(const struct sflow_agent_key *key)
+{
+    struct sflow_agent *agent, **head;
+
+    head = &sflow_agents[sflow_hash((const u_int8_t *)key, sizeof(*key)) %
+	SFLOW_AGENT_HASHSIZE];
+    for (agent = *head; agent != NULL; agent = agent->next)
+	if (memcmp(&agent->key, key, sizeof(*key)) == 0)
+	    return agent;
+    agent = (struct sflow_agent *)pool_alloc(sizeof(*agent));
+    agent->key = *key;
+    agent->next = *head;
+    *head = agent;
+    sflow_agent_count++;
+    return agent;
+}
+
+static struct sflow_if *
+sflow_if(struct sflow_agent *agent, u_int32_t ifindex)
+{
+    struct sflow_if *sif, **head;
+
+    head = &sflow_ifs[(sflow_hash((const u_int8_t *)&agent->key,
+	sizeof(agent->key)) ^ ifindex * 2654435761U) % SFLOW_IF_HASHSIZE];
+    for (sif = *head; sif != NULL; sif = sif->next)
+	if (sif->agent == agent && sif->ifindex == ifindex)
+	    return sif;
+    if (sflow_if_count >= SFLOW_IF_MAX)
+	return NULL;
+    sif = (struct sflow_if *)pool_alloc(sizeof(*sif));
+    sif->agent = agent;
+    sif->ifindex = ifindex;
+    sif->next = *head;
+    *head = sif;
+    sflow_if_count++;
+    return sif;
+}
+
+static struct sflow_talker *
+sflow_talker(struct sflow_talker **tab, u_int *countp, int af,
+	     const u_int8_t *addr)
+{
+    struct sflow_talker *t, **head;
+    size_t len = af == 6 ? 16 : 4;
+
+    head = &tab[sflow_hash(addr, len) % SFLOW_TALKER_HASHSIZE];
+    for (t = *head; t != NULL; t = t->next)
+	if (t->af == af && memcmp(t->addr, addr, len) == 0)
+	    return t;
+    if (sflow_source_count + sflow_dest_count >= SFLOW_TALKER_MAX)
+	return NULL;
+    t = (struct sflow_talker *)pool_alloc(sizeof(*t));
+    t->af = af;
+    memcpy(t->addr, addr, len);
+    t->next = *head;
+    *head = t;
+    (*countp)++;
+    return t;
+}
+
+/*
+ * Adds up the "nrecords" flow records at "tptr" of a flow sample taken
+ * at 1 in "rate" frames.
+ */
+static void
+sflow_stats_flow_sample(struct sflow_agent *agent, u_int rate,
+			const u_char *tptr, u_int tlen, u_int nrecords)
+{
+    struct summary_pkt pkt;
+    struct sflow_talker *t;
+    const u_char *hdr, *src, *dst, *snapend_save;
+    u_int format, rlen, header_size, length, proto;
+    int af, dlt, have_length, tracked;
+    u_int64_t octets;
+
+    af = have_length = 0;
+    src = dst = NULL;
+    length = proto = 0;
+    while (nrecords > 0) {
+	if (tlen < sizeof(struct sflow_flow_record_t)) {
+	    sflow_malformed++;
+	    break;
+	}
+	format = EXTRACT_32BITS(tptr);
+	rlen = EXTRACT_32BITS(tptr + 4);
+	tptr += sizeof(struct sflow_flow_record_t);
+	tlen -= sizeof(struct sflow_flow_record_t);
+	if (tlen < rlen) {
+	    sflow_malformed++;
+	    break;
+	}
+
+	switch (format) {
+
+	case SFLOW_FLOW_RAW_PACKET:
+	    if (rlen < sizeof(struct sflow_expanded_flow_raw_t))
+		break;
+	    length = EXTRACT_32BITS(tptr + 4);
+	    have_length = 1;
+	    header_size = EXTRACT_32BITS(tptr + 12);
+	    if (af != 0 ||
+		header_size > rlen - sizeof(struct sflow_expanded_flow_raw_t))
+		break;
+	    switch (EXTRACT_32BITS(tptr)) {
+	    case SFLOW_HEADER_PROTOCOL_ETHERNET:
+		dlt = DLT_EN10MB;
+		break;
+	    case SFLOW_HEADER_PROTOCOL_IPV4:
+	    case SFLOW_HEADER_PROTOCOL_IPV6:
+		dlt = DLT_RAW;
+		break;
+	    default:
+		dlt = -1;
+		break;
+	    }
+	    if (dlt == -1)
+		break;
+	    hdr = tptr + sizeof(struct sflow_expanded_flow_raw_t);
+	    snapend_save = snapend;
+	    if (hdr + header_size < snapend)
+		snapend = hdr + header_size;
+	    if (summary_frame(gndo, dlt, hdr, &pkt)) {
+		af = pkt.af;
+		src = pkt.src;
+		dst = pkt.dst;
+		proto = pkt.proto;
+	    }
+	    snapend = snapend_save;
+	    break;
+
+	case SFLOW_FLOW_IPV4_DATA:
+	    /* length, protocol, addresses, ports, TCP flags and TOS */
+	    if (rlen < 32)
+		break;
+	    if (!have_length) {
+		length = EXTRACT_32BITS(tptr);
+		have_length = 1;
+	    }
+	    if (af == 0) {
+		af = 4;
+		proto = EXTRACT_32BITS(tptr + 4) & 0xff;
+		src = tptr + 8;
+		dst = tptr + 12;
+	    }
+	    break;
+
+	case SFLOW_FLOW_IPV6_DATA:
+	    if (rlen < 56)
+		break;
+	    if (!have_length) {
+		length = EXTRACT_32BITS(tptr);
+		have_length = 1;
+	    }
+	    if (af == 0) {
+		af = 6;
+		proto = EXTRACT_32BITS(tptr + 4) & 0xff;
+		src = tptr + 8;
+		dst = tptr + 24;
+	    }
+	    break;
+	}
+	tptr += rlen;
+	tlen -= rlen;
+	nrecords--;
+    }
+
+    if (rate == 0)
+	rate = 1;
+    octets = (u_int64_t)rate * length;
+    agent->flow_samples++;
+    agent->frames += rate;
+    agent->octets += octets;
+    agent->rate = rate;
+    sflow_flow_samples++;
+    sflow_frames += rate;
+    sflow_octets += octets;
+    if (af == 0)
+	return;
+    sflow_proto_octets[proto] += octets;
+    tracked = 1;
+    if ((t = sflow_talker(sflow_sources, &sflow_source_count, af, src)) != NULL) {
+	t->samples++;
+	t->frames += rate;
+	t->octets += octets;
+    } else
+	tracked = 0;
+    if ((t = sflow_talker(sflow_dests, &sflow_dest_count, af, dst)) != NULL) {
+	t->samples++;
+	t->frames += rate;
+	t->octets += octets;
+    } else
+	tracked = 0;
+    if (!tracked)
+	sflow_untracked++;
+}
+
+/*
+ * Takes the changes of the counters of a generic interface counter
+ * record since the agent's last one for the interface.  If the agent
+ * has restarted or the counters went back, they only become the new
+ * starting point.
+ */
+static void
+sflow_stats_if(struct sflow_agent *agent,
+	       const struct sflow_generic_counter_t *c)
+{
+    struct sflow_if *sif;
+    u_int64_t in_octets, out_octets;
+    u_int32_t errors, discards;
+
+    sif = sflow_if(agent, EXTRACT_32BITS(c->ifindex));
+    if (sif == NULL)
+	return;
+    in_octets = EXTRACT_64BITS(c->ifinoctets);
+    out_octets = EXTRACT_64BITS(c->ifoutoctets);
+    errors = EXTRACT_32BITS(c->ifinerrors) + EXTRACT_32BITS(c->ifouterrors);
+    discards = EXTRACT_32BITS(c->ifindiscards) +
+	EXTRACT_32BITS(c->ifoutdiscards);
+    sif->speed = EXTRACT_64BITS(c->ifspeed);
+    if (sif->valid && agent->uptime >= sif->uptime &&
+	in_octets >= sif->in_octets && out_octets >= sif->out_octets) {
+	sif->d_ms += agent->uptime - sif->uptime;
+	sif->d_in_octets += in_octets - sif->in_octets;
+	sif->d_out_octets += out_octets - sif->out_octets;
+	sif->d_errors += (u_int32_t)(errors - sif->errors);
+	sif->d_discards += (u_int32_t)(discards - sif->discards);
+    }
+    sif->valid = 1;
+    sif->uptime = agent->uptime;
+    sif->in_octets = in_octets;
+    sif->out_octets = out_octets;
+    sif->errors = errors;
+    sif->discards = discards;
+}
+
+static void
+sflow_stats_counter_sample(struct sflow_agent *agent, const u_char *tptr,
+			   u_int tlen, u_int nrecords)
+{
+    u_int format, rlen;
+
+    agent->counter_samples++;
+    sflow_counter_samples++;
+    while (nrecords > 0) {
+	if (tlen < sizeof(struct sflow_counter_record_t)) {
+	    sflow_malformed++;
+	    break;
+	}
+	format = EXTRACT_32BITS(tptr);
+	rlen = EXTRACT_32BITS(tptr + 4);
+	tptr += sizeof(struct sflow_counter_record_t);
+	tlen -= sizeof(struct sflow_counter_record_t);
+	if (tlen < rlen) {
+	    sflow_malformed++;
+	    break;
+	}
+	if (format == SFLOW_COUNTER_GENERIC &&
+	    rlen >= sizeof(struct sflow_generic_counter_t))
+	    sflow_stats_if(agent, (const struct sflow_generic_counter_t *)tptr);
+	tptr += rlen;
+	tlen -= rlen;
+	nrecords--;
+    }
+}
+
+/*
+ * Adds up the sFlow datagram "dat".
+ */
+void
+sflow_stats_packet(const u_char *dat, u_int length)
+{
+    struct sflow_agent_key key;
+    struct sflow_agent *agent;
+    const struct sflow_flow_sample_t *fs;
+    const struct sflow_expanded_flow_sample_t *xfs;
+    const struct sflow_counter_sample_t *cs;
+    const struct sflow_expanded_counter_sample_t *xcs;
+    const u_char *tptr, *ep;
+    u_int addrlen, nsamples, format, slen;
+    u_int32_t seq, gap;
+
+    if (sflow_first.tv_sec == 0 && sflow_first.tv_usec == 0)
+	sflow_first = gndo->ndo_ts;
+    sflow_last = gndo->ndo_ts;
+    sflow_datagrams++;
+
+    ep = dat + length;
+    if (ep > snapend)
+	ep = snapend;
+    if (ep - dat < 8 || EXTRACT_32BITS(dat) != 5)
+	goto malformed;
+    memset(&key, 0, sizeof(key));
+    switch (EXTRACT_32BITS(dat + 4)) {
+    case 1:
+	key.af = 4;
+	addrlen = 4;
+	break;
+    case 2:
+	key.af = 6;
+	addrlen = 16;
+	break;
+    default:
+	goto malformed;
+    }
+    /* agent address, sub-agent, sequence number, uptime, samples */
+    tptr = dat + 8;
+    if ((u_int)(ep - tptr) < addrlen + 16)
+	goto malformed;
+    memcpy(key.addr, tptr, addrlen);
+    tptr += addrlen;
+    key.sub_id = EXTRACT_32BITS(tptr);
+    agent = sflow_agent(&key);
+    agent->datagrams++;
+    seq = EXTRACT_32BITS(tptr + 4);
+    if (agent->seq_valid) {
+	gap = seq - agent->next_seq;
+	/* ignore reordering and restarts */
+	if (gap != 0 && gap < 0x10000000)
+	    agent->lost += gap;
+    }
+    agent->next_seq = seq + 1;
+    agent->seq_valid = 1;
+    agent->uptime = EXTRACT_32BITS(tptr + 8);
+    nsamples = EXTRACT_32BITS(tptr + 12);
+    tptr += 16;
+
+    while (nsamples > 0) {
+	if (ep - tptr < (int)sizeof(struct sflow_sample_header))
+	    goto malformed;
+	format = EXTRACT_32BITS(tptr);
+	slen = EXTRACT_32BITS(tptr + 4);
+	tptr += sizeof(struct sflow_sample_header);
+	if ((u_int)(ep - tptr) < slen)
+	    goto malformed;
+
+	switch (format) {
+
+	case SFLOW_FLOW_SAMPLE:
+	    if (slen < sizeof(*fs))
+		goto malformed;
+	    fs = (const struct sflow_flow_sample_t *)tptr;
+	    sflow_stats_flow_sample(agent, EXTRACT_32BITS(fs->rate),
+		tptr + sizeof(*fs), slen - sizeof(*fs),
+		EXTRACT_32BITS(fs->records));
+	    break;
+
+	case SFLOW_EXPANDED_FLOW_SAMPLE:
+	    if (slen < sizeof(*xfs))
+		goto malformed;
+	    xfs = (const struct sflow_expanded_flow_sample_t *)tptr;
+	    sflow_stats_flow_sample(agent, EXTRACT_32BITS(xfs->rate),
+		tptr + sizeof(*xfs), slen - sizeof(*xfs),
+		EXTRACT_32BITS(xfs->records));
+	    break;
+
+	case SFLOW_COUNTER_SAMPLE:
+	    if (slen < sizeof(*cs))
+		goto malformed;
+	    cs = (const struct sflow_counter_sample_t *)tptr;
+	    sflow_stats_counter_sample(agent, tptr + sizeof(*cs),
+		slen - sizeof(*cs), EXTRACT_32BITS(cs->records));
+	    break;
+
+	case SFLOW_EXPANDED_COUNTER_SAMPLE:
+	    if (slen < sizeof(*xcs))
+		goto malformed;
+	    xcs = (const struct sflow_expanded_counter_sample_t *)tptr;
+	    sflow_stats_counter_sample(agent, tptr + sizeof(*xcs),
+		slen - sizeof(*xcs), EXTRACT_32BITS(xcs->records));
+	    break;
+	}
+	tptr += slen;
+	nsamples--;
+    }
+    return;
+
+ malformed:
+    sflow_malformed++;
+}
+
+static int
+sflow_talker_cmp(const void *va, const void *vb)
+{
+    const struct sflow_talker *a = *(const struct sflow_talker * const *)va;
+    const struct sflow_talker *b = *(const struct sflow_talker * const *)vb;
+
+    if (a->octets != b->octets)
+	return a->octets < b->octets ? 1 : -1;
+    if (a->frames != b->frames)
+	return a->frames < b->frames ? 1 : -1;
+    if (a->af != b->af)
+	return a->af < b->af ? -1 : 1;
+    return memcmp(a->addr, b->addr, sizeof(a->addr));
+}
+
+static int
+sflow_if_cmp(const void *va, const void *vb)
+{
+    const struct sflow_if *a = *(const struct sflow_if * const *)va;
+    const struct sflow_if *b = *(const struct sflow_if * const *)vb;
+    u_int64_t ao = a->d_in_octets + a->d_out_octets;
+    u_int64_t bo = b->d_in_octets + b->d_out_octets;
+
+    if (ao != bo)
+	return ao < bo ? 1 : -1;
+    if (a->agent != b->agent)
+	return memcmp(&a->agent->key, &b->agent->key, sizeof(a->agent->key));
+    if (a->ifindex != b->ifindex)
+	return a->ifindex < b->ifindex ? -1 : 1;
+    return 0;
+}
+
+static const char *
+sflow_addr_string(int af, const u_int8_t *addr)
+{
+#ifdef INET6
+    if (af == 6)
+	return ip6addr_string(addr);
+#endif
+    return ipaddr_string(addr);
+}
+
+static void
+sflow_talkers_print(struct sflow_talker **tab, u_int count, const char *what)
+{
+    struct sflow_talker **sorted, *t;
+    u_int i, n, top = gndo->ndo_summary_top;
+
+    sorted = (struct sflow_talker **)malloc((count + 1) * sizeof(*sorted));
+    if (sorted == NULL)
+	error("sflow_stats_print: malloc");
+    for (i = n = 0; i < SFLOW_TALKER_HASHSIZE; i++)
+	for (t = tab[i]; t != NULL; t = t->next)
+	    if (t->samples != 0)
+		sorted[n++] = t;
+    qsort(sorted, n, sizeof(*sorted), sflow_talker_cmp);
+    if (top != 0 && n > top)
+	n = top;
+    printf("%10s %14s %16s  %s\n", "samples", "frames", "octets", what);
+    for (i = 0; i < n; i++) {
+	t = sorted[i];
+	printf("%10" PRIu64 " %14" PRIu64 " %16" PRIu64 "  %s\n",
+	       t->samples, t->frames, t->octets,
+	       sflow_addr_string(t->af, t->addr));
+    }
+    free(sorted);
+}
+
+/* Prints the utilisation of "octets" sent in "ms" over "speed" bits/s */
+static void
+sflow_util_print(u_int64_t octets, u_int64_t ms, u_int64_t speed)
+{
+    if (speed == 0 || ms == 0)
+	printf(" %7s", "-");
+    else
+	printf(" %6.2f%%", octets * 8.0 * 1000 * 100 / ((double)ms * speed));
+}
+
+static void
+sflow_ifs_print(void)
+{
+    struct sflow_if **sorted, *sif;
+    u_int i, n, top = gndo->ndo_summary_top;
+
+    sorted = (struct sflow_if **)malloc((sflow_if_count + 1) * sizeof(*sorted));
+    if (sorted == NULL)
+	error("sflow_stats_print: malloc");
+    for (i = n = 0; i < SFLOW_IF_HASHSIZE; i++)
+	for (sif = sflow_ifs[i]; sif != NULL; sif = sif->next)
+	    if (sif->d_ms != 0)
+		sorted[n++] = sif;
+    if (n == 0) {
+	free(sorted);
+	return;
+    }
+    qsort(sorted, n, sizeof(*sorted), sflow_if_cmp);
+    if (top != 0 && n > top)
+	n = top;
+    printf("%16s %7s %16s %7s %10s %10s %14s  %s\n", "in octets", "in",
+	   "out octets", "out", "errors", "discards", "speed", "interface");
+    for (i = 0; i < n; i++) {
+	sif = sorted[i];
+	printf("%16" PRIu64, sif->d_in_octets);
+	sflow_util_print(sif->d_in_octets, sif->d_ms, sif->speed);
+	printf(" %16" PRIu64, sif->d_out_octets);
+	sflow_util_print(sif->d_out_octets, sif->d_ms, sif->speed);
+	printf(" %10" PRIu64 " %10" PRIu64 " %14" PRIu64 "  %s",
+	       sif->d_errors, sif->d_discards, sif->speed,
+	       sflow_addr_string(sif->agent->key.af, sif->agent->key.addr));
+	if (sif->agent->key.sub_id != 0)
+	    printf(" sub-agent %u", sif->agent->key.sub_id);
+	printf(" ifindex %u, %u.%03u seconds\n", sif->ifindex,
+	       (unsigned)(sif->d_ms / 1000), (unsigned)(sif->d_ms % 1000));
+    }
+    free(sorted);
+}
+
+void
+sflow_stats_print(void)
+{
+    struct sflow_agent *agent;
+    struct protoent *pent;
+    struct timeval dur;
+    u_int i;
+    double secs;
+
+    dur.tv_sec = sflow_last.tv_sec - sflow_first.tv_sec;
+    dur.tv_usec = sflow_last.tv_usec - sflow_first.tv_usec;
+    if (dur.tv_usec < 0) {
+	dur.tv_sec--;
+	dur.tv_usec += 1000000;
+    }
+    printf("sFlow summary: %" PRIu64 " datagram%s, %" PRIu64 " flow sample%s, %" PRIu64 " counter sample%s, an estimated %" PRIu64 " frame%s and %" PRIu64 " octet%s in %u.%06u seconds",
+	   sflow_datagrams, PLURAL_SUFFIX(sflow_datagrams),
+	   sflow_flow_samples, PLURAL_SUFFIX(sflow_flow_samples),
+	   sflow_counter_samples, PLURAL_SUFFIX(sflow_counter_samples),
+	   sflow_frames, PLURAL_SUFFIX(sflow_frames),
+	   sflow_octets, PLURAL_SUFFIX(sflow_octets),
+	   (unsigned)dur.tv_sec, (unsigned)dur.tv_usec);
+    secs = dur.tv_sec + dur.tv_usec / 1000000.0;
+    if (secs > 0)
+	printf(" (%.1f frames/s)", sflow_frames / secs);
+    if (sflow_malformed != 0)
+	printf(", %" PRIu64 " malformed", sflow_malformed);
+    if (sflow_untracked != 0)
+	printf(", %" PRIu64 " untracked sample%s", sflow_untracked,
+	       PLURAL_SUFFIX(sflow_untracked));
+    printf("\n");
+    if (sflow_datagrams == 0)
+	return;
+
+    printf("%10s %10s %10s %10s %8s %14s %16s  %s\n", "datagrams",
+	   "flows", "counters", "lost", "rate", "frames", "octets", "agent");
+    for (i = 0; i < SFLOW_AGENT_HASHSIZE; i++)
+	for (agent = sflow_agents[i]; agent != NULL; agent = agent->next) {
+	    if (agent->datagrams == 0)
+		continue;
+	    printf("%10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %8u %14" PRIu64 " %16" PRIu64 "  %s",
+		   agent->datagrams, agent->flow_samples,
+		   agent->counter_samples, agent->lost, agent->rate,
+		   agent->frames, agent->octets,
+		   sflow_addr_string(agent->key.af, agent->key.addr));
+	    if (agent->key.sub_id != 0)
+		printf(" sub-agent %u", agent->key.sub_id);
+	    printf("\n");
+	}
+    sflow_ifs_print();
+    if (sflow_flow_samples == 0)
+	return;
+
+    printf("%16s  %s\n", "octets", "protocol");
+    for (i = 0; i < 256; i++) {
+	if (sflow_proto_octets[i] == 0)
+	    continue;
+	pent = nflag ? NULL : getprotobynumber(i);
+	if (pent != NULL)
+	    printf("%16" PRIu64 "  %s\n", sflow_proto_octets[i], pent->p_name);
+	else
+	    printf("%16" PRIu64 "  %u\n", sflow_proto_octets[i], i);
+    }
+    if (sflow_source_count != 0)
+	sflow_talkers_print(sflow_sources, sflow_source_count, "source");
+    if (sflow_dest_count != 0)
+	sflow_talkers_print(sflow_dests, sflow_dest_count, "destination");
+}
+
+void
+sflow_stats_reset(void)
+{
+    struct sflow_agent *agent;
+    struct sflow_if *sif;
+    struct sflow_talker *t;
+    u_int i;
+
+    for (i = 0; i < SFLOW_AGENT_HASHSIZE; i++)
+	for (agent = sflow_agents[i]; agent != NULL; agent = agent->next) {
+	    agent->datagrams = agent->flow_samples = 0;
+	    agent->counter_samples = agent->lost = 0;
+	    agent->frames = agent->octets = 0;
+	}
+    for (i = 0; i < SFLOW_IF_HASHSIZE; i++)
+	for (sif = sflow_ifs[i]; sif != NULL; sif = sif->next) {
+	    sif->d_ms = sif->d_in_octets = sif->d_out_octets = 0;
+	    sif->d_errors = sif->d_discards = 0;
+	}
+    for (i = 0; i < SFLOW_TALKER_HASHSIZE; i++) {
+	for (t = sflow_sources[i]; t != NULL; t = t->next)
+	    t->samples = t->frames = t->octets = 0;
+	for (t = sflow_dests[i]; t != NULL; t = t->next)
+	    t->samples = t->frames = t->octets = 0;
+    }
+    sflow_datagrams = sflow_flow_samples = sflow_counter_samples = 0;
+    sflow_frames = sflow_octets = 0;
+    sflow_malformed = sflow_untracked = 0;
+    memset(sflow_proto_octets, 0, sizeof(sflow_proto_octets));
+    sflow_first = sflow_last = gndo->ndo_ts;
+}
+
 /*
  * Local Variables:
  * c-style: whitesmith
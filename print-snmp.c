@@ -62,7 +62,10 @@
 
 #include <tcpdump-stdinc.h>
 
+#include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef HAVE_SMI_H
@@ -70,6 +73,9 @@
 #endif
 
 #include "interface.h"
+#include "addrtoname.h"
+#include "scratch.h"
+#include "statecache.h"
 
 #undef OPAQUE  /* defined in <wingdi.h> */
 
@@ -653,6 +659,179 @@ trunc:
 	return -1;
 }
 
+/*
+ * A cache of OID lookups, keyed on the BER encoding of the OID.  This
+ * is a trie with a node for each byte, stored like the compiled-in MIB
+ * tree (first child, next sibling); a sibling that is found is moved
+ * to the front of its list, so the OIDs a poller asks for over and
+ * over are found after a few compares per byte.
+ *
+ * With libsmi, a node remembers what smiGetNodeByOID() returned for
+ * the OID ending there, so an OID seen before costs a walk down the
+ * trie instead of a search of the loaded MIBs.  Names read with
+ * "-o snmp-oids=file" go into the same trie; without -m, an OID is
+ * printed as the name of its longest named prefix followed by the
+ * remaining sub-ids.
+ */
+struct oid_node {
+	struct oid_node *child, *next;
+	const char *name;		/* name loaded for the OID ending here */
+	u_int	requests;		/* -o snmp-stats: times requested */
+#ifdef LIBSMI
+	SmiNode *smi;			/* libsmi node for the OID ending here */
+#endif
+	u_char	byte;			/* BER byte following parent */
+	u_char	flags;
+#define OID_SMI_CACHED	0x01		/* smi is valid (may be NULL) */
+};
+
+#define OID_CACHE_MAX	262144		/* nodes, about 10MB */
+#define OID_MAXBER	128		/* longest OID cached or loaded */
+
+static struct oid_node oid_root;
+static u_int oid_nodes;
+static int oid_names;			/* names were loaded */
+
+/*
+ * Return the node for the OID with BER encoding "p"/"len", adding it
+ * if "create" is set and the cache isn't full, else NULL.
+ */
+static struct oid_node *
+oid_trie_find(const u_char *p, u_int len, int create)
+{
+	struct oid_node *n = &oid_root, *c, **cp;
+
+	for (; len > 0; p++, len--) {
+		for (cp = &n->child; (c = *cp) != NULL; cp = &c->next)
+			if (c->byte == *p)
+				break;
+		if (c != NULL) {
+			if (cp != &n->child) {
+				*cp = c->next;
+				c->next = n->child;
+				n->child = c;
+			}
+		} else {
+			if (!create || oid_nodes >= OID_CACHE_MAX)
+				return NULL;
+			c = (struct oid_node *)pool_alloc(sizeof(*c));
+			c->byte = *p;
+			c->next = n->child;
+			n->child = c;
+			oid_nodes++;
+		}
+		n = c;
+	}
+	return n;
+}
+
+/*
+ * Return the node of the longest named prefix of the OID with BER
+ * encoding "p"/"len", and set "*matched" to its length, or return NULL.
+ */
+static const struct oid_node *
+oid_trie_match(const u_char *p, u_int len, u_int *matched)
+{
+	const struct oid_node *n = &oid_root, *best = NULL;
+	u_int i;
+
+	for (i = 0; i < len; i++) {
+		for (n = n->child; n != NULL; n = n->next)
+			if (n->byte == p[i])
+				break;
+		if (n == NULL)
+			break;
+		/* names end on a sub-id, not inside one */
+		if (n->name != NULL && !(p[i] & ASN_BIT8)) {
+			best = n;
+			*matched = i + 1;
+		}
+	}
+	return best;
+}
+
+/*
+ * Read a file of OID names for "-o snmp-oids=file".  Each line has an
+ * OID in dotted decimal and its name; '#' starts a comment.
+ */
+void
+snmp_load_oids(const char *file)
+{
+	FILE *fp;
+	char line[1024], *p, *name, *end;
+	u_char ber[OID_MAXBER];
+	u_int64_t arc;		/* a sub-id, plus 80 for the second */
+	u_long first = 0;
+	u_int lineno = 0, len, narcs, i;
+	struct oid_node *n;
+
+	fp = fopen(file, "r");
+	if (fp == NULL)
+		error("can't open %s: %s", file, strerror(errno));
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineno++;
+		if ((p = strchr(line, '#')) != NULL)
+			*p = '\0';
+		p = line + strspn(line, " \t\r\n");
+		if (*p == '\0')
+			continue;
+		if (*p == '.')
+			p++;
+
+		len = narcs = 0;
+		for (;;) {
+			if (!isdigit((unsigned char)*p))
+				error("%s:%u: bad OID", file, lineno);
+			errno = 0;
+			arc = strtoul(p, &end, 10);
+			if (errno == ERANGE || arc > 0xffffffffU)
+				error("%s:%u: bad OID", file, lineno);
+			p = end;
+			if (narcs == 0) {
+				if (arc > 2)
+					error("%s:%u: bad OID", file, lineno);
+				first = (u_long)arc;
+			} else {
+				if (narcs == 1) {
+					if (first < 2 && arc >= OIDMUX)
+						error("%s:%u: bad OID", file,
+						    lineno);
+					arc += first * OIDMUX;
+				}
+				/* base 128, most significant group first */
+				for (i = 0; i < 4 && (arc >> (7 * (i + 1))) != 0; i++)
+					continue;
+				if (len + i + 1 > sizeof(ber))
+					error("%s:%u: OID too long", file,
+					    lineno);
+				for (; i > 0; i--)
+					ber[len++] = ASN_BIT8 |
+					    ((arc >> (7 * i)) & ~ASN_BIT8);
+				ber[len++] = arc & ~ASN_BIT8;
+			}
+			narcs++;
+			if (*p != '.')
+				break;
+			p++;
+		}
+		if (narcs < 2 || (*p != ' ' && *p != '\t'))
+			error("%s:%u: bad OID", file, lineno);
+
+		name = p + strspn(p, " \t");
+		p = name + strcspn(name, " \t\r\n");
+		if (p == name)
+			error("%s:%u: missing name", file, lineno);
+		*p = '\0';
+
+		n = oid_trie_find(ber, len, 1);
+		if (n == NULL)
+			error("%s: too many OIDs", file);
+		n->name = pool_strdup(name);
+		oid_names = 1;
+	}
+	fclose(fp);
+}
+
 /*
  * Display the ASN.1 object represented by the BE object.
  * This used to be an integral part of asn1_parse() before the intermediate
@@ -678,8 +857,17 @@ asn1_print(struct be *elem)
 
 	case BE_OID: {
 		int o = 0, first = -1, i = asnlen;
-
-		if (!sflag && !nflag && asnlen > 2) {
+		const struct oid_node *n;
+		u_int matched;
+
+		if (oid_names && !sflag && TTEST2(*p, asnlen) &&
+		    (n = oid_trie_match(p, asnlen, &matched)) != NULL) {
+			fputs(n->name, stdout);
+			objp = NULL;
+			i -= matched;
+			p += matched;
+			first = 0;
+		} else if (!sflag && !nflag && asnlen > 2) {
 			const struct obj_abrev *a = &obj_abrev_list[0];
 			size_t a_len = strlen(a->oid);
 			for (; a->node; a++) {
@@ -1020,6 +1208,30 @@ static int smi_check_range(SmiType *smiType, struct be *elem)
 	return ok;
 }
 
+/*
+ * Look up the OID in "elem", already decoded into "oid"/"oidlen", in
+ * the loaded MIBs, going through the OID cache.
+ */
+static SmiNode *
+smi_lookup_oid(struct be *elem, unsigned int *oid, unsigned int oidlen)
+{
+	struct oid_node *n;
+	SmiNode *smiNode;
+
+	if (elem->asnlen > OID_MAXBER ||
+	    !TTEST2(*elem->data.raw, elem->asnlen))
+		return smiGetNodeByOID(oidlen, oid);
+	n = oid_trie_find((const u_char *)elem->data.raw, elem->asnlen, 1);
+	if (n != NULL && (n->flags & OID_SMI_CACHED))
+		return n->smi;
+	smiNode = smiGetNodeByOID(oidlen, oid);
+	if (n != NULL) {
+		n->smi = smiNode;
+		n->flags |= OID_SMI_CACHED;
+	}
+	return smiNode;
+}
+
 static SmiNode *smi_print_variable(struct be *elem, int *status)
 {
 	unsigned int oid[128], oidlen;
@@ -1030,7 +1242,7 @@ static SmiNode *smi_print_variable(struct be *elem, int *status)
 	    &oidlen);
 	if (*status < 0)
 		return NULL;
-	smiNode = smiGetNodeByOID(oidlen, oid);
+	smiNode = smi_lookup_oid(elem, oid, oidlen);
 	if (! smiNode) {
 		*status = asn1_print(elem);
 		return NULL;
@@ -1114,7 +1326,7 @@ smi_print_value(SmiNode *smiNode, u_char pduid, struct be *elem)
 		        smi_decode_oid(elem, oid,
 				       sizeof(oid)/sizeof(unsigned int),
 				       &oidlen);
-			smiNode = smiGetNodeByOID(oidlen, oid);
+			smiNode = smi_lookup_oid(elem, oid, oidlen);
 			if (smiNode) {
 			        if (vflag) {
 					fputs(smiGetNodeModule(smiNode)->name, stdout);
@@ -1156,6 +1368,570 @@ smi_print_value(SmiNode *smiNode, u_char pduid, struct be *elem)
 }
 #endif
 
+/*
+ * Statistics for "-o snmp-stats", collected as PDUs are printed: PDU,
+ * varbind and error-status counts, and for each requester and agent
+ * the requests, notifications and responses seen and the time from a
+ * request to its response (matched by addresses and request-id).  How
+ * often each OID was asked for is counted in the OID cache trie.
+ */
+struct snmp_pair_key {
+	u_int8_t	af;
+	u_int8_t	requester[16];
+	u_int8_t	agent[16];
+};
+
+struct snmp_pair {
+	struct snmp_pair *next;
+	struct snmp_pair_key key;
+	u_int		pdus;		/* since the last interval report */
+	u_int		requests;
+	u_int		notifications;
+	u_int		responses;	/* matched to a request */
+	u_int		errors;		/* responses with an error-status */
+	u_int64_t	varbinds;
+	u_int64_t	usec;		/* total response time */
+	u_int32_t	min;
+	u_int32_t	max;
+};
+
+struct snmp_req_key {
+	struct snmp_pair_key pair;
+	int32_t		reqid;
+};
+
+struct snmp_req_entry {
+	struct timeval	ts;		/* when the request was seen */
+	int		answered;
+};
+
+#define SNMP_STATS_HASHSIZE	256
+#define SNMP_REQ_MAX		65536	/* outstanding requests remembered */
+#define SNMP_REQ_TIMEOUT	60	/* seconds */
+#define SNMP_NERRORS		(sizeof(ErrorStatus)/sizeof(ErrorStatus[0]))
+
+static int			snmp_af;	/* of the current packet */
+static const u_char		*snmp_src, *snmp_dst;
+static u_int			snmp_varbinds;	/* in the current PDU */
+static struct snmp_pair		*snmp_pairs[SNMP_STATS_HASHSIZE];
+static u_int			snmp_pair_count;
+static struct state_cache	*snmp_reqs;
+static u_int64_t		snmp_pdus[sizeof(Context)/sizeof(Context[0])];
+static u_int64_t		snmp_errors[SNMP_NERRORS + 1];
+static u_int64_t		snmp_total_varbinds;
+static struct timeval		snmp_first, snmp_last;
+static u_int			snmp_oid_count;
+static u_int64_t		snmp_malformed, snmp_encrypted;
+
+/*
+ * Fill in "key" from the addresses of the current packet, sent by the
+ * requester if "from_requester" is set, else by the agent.
+ */
+static void
+snmp_stats_key(struct snmp_pair_key *key, int from_requester)
+{
+	size_t len = snmp_af == 6 ? 16 : 4;
+
+	memset(key, 0, sizeof(*key));
+	key->af = snmp_af;
+	memcpy(key->requester, from_requester ? snmp_src : snmp_dst, len);
+	memcpy(key->agent, from_requester ? snmp_dst : snmp_src, len);
+}
+
+static struct snmp_pair *
+snmp_stats_pair(const struct snmp_pair_key *key)
+{
+	const u_int8_t *p = (const u_int8_t *)key;
+	struct snmp_pair *pair, **head;
+	u_int h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < sizeof(*key); i++)
+		h = (h ^ p[i]) * 16777619U;
+	head = &snmp_pairs[h % SNMP_STATS_HASHSIZE];
+	for (pair = *head; pair != NULL; pair = pair->next)
+		if (memcmp(&pair->key, key, sizeof(*key)) == 0)
+			return pair;
+	pair = (struct snmp_pair *)pool_alloc(sizeof(*pair));
+	pair->key = *key;
+	pair->next = *head;
+	*head = pair;
+	snmp_pair_count++;
+	return pair;
+}
+
+/* Count a request for the OID with BER encoding "oid"/"len" */
+static void
+snmp_stats_oid(const u_char *oid, u_int len)
+{
+	struct oid_node *n;
+
+	if (len > OID_MAXBER)
+		return;
+	n = oid_trie_find(oid, len, 1);
+	if (n != NULL && n->requests++ == 0)
+		snmp_oid_count++;
+}
+
+/*
+ * Record a PDU, with the request-id and error-status of the PDU (0 for
+ * a Trap-PDU) and the varbinds counted in snmp_varbinds.
+ */
+static void
+snmp_stats_pdu(u_short pduid, int32_t reqid, int32_t errstat)
+{
+	struct snmp_req_key rkey;
+	struct snmp_req_entry *req;
+	struct snmp_pair *pair;
+	int request;
+	long sec, usec;
+	u_int32_t t;
+
+	if (snmp_first.tv_sec == 0 && snmp_first.tv_usec == 0)
+		snmp_first = gndo->ndo_ts;
+	snmp_last = gndo->ndo_ts;
+	if (pduid < sizeof(snmp_pdus)/sizeof(snmp_pdus[0]))
+		snmp_pdus[pduid]++;
+	snmp_total_varbinds += snmp_varbinds;
+	if (pduid == GETRESP && errstat != 0)
+		snmp_errors[errstat > 0 && (size_t)errstat < SNMP_NERRORS ?
+		    (size_t)errstat : SNMP_NERRORS]++;
+
+	request = READ_CLASS(pduid) || WRITE_CLASS(pduid) ||
+	    pduid == INFORMREQ;
+	memset(&rkey, 0, sizeof(rkey));
+	snmp_stats_key(&rkey.pair, request);
+	rkey.reqid = reqid;
+	pair = snmp_stats_pair(&rkey.pair);
+	pair->pdus++;
+	pair->varbinds += snmp_varbinds;
+
+	if (request) {
+		pair->requests++;
+		if (snmp_reqs == NULL)
+			snmp_reqs = state_cache_create(gndo, sizeof(rkey),
+			    sizeof(*req), SNMP_REQ_MAX, SNMP_REQ_TIMEOUT);
+		req = (struct snmp_req_entry *)state_cache_enter(gndo,
+		    snmp_reqs, &rkey);
+		req->ts = gndo->ndo_ts;
+		req->answered = 0;
+		return;
+	}
+	if (pduid != GETRESP) {
+		pair->notifications++;
+		return;
+	}
+	if (errstat != 0)
+		pair->errors++;
+	if (snmp_reqs == NULL)
+		return;
+	req = (struct snmp_req_entry *)state_cache_lookup(gndo, snmp_reqs,
+	    &rkey);
+	if (req == NULL || req->answered)
+		return;
+	req->answered = 1;
+
+	sec = gndo->ndo_ts.tv_sec - req->ts.tv_sec;
+	usec = gndo->ndo_ts.tv_usec - req->ts.tv_usec;
+	if (sec < 0 || (sec == 0 && usec < 0))
+		t = 0;
+	else
+		t = (u_int32_t)(sec * 1000000 + usec);
+	if (pair->responses == 0 || t < pair->min)
+		pair->min = t;
+	if (t > pair->max)
+		pair->max = t;
+	pair->responses++;
+	pair->usec += t;
+}
+
+/*
+ * Read the BER element at "*pp", ending before "ep", without printing
+ * anything: its tag goes to "*tagp" and its contents to "*vp"/"*vlenp",
+ * and "*pp" is advanced past it.  Only single-byte tags and lengths of
+ * up to 4 bytes are handled, which is all SNMP uses.  Returns 0 if the
+ * element is malformed or runs past "ep".
+ */
+static int
+snmp_stats_ber(const u_char **pp, const u_char *ep, u_int *tagp,
+	       const u_char **vp, u_int *vlenp)
+{
+	const u_char *p = *pp;
+	u_int len, n;
+
+	if (ep - p < 2 || (*p & ASN_ID_BITS) == ASN_ID_EXT)
+		return 0;
+	*tagp = *p++;
+	len = *p++;
+	if (len & ASN_LONGLEN) {
+		n = len & ~ASN_LONGLEN;
+		if (n == 0 || n > 4 || ep - p < (int)n)
+			return 0;
+		for (len = 0; n > 0; n--)
+			len = (len << 8) | *p++;
+	}
+	if ((u_int)(ep - p) < len)
+		return 0;
+	*vp = p;
+	*vlenp = len;
+	*pp = p + len;
+	return 1;
+}
+
+/* Read a BER INTEGER that fits in 32 bits */
+static int
+snmp_stats_int(const u_char **pp, const u_char *ep, int32_t *valp)
+{
+	const u_char *v;
+	u_int tag, len, i;
+	u_int32_t val;
+
+	if (!snmp_stats_ber(pp, ep, &tag, &v, &len) || tag != 0x02 ||
+	    len == 0 || len > 4)
+		return 0;
+	val = (*v & ASN_BIT8) ? 0xffffffffU : 0;
+	for (i = 0; i < len; i++)
+		val = (val << 8) | v[i];
+	*valp = (int32_t)val;
+	return 1;
+}
+
+/*
+ * Counts the SNMP message "bp" from address "src" to "dst", of address
+ * family "af".  A message whose PDU is encrypted (SNMPv3 with privacy)
+ * is counted, but not looked into.
+ */
+void
+snmp_stats_packet(const u_char *bp, u_int length, int af, const u_char *src,
+		  const u_char *dst)
+{
+	const u_char *p, *ep, *v, *vb, *vbend;
+	u_int tag, len, pduid, i;
+	int32_t version, reqid = 0, errstat = 0, val;
+
+	ep = bp + length;
+	if (ep > snapend)
+		ep = snapend;
+	p = bp;
+	if (!snmp_stats_ber(&p, ep, &tag, &v, &len) || tag != 0x30)
+		goto malformed;
+	p = v;
+	ep = v + len;
+	if (!snmp_stats_int(&p, ep, &version))
+		goto malformed;
+
+	switch (version) {
+
+	case SNMP_VERSION_1:
+	case SNMP_VERSION_2:
+		/* community */
+		if (!snmp_stats_ber(&p, ep, &tag, &v, &len) || tag != 0x04)
+			goto malformed;
+		break;
+
+	case SNMP_VERSION_3:
+		/* msgGlobalData: msgID, msgMaxSize, msgFlags, msgSecurityModel */
+		if (!snmp_stats_ber(&p, ep, &tag, &v, &len) || tag != 0x30)
+			goto malformed;
+		vb = v;
+		vbend = v + len;
+		if (!snmp_stats_int(&vb, vbend, &val) ||
+		    !snmp_stats_int(&vb, vbend, &val) ||
+		    !snmp_stats_ber(&vb, vbend, &tag, &v, &len) ||
+		    tag != 0x04 || len != 1)
+			goto malformed;
+		if (*v & 0x02) {
+			snmp_encrypted++;
+			return;
+		}
+		/* msgSecurityParameters, then the ScopedPDU */
+		if (!snmp_stats_ber(&p, ep, &tag, &v, &len) || tag != 0x04 ||
+		    !snmp_stats_ber(&p, ep, &tag, &v, &len) || tag != 0x30)
+			goto malformed;
+		p = v;
+		ep = v + len;
+		/* contextEngineID, contextName */
+		for (i = 0; i < 2; i++)
+			if (!snmp_stats_ber(&p, ep, &tag, &v, &len) ||
+			    tag != 0x04)
+				goto malformed;
+		break;
+
+	default:
+		goto malformed;
+	}
+
+	if (!snmp_stats_ber(&p, ep, &tag, &v, &len) ||
+	    (tag & ~ASN_ID_BITS) != 0xa0)
+		goto malformed;
+	pduid = tag & ASN_ID_BITS;
+	p = v;
+	ep = v + len;
+	if (pduid == TRAP) {
+		/* enterprise, agent-addr, generic-trap, specific-trap, time-stamp */
+		for (i = 0; i < 5; i++)
+			if (!snmp_stats_ber(&p, ep, &tag, &v, &len))
+				goto malformed;
+	} else if (!snmp_stats_int(&p, ep, &reqid) ||
+	    !snmp_stats_int(&p, ep, &errstat) ||
+	    !snmp_stats_int(&p, ep, &val))
+		goto malformed;
+
+	/* the variable-bindings, a SEQUENCE of SEQUENCE { name, value } */
+	if (!snmp_stats_ber(&p, ep, &tag, &v, &len) || tag != 0x30)
+		goto malformed;
+	snmp_af = af;
+	snmp_src = src;
+	snmp_dst = dst;
+	snmp_varbinds = 0;
+	p = v;
+	ep = v + len;
+	while (p < ep) {
+		if (!snmp_stats_ber(&p, ep, &tag, &v, &len) || tag != 0x30)
+			goto malformed;
+		vb = v;
+		vbend = v + len;
+		if (!snmp_stats_ber(&vb, vbend, &tag, &v, &len) || tag != 0x06)
+			goto malformed;
+		snmp_varbinds++;
+		if (READ_CLASS(pduid) || WRITE_CLASS(pduid))
+			snmp_stats_oid(v, len);
+	}
+	snmp_stats_pdu(pduid, reqid, errstat);
+	return;
+
+malformed:
+	snmp_malformed++;
+}
+
+static int
+snmp_pair_cmp(const void *va, const void *vb)
+{
+	const struct snmp_pair *a = *(const struct snmp_pair * const *)va;
+	const struct snmp_pair *b = *(const struct snmp_pair * const *)vb;
+
+	if (a->requests + a->notifications != b->requests + b->notifications)
+		return a->requests + a->notifications <
+		    b->requests + b->notifications ? 1 : -1;
+	return memcmp(&a->key, &b->key, sizeof(a->key));
+}
+
+static const char *
+snmp_addr_string(const struct snmp_pair *pair, const u_int8_t *addr)
+{
+#ifdef INET6
+	if (pair->key.af == 6)
+		return ip6addr_string(addr);
+#endif
+	return ipaddr_string(addr);
+}
+
+struct snmp_oid_stat {
+	const struct oid_node *node;
+	char	*oid;
+};
+
+static int
+snmp_oid_cmp(const void *va, const void *vb)
+{
+	const struct snmp_oid_stat *a = (const struct snmp_oid_stat *)va;
+	const struct snmp_oid_stat *b = (const struct snmp_oid_stat *)vb;
+
+	if (a->node->requests != b->node->requests)
+		return a->node->requests < b->node->requests ? 1 : -1;
+	return strcmp(a->oid, b->oid);
+}
+
+/*
+ * Format the OID with BER encoding "ber"/"len" in dotted decimal, or
+ * as a name loaded with "-o snmp-oids" followed by the other sub-ids.
+ */
+static char *
+snmp_oid_string(const u_char *ber, u_int len)
+{
+	char buf[OID_MAXBER * 11 + 256], *cp = buf, *end = buf + sizeof(buf);
+	const struct oid_node *n;
+	u_int i = 0, matched, first = 1;
+	u_int32_t o = 0;
+
+	*cp = '\0';
+	if (oid_names && (n = oid_trie_match(ber, len, &matched)) != NULL) {
+		cp += snprintf(cp, end - cp, "%s", n->name);
+		i = matched;
+		first = 0;
+	}
+	for (; i < len && cp < end - 24; i++) {
+		o = (o << ASN_SHIFT7) | (ber[i] & ~ASN_BIT8);
+		if (ber[i] & ASN_LONGLEN)
+			continue;
+		if (first) {
+			u_int s = o / OIDMUX;
+
+			if (s > 2)
+				s = 2;
+			cp += snprintf(cp, end - cp, ".%u", s);
+			o -= s * OIDMUX;
+			first = 0;
+		}
+		cp += snprintf(cp, end - cp, ".%u", o);
+		o = 0;
+	}
+	return strdup(buf);
+}
+
+static void
+snmp_oid_collect(const struct oid_node *n, u_char *ber, u_int depth,
+		 struct snmp_oid_stat *stats, u_int *count)
+{
+	const struct oid_node *c;
+
+	if (n->requests != 0) {
+		stats[*count].node = n;
+		stats[*count].oid = snmp_oid_string(ber, depth);
+		if (stats[*count].oid == NULL)
+			error("snmp_stats_print: strdup");
+		(*count)++;
+	}
+	if (depth == OID_MAXBER)
+		return;
+	for (c = n->child; c != NULL; c = c->next) {
+		ber[depth] = c->byte;
+		snmp_oid_collect(c, ber, depth + 1, stats, count);
+	}
+}
+
+void
+snmp_stats_print(void)
+{
+	struct snmp_pair **sorted, *pair;
+	struct snmp_oid_stat *stats;
+	struct timeval dur;
+	u_char *ber;
+	u_int64_t pdus = 0;
+	u_int i, n, avg, top = gndo->ndo_summary_top;
+	double secs;
+
+	for (i = 0; i < sizeof(snmp_pdus)/sizeof(snmp_pdus[0]); i++)
+		pdus += snmp_pdus[i];
+	dur.tv_sec = snmp_last.tv_sec - snmp_first.tv_sec;
+	dur.tv_usec = snmp_last.tv_usec - snmp_first.tv_usec;
+	if (dur.tv_usec < 0) {
+		dur.tv_sec--;
+		dur.tv_usec += 1000000;
+	}
+	printf("SNMP summary: %" PRIu64 " PDU%s, %" PRIu64 " varbind%s in %u.%06u seconds",
+	    pdus, PLURAL_SUFFIX(pdus),
+	    snmp_total_varbinds, PLURAL_SUFFIX(snmp_total_varbinds),
+	    (unsigned)dur.tv_sec, (unsigned)dur.tv_usec);
+	secs = dur.tv_sec + dur.tv_usec / 1000000.0;
+	if (secs > 0)
+		printf(" (%.1f varbinds/s)", snmp_total_varbinds / secs);
+	if (snmp_encrypted != 0)
+		printf(", %" PRIu64 " encrypted", snmp_encrypted);
+	if (snmp_malformed != 0)
+		printf(", %" PRIu64 " malformed", snmp_malformed);
+	printf("\n");
+	if (pdus == 0)
+		return;
+
+	for (i = 0; i < sizeof(snmp_pdus)/sizeof(snmp_pdus[0]); i++)
+		if (snmp_pdus[i] != 0)
+			printf("%12" PRIu64 "  %s\n", snmp_pdus[i], Context[i]);
+	for (i = 1; i <= SNMP_NERRORS; i++)
+		if (snmp_errors[i] != 0)
+			printf("%12" PRIu64 "  %s responses\n", snmp_errors[i],
+			    i < SNMP_NERRORS ? ErrorStatus[i] : "other error");
+
+	if (snmp_pair_count != 0) {
+		sorted = (struct snmp_pair **)malloc(snmp_pair_count * sizeof(*sorted));
+		if (sorted == NULL)
+			error("snmp_stats_print: malloc");
+		for (i = n = 0; i < SNMP_STATS_HASHSIZE; i++)
+			for (pair = snmp_pairs[i]; pair != NULL; pair = pair->next)
+				if (pair->pdus != 0)
+					sorted[n++] = pair;
+		qsort(sorted, n, sizeof(*sorted), snmp_pair_cmp);
+		if (top != 0 && n > top)
+			n = top;
+
+		if (n != 0)
+			printf("%8s %8s %8s %8s %10s %12s %12s %12s  %s\n",
+				    "requests", "traps", "answered", "errors",
+			    "varbinds", "min", "avg", "max",
+			    "requester > agent");
+		for (i = 0; i < n; i++) {
+			pair = sorted[i];
+			avg = pair->responses ?
+			    (u_int)(pair->usec / pair->responses) : 0;
+			printf("%8u %8u %8u %8u %10" PRIu64 " %5u.%06u %5u.%06u %5u.%06u  ",
+			    pair->requests, pair->notifications,
+			    pair->responses, pair->errors, pair->varbinds,
+			    pair->min / 1000000, pair->min % 1000000,
+			    avg / 1000000, avg % 1000000,
+			    pair->max / 1000000, pair->max % 1000000);
+			printf("%s > ", snmp_addr_string(pair, pair->key.requester));
+			printf("%s\n", snmp_addr_string(pair, pair->key.agent));
+		}
+		free(sorted);
+	}
+
+	if (snmp_oid_count != 0) {
+		stats = (struct snmp_oid_stat *)malloc(snmp_oid_count * sizeof(*stats));
+		ber = (u_char *)malloc(OID_MAXBER);
+		if (stats == NULL || ber == NULL)
+			error("snmp_stats_print: malloc");
+		n = 0;
+		snmp_oid_collect(&oid_root, ber, 0, stats, &n);
+		qsort(stats, n, sizeof(*stats), snmp_oid_cmp);
+		printf("%8s  %s\n", "requests", "OID");
+		for (i = 0; i < n; i++) {
+			if (top == 0 || i < top)
+				printf("%8u  %s\n", stats[i].node->requests,
+				    stats[i].oid);
+			free(stats[i].oid);
+		}
+		free(stats);
+		free(ber);
+	}
+}
+
+static void
+snmp_oid_reset(struct oid_node *n)
+{
+	struct oid_node *c;
+
+	n->requests = 0;
+	for (c = n->child; c != NULL; c = c->next)
+		snmp_oid_reset(c);
+}
+
+/*
+ * Start counting again after an interval report.  Requesters and agents
+ * seen so far are kept, as are outstanding requests, so that responses
+ * that arrive after the report are still matched.
+ */
+void
+snmp_stats_reset(void)
+{
+	struct snmp_pair *pair;
+	u_int i;
+
+	for (i = 0; i < SNMP_STATS_HASHSIZE; i++)
+		for (pair = snmp_pairs[i]; pair != NULL; pair = pair->next) {
+			pair->pdus = pair->requests = pair->notifications = 0;
+			pair->responses = pair->errors = 0;
+			pair->varbinds = pair->usec = 0;
+			pair->min = pair->max = 0;
+		}
+	snmp_oid_reset(&oid_root);
+	snmp_oid_count = 0;
+	memset(snmp_pdus, 0, sizeof(snmp_pdus));
+	memset(snmp_errors, 0, sizeof(snmp_errors));
+	snmp_total_varbinds = 0;
+	snmp_malformed = snmp_encrypted = 0;
+	snmp_first = snmp_last = gndo->ndo_ts;
+}
+
 /*
  * General SNMP header
  *	SEQUENCE {
@@ -1293,6 +2069,7 @@ snmppdu_print(u_short pduid, const u_char *np, u_int length)
 {
 	struct be elem;
 	int count = 0, error;
+	int32_t reqid, errstat;
 
 	/* reqId (Integer) */
 	if ((count = asn1_parse(np, length, &elem)) < 0)
@@ -1304,6 +2081,7 @@ snmppdu_print(u_short pduid, const u_char *np, u_int length)
 	}
 	if (vflag)
 		printf("R=%d ", elem.data.integer);
+	reqid = elem.data.integer;
 	length -= count;
 	np += count;
 
@@ -1315,6 +2093,7 @@ snmppdu_print(u_short pduid, const u_char *np, u_int length)
 		asn1_print(&elem);
 		return;
 	}
+	errstat = elem.data.integer;
 	error = 0;
 	if ((pduid == GETREQ || pduid == GETNEXTREQ || pduid == SETREQ
 	    || pduid == INFORMREQ || pduid == V2TRAP || pduid == REPORT)
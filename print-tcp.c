@@ -53,6 +53,11 @@ __RCSID("$NetBSD: print-tcp.c,v 1.8 2007/07/24 11:53:48 drochner Exp $");
 #include "rpc_msg.h"
 
 #include "nameser.h"
+#include "dissector.h"
+#include "porttable.h"
+#include "scratch.h"
+#include "statecache.h"
+#include "tcpanalysis.h"
 
 #ifdef HAVE_LIBCRYPTO
 #include <openssl/md5.h>
@@ -73,9 +78,8 @@ struct tha {
         u_int port;
 };
 
+/* initial sequence numbers of a conversation, keyed by tha or tha6 */
 struct tcp_seq_hash {
-        struct tcp_seq_hash *nxt;
-        struct tha addr;
         tcp_seq seq;
         tcp_seq ack;
 };
@@ -86,25 +90,30 @@ struct tha6 {
         struct in6_addr dst;
         u_int port;
 };
-
-struct tcp_seq_hash6 {
-        struct tcp_seq_hash6 *nxt;
-        struct tha6 addr;
-        tcp_seq seq;
-        tcp_seq ack;
-};
 #endif
 
-#define TSEQ_HASHSIZE 919
+/*
+ * Conversations whose initial sequence numbers are remembered; beyond
+ * that, the least recently seen one is forgotten.
+ */
+#define TSEQ_MAX        (1 << 24)
 
 /* These tcp optinos do not have the size octet */
 #define ZEROLENOPT(o) ((o) == TCPOPT_EOL || (o) == TCPOPT_NOP)
 
-static struct tcp_seq_hash tcp_seq_hash4[TSEQ_HASHSIZE];
+static struct state_cache *tcp_seq_hash4;
 #ifdef INET6
-static struct tcp_seq_hash6 tcp_seq_hash6[TSEQ_HASHSIZE];
+static struct state_cache *tcp_seq_hash6;
 #endif
 
+/*
+ * Used for a nested header (quoted in an ICMP error or sampled by sFlow)
+ * of a conversation that isn't known, or that has SYN set: such a header
+ * neither starts nor restarts a conversation, and is shown with absolute
+ * sequence numbers.
+ */
+static struct tcp_seq_hash tcp_seq_absolute;
+
 static const struct tok tcp_flag_values[] = {
         { TH_FIN, "F" },
         { TH_SYN, "S" },
@@ -133,11 +142,75 @@ static const struct tok tcp_option_values[] = {
         { TCPOPT_SIGNATURE, "md5" },
         { TCPOPT_AUTH, "enhanced auth" },
         { TCPOPT_UTO, "uto" },
+        { TCPOPT_TCPAO, "tcp-ao" },
         { TCPOPT_MPTCP, "mptcp" },
         { TCPOPT_EXPERIMENT2, "exp" },
         { 0, NULL }
 };
 
+/*
+ * Printers for TCP payloads chosen by port; see porttable.h.
+ */
+enum {
+        TCP_PR_NONE,
+        TCP_PR_TELNET,
+        TCP_PR_BGP,
+        TCP_PR_PPTP,
+        TCP_PR_NBT_SSN,
+        TCP_PR_SMB,
+        TCP_PR_BEEP,
+        TCP_PR_OPENFLOW,
+        TCP_PR_DNS,
+        TCP_PR_MSDP,
+        TCP_PR_RPKI_RTR,
+        TCP_PR_LDP,
+        TCP_PR_NFS
+};
+
+static const struct tok tcp_printers[] = {
+        { TCP_PR_TELNET,        "telnet" },
+        { TCP_PR_BGP,           "bgp" },
+        { TCP_PR_PPTP,          "pptp" },
+#ifdef TCPDUMP_DO_SMB
+        { TCP_PR_NBT_SSN,       "nbt-ssn" },
+        { TCP_PR_SMB,           "smb" },
+#endif
+        { TCP_PR_BEEP,          "beep" },
+        { TCP_PR_OPENFLOW,      "openflow" },
+        { TCP_PR_DNS,           "dns" },
+        { TCP_PR_MSDP,          "msdp" },
+        { TCP_PR_RPKI_RTR,      "rpki-rtr" },
+        { TCP_PR_LDP,           "ldp" },
+        { TCP_PR_NFS,           "nfs" },
+        { 0, NULL }
+};
+
+#define TCP_PORT(port, printer) { port, port, PORT_ANY, printer }
+
+/* In order of precedence */
+static const struct port_entry tcp_builtin_ports[] = {
+        TCP_PORT(TELNET_PORT,           TCP_PR_TELNET),
+        TCP_PORT(BGP_PORT,              TCP_PR_BGP),
+        TCP_PORT(PPTP_PORT,             TCP_PR_PPTP),
+#ifdef TCPDUMP_DO_SMB
+        TCP_PORT(NETBIOS_SSN_PORT,      TCP_PR_NBT_SSN),
+        TCP_PORT(SMB_PORT,              TCP_PR_SMB),
+#endif
+        TCP_PORT(BEEP_PORT,             TCP_PR_BEEP),
+        TCP_PORT(OPENFLOW_PORT,         TCP_PR_OPENFLOW),
+        TCP_PORT(NAMESERVER_PORT,       TCP_PR_DNS),
+        TCP_PORT(MULTICASTDNS_PORT,     TCP_PR_DNS),
+        TCP_PORT(MSDP_PORT,             TCP_PR_MSDP),
+        TCP_PORT(RPKI_RTR_PORT,         TCP_PR_RPKI_RTR),
+        TCP_PORT(LDP_PORT,              TCP_PR_LDP),
+        TCP_PORT(NFS_PORT,              TCP_PR_NFS),
+        { 0, 0, 0, TCP_PR_NONE }
+};
+
+struct port_table tcp_port_table = {
+        "tcp", tcp_printers, tcp_builtin_ports
+};
+
 static int tcp_cksum(register const struct ip *ip,
 		     register const struct tcphdr *tp,
 		     register u_int len)
@@ -160,6 +233,9 @@ tcp_print(register const u_char *bp, register u_int length,
         u_int utoval;
         u_int16_t magic;
         register int rev;
+        int todst;
+        u_int printer;
+        struct tcp_analysis_result tcpa;
 #ifdef INET6
         register const struct ip6_hdr *ip6;
 #endif
@@ -225,12 +301,34 @@ tcp_print(register const u_char *bp, register u_int length,
         win = EXTRACT_16BITS(&tp->th_win);
         urp = EXTRACT_16BITS(&tp->th_urp);
 
+        /*
+         * Track the connection for -o tcp-analysis; the findings are
+         * printed after the options, or after the length with -q.  A header quoted in an ICMP error
+         * or sampled by sFlow isn't a segment of the connection.
+         */
+        tcpa.flags = 0;
+        if (gndo->ndo_tcp_analysis && !gndo->ndo_nested) {
+#ifdef INET6
+                if (ip6)
+                        tcp_analysis_update(gndo, 6,
+                                            (const u_char *)&ip6->ip6_src,
+                                            (const u_char *)&ip6->ip6_dst,
+                                            tp, length, &tcpa);
+                else
+#endif
+                        tcp_analysis_update(gndo, 4,
+                                            (const u_char *)&ip->ip_src,
+                                            (const u_char *)&ip->ip_dst,
+                                            tp, length, &tcpa);
+        }
+
         if (qflag) {
                 (void)printf("tcp %d", length - hlen);
                 if (hlen > length) {
                         (void)printf(" [bad hdr length %u - too long, > %u]",
                                      hlen, length);
                 }
+                tcp_analysis_print_result(gndo, &tcpa);
                 return;
         }
 
@@ -247,12 +345,13 @@ tcp_print(register const u_char *bp, register u_int length,
                 rev = 0;
 #ifdef INET6
                 if (ip6) {
-                        register struct tcp_seq_hash6 *th;
-                        struct tcp_seq_hash6 *tcp_seq_hash;
+                        register struct tcp_seq_hash *th;
                         const struct in6_addr *src, *dst;
                         struct tha6 tha;
 
-                        tcp_seq_hash = tcp_seq_hash6;
+                        if (tcp_seq_hash6 == NULL)
+                                tcp_seq_hash6 = state_cache_create(gndo,
+                                    sizeof(tha), sizeof(*th), TSEQ_MAX, 0);
                         src = &ip6->ip6_src;
                         dst = &ip6->ip6_dst;
                         if (sport > dport)
@@ -271,21 +370,18 @@ tcp_print(register const u_char *bp, register u_int length,
                                 tha.port = sport << 16 | dport;
                         }
 
-                        for (th = &tcp_seq_hash[tha.port % TSEQ_HASHSIZE];
-                             th->nxt; th = th->nxt)
-                                if (memcmp((char *)&tha, (char *)&th->addr,
-                                           sizeof(th->addr)) == 0)
-                                        break;
+                        th = (struct tcp_seq_hash *)
+                                state_cache_lookup(gndo, tcp_seq_hash6, &tha);
 
-                        if (!th->nxt || (flags & TH_SYN)) {
+                        if (gndo->ndo_nested &&
+                            (th == NULL || (flags & TH_SYN))) {
+                                th = &tcp_seq_absolute;
+                        } else if (th == NULL || (flags & TH_SYN)) {
                                 /* didn't find it or new conversation */
-                                if (th->nxt == NULL) {
-                                        th->nxt = (struct tcp_seq_hash6 *)
-                                                calloc(1, sizeof(*th));
-                                        if (th->nxt == NULL)
-                                                error("tcp_print: calloc");
-                                }
-                                th->addr = tha;
+                                if (th == NULL)
+                                        th = (struct tcp_seq_hash *)
+                                                state_cache_enter(gndo,
+                                                    tcp_seq_hash6, &tha);
                                 if (rev)
                                         th->ack = seq, th->seq = ack - 1;
                                 else
@@ -304,11 +400,12 @@ tcp_print(register const u_char *bp, register u_int length,
                 {
 #endif /*INET6*/
                         register struct tcp_seq_hash *th;
-                        struct tcp_seq_hash *tcp_seq_hash;
                         const struct in_addr *src, *dst;
                         struct tha tha;
 
-                        tcp_seq_hash = tcp_seq_hash4;
+                        if (tcp_seq_hash4 == NULL)
+                                tcp_seq_hash4 = state_cache_create(gndo,
+                                    sizeof(tha), sizeof(*th), TSEQ_MAX, 0);
                         src = &ip->ip_src;
                         dst = &ip->ip_dst;
                         if (sport > dport)
@@ -327,21 +424,18 @@ tcp_print(register const u_char *bp, register u_int length,
                                 tha.port = sport << 16 | dport;
                         }
 
-                        for (th = &tcp_seq_hash[tha.port % TSEQ_HASHSIZE];
-                             th->nxt; th = th->nxt)
-                                if (memcmp((char *)&tha, (char *)&th->addr,
-                                           sizeof(th->addr)) == 0)
-                                        break;
+                        th = (struct tcp_seq_hash *)
+                                state_cache_lookup(gndo, tcp_seq_hash4, &tha);
 
-                        if (!th->nxt || (flags & TH_SYN)) {
+                        if (gndo->ndo_nested &&
+                            (th == NULL || (flags & TH_SYN))) {
+                                th = &tcp_seq_absolute;
+                        } else if (th == NULL || (flags & TH_SYN)) {
                                 /* didn't find it or new conversation */
-                                if (th->nxt == NULL) {
-                                        th->nxt = (struct tcp_seq_hash *)
-                                                calloc(1, sizeof(*th));
-                                        if (th->nxt == NULL)
-                                                error("tcp_print: calloc");
-                                }
-                                th->addr = tha;
+                                if (th == NULL)
+                                        th = (struct tcp_seq_hash *)
+                                                state_cache_enter(gndo,
+                                                    tcp_seq_hash4, &tha);
                                 if (rev)
                                         th->ack = seq, th->seq = ack - 1;
                                 else
@@ -573,6 +667,20 @@ tcp_print(register const u_char *bp, register u_int length,
                                 (void)printf(" %u", utoval);
                                 break;
 
+                        case TCPOPT_TCPAO:
+                                datalen = len - 2;
+                                if (datalen < 2)
+                                        goto bad;
+                                LENCHECK(datalen);
+                                (void)printf(" keyid %u rnextkeyid %u",
+                                             cp[0], cp[1]);
+                                if (datalen > 2) {
+                                        (void)printf(" mac 0x");
+                                        for (i = 2; i < datalen; ++i)
+                                                (void)printf("%02x", cp[i]);
+                                }
+                                break;
+
                         case TCPOPT_MPTCP:
                                 datalen = len - 2;
                                 LENCHECK(datalen);
@@ -647,6 +755,7 @@ tcp_print(register const u_char *bp, register u_int length,
          * Print length field before crawling down the stack.
          */
         printf(", length %u", length);
+        tcp_analysis_print_result(gndo, &tcpa);
 
         if (length <= 0)
                 return;
@@ -669,68 +778,102 @@ tcp_print(register const u_char *bp, register u_int length,
                 return;
         }
 
-        if (sport == TELNET_PORT || dport == TELNET_PORT) {
+        printer = port_table_lookup(&tcp_port_table, sport, dport, &todst);
+        switch (printer) {
+
+        case TCP_PR_TELNET:
                 if (!qflag && vflag)
                         telnet_print(gndo, bp, length);
-        } else if (sport == BGP_PORT || dport == BGP_PORT)
+                break;
+
+        case TCP_PR_BGP:
                 bgp_print(bp, length);
-        else if (sport == PPTP_PORT || dport == PPTP_PORT)
+                break;
+
+        case TCP_PR_PPTP:
                 pptp_print(gndo, bp);
+                break;
+
 #ifdef TCPDUMP_DO_SMB
-        else if (sport == NETBIOS_SSN_PORT || dport == NETBIOS_SSN_PORT)
+        case TCP_PR_NBT_SSN:
                 nbt_tcp_print(bp, length);
-	else if (sport == SMB_PORT || dport == SMB_PORT)
-		smb_tcp_print(bp, length);
+                break;
+
+        case TCP_PR_SMB:
+                smb_tcp_print(bp, length);
+                break;
 #endif
-        else if (sport == BEEP_PORT || dport == BEEP_PORT)
+
+        case TCP_PR_BEEP:
                 beep_print(gndo, bp, length);
-        else if (sport == OPENFLOW_PORT || dport == OPENFLOW_PORT)
+                break;
+
+        case TCP_PR_OPENFLOW:
                 openflow_print(gndo, bp, length);
-        else if (length > 2 &&
-                 (sport == NAMESERVER_PORT || dport == NAMESERVER_PORT ||
-                  sport == MULTICASTDNS_PORT || dport == MULTICASTDNS_PORT)) {
+                break;
+
+        case TCP_PR_DNS:
                 /*
                  * TCP DNS query has 2byte length at the head.
                  * XXX packet could be unaligned, it can go strange
                  */
-                ns_print(bp + 2, length - 2, 0);
-        } else if (sport == MSDP_PORT || dport == MSDP_PORT) {
+                if (length > 2)
+                        ns_print(bp + 2, length - 2, 0);
+                break;
+
+        case TCP_PR_MSDP:
                 msdp_print(gndo, bp, length);
-        } else if (sport == RPKI_RTR_PORT || dport == RPKI_RTR_PORT) {
+                break;
+
+        case TCP_PR_RPKI_RTR:
                 rpki_rtr_print(gndo, bp, length);
-        }
-        else if (length > 0 && (sport == LDP_PORT || dport == LDP_PORT)) {
+                break;
+
+        case TCP_PR_LDP:
                 ldp_print(gndo, bp, length);
-        }
-        else if ((sport == NFS_PORT || dport == NFS_PORT) &&
-                 length >= 4 && TTEST2(*bp, 4)) {
+                break;
+
+        case TCP_PR_NFS:
                 /*
                  * If data present, header length valid, and NFS port used,
                  * assume NFS.
                  * Pass offset of data plus 4 bytes for RPC TCP msg length
                  * to NFS print routines.
                  */
-                u_int32_t fraglen;
-                register struct sunrpc_msg *rp;
-                enum sunrpc_msg_type direction;
-
-                fraglen = EXTRACT_32BITS(bp) & 0x7FFFFFFF;
-                if (fraglen > (length) - 4)
-                        fraglen = (length) - 4;
-                rp = (struct sunrpc_msg *)(bp + 4);
-                if (TTEST(rp->rm_direction)) {
-                        direction = (enum sunrpc_msg_type)EXTRACT_32BITS(&rp->rm_direction);
-                        if (dport == NFS_PORT && direction == SUNRPC_CALL) {
-                                (void)printf(": NFS request xid %u ", EXTRACT_32BITS(&rp->rm_xid));
-                                nfsreq_print_noaddr((u_char *)rp, fraglen, (u_char *)ip);
-                                return;
-                        }
-                        if (sport == NFS_PORT && direction == SUNRPC_REPLY) {
-                                (void)printf(": NFS reply xid %u ", EXTRACT_32BITS(&rp->rm_xid));
-                                nfsreply_print_noaddr((u_char *)rp, fraglen, (u_char *)ip);
-                                return;
+                if (length >= 4 && TTEST2(*bp, 4)) {
+                        u_int32_t fraglen;
+                        register struct sunrpc_msg *rp;
+                        enum sunrpc_msg_type direction;
+                        u_int nfsport = todst ? dport : sport;
+
+                        fraglen = EXTRACT_32BITS(bp) & 0x7FFFFFFF;
+                        if (fraglen > (length) - 4)
+                                fraglen = (length) - 4;
+                        rp = (struct sunrpc_msg *)(bp + 4);
+                        if (TTEST(rp->rm_direction)) {
+                                direction = (enum sunrpc_msg_type)EXTRACT_32BITS(&rp->rm_direction);
+                                if (dport == nfsport && direction == SUNRPC_CALL) {
+                                        (void)printf(": NFS request xid %u ", EXTRACT_32BITS(&rp->rm_xid));
+                                        nfsreq_print_noaddr((u_char *)rp, fraglen, (u_char *)ip);
+                                        return;
+                                }
+                                if (sport == nfsport && direction == SUNRPC_REPLY) {
+                                        (void)printf(": NFS reply xid %u ", EXTRACT_32BITS(&rp->rm_xid));
+                                        nfsreply_print_noaddr((u_char *)rp, fraglen, (u_char *)ip);
+                                        return;
+                                }
                         }
                 }
+                break;
+
+        default:
+                if (printer >= PORT_DYNAMIC) {
+                        /* the built-in printers start with this themselves */
+                        fputs(": ", stdout);
+                        (*port_table_dissector(&tcp_port_table, printer))
+                            (gndo, bp, length, (const u_char *)ip);
+                }
+                break;
         }
 
         return;
@@ -789,13 +932,16 @@ tcp_verify_signature(const struct ip *ip, const struct tcphdr *tp,
 {
         struct tcphdr tp1;
         u_char sig[TCP_SIGLEN];
-        char zero_proto = 0;
         MD5_CTX ctx;
-        u_int16_t savecsum, tlen;
+        u_int16_t tlen;
+        /* pseudo-header and TCP header, hashed in one go */
+        u_char hdr[40 + sizeof(struct tcphdr)];
+        u_char *hp;
+        static const char *secret;
+        static size_t secretlen;
 #ifdef INET6
         struct ip6_hdr *ip6;
         u_int32_t len32;
-        u_int8_t nxt;
 #endif
 
 	if (data + length > snapend) {
@@ -809,32 +955,40 @@ tcp_verify_signature(const struct ip *ip, const struct tcphdr *tp,
 		printf("shared secret not supplied with -M, ");
                 return (CANT_CHECK_SIGNATURE);
         }
+        if (secret != sigsecret) {
+                secret = sigsecret;
+                secretlen = strlen(sigsecret);
+        }
 
-        MD5_Init(&ctx);
         /*
-         * Step 1: Update MD5 hash with IP pseudo-header.
+         * Step 1: IP pseudo-header.
          */
+        hp = hdr;
         if (IP_V(ip) == 4) {
-                MD5_Update(&ctx, (char *)&ip->ip_src, sizeof(ip->ip_src));
-                MD5_Update(&ctx, (char *)&ip->ip_dst, sizeof(ip->ip_dst));
-                MD5_Update(&ctx, (char *)&zero_proto, sizeof(zero_proto));
-                MD5_Update(&ctx, (char *)&ip->ip_p, sizeof(ip->ip_p));
+                memcpy(hp, &ip->ip_src, sizeof(ip->ip_src));
+                hp += sizeof(ip->ip_src);
+                memcpy(hp, &ip->ip_dst, sizeof(ip->ip_dst));
+                hp += sizeof(ip->ip_dst);
+                *hp++ = 0;
+                *hp++ = ip->ip_p;
                 tlen = EXTRACT_16BITS(&ip->ip_len) - IP_HL(ip) * 4;
                 tlen = htons(tlen);
-                MD5_Update(&ctx, (char *)&tlen, sizeof(tlen));
+                memcpy(hp, &tlen, sizeof(tlen));
+                hp += sizeof(tlen);
 #ifdef INET6
         } else if (IP_V(ip) == 6) {
                 ip6 = (struct ip6_hdr *)ip;
-                MD5_Update(&ctx, (char *)&ip6->ip6_src, sizeof(ip6->ip6_src));
-                MD5_Update(&ctx, (char *)&ip6->ip6_dst, sizeof(ip6->ip6_dst));
+                memcpy(hp, &ip6->ip6_src, sizeof(ip6->ip6_src));
+                hp += sizeof(ip6->ip6_src);
+                memcpy(hp, &ip6->ip6_dst, sizeof(ip6->ip6_dst));
+                hp += sizeof(ip6->ip6_dst);
                 len32 = htonl(EXTRACT_16BITS(&ip6->ip6_plen));
-                MD5_Update(&ctx, (char *)&len32, sizeof(len32));
-                nxt = 0;
-                MD5_Update(&ctx, (char *)&nxt, sizeof(nxt));
-                MD5_Update(&ctx, (char *)&nxt, sizeof(nxt));
-                MD5_Update(&ctx, (char *)&nxt, sizeof(nxt));
-                nxt = IPPROTO_TCP;
-                MD5_Update(&ctx, (char *)&nxt, sizeof(nxt));
+                memcpy(hp, &len32, sizeof(len32));
+                hp += sizeof(len32);
+                *hp++ = 0;
+                *hp++ = 0;
+                *hp++ = 0;
+                *hp++ = IPPROTO_TCP;
 #endif
         } else {
 #ifdef INET6
@@ -846,13 +1000,15 @@ tcp_verify_signature(const struct ip *ip, const struct tcphdr *tp,
         }
 
         /*
-         * Step 2: Update MD5 hash with TCP header, excluding options.
+         * Step 2: TCP header, excluding options.
          * The TCP checksum must be set to zero.
          */
-        savecsum = tp1.th_sum;
         tp1.th_sum = 0;
-        MD5_Update(&ctx, (char *)&tp1, sizeof(struct tcphdr));
-        tp1.th_sum = savecsum;
+        memcpy(hp, &tp1, sizeof(struct tcphdr));
+        hp += sizeof(struct tcphdr);
+
+        MD5_Init(&ctx);
+        MD5_Update(&ctx, hdr, hp - hdr);
         /*
          * Step 3: Update MD5 hash with TCP segment data, if present.
          */
@@ -861,7 +1017,7 @@ tcp_verify_signature(const struct ip *ip, const struct tcphdr *tp,
         /*
          * Step 4: Update MD5 hash with shared secret.
          */
-        MD5_Update(&ctx, sigsecret, strlen(sigsecret));
+        MD5_Update(&ctx, secret, secretlen);
         MD5_Final(sig, &ctx);
 
         if (memcmp(rcvsig, sig, TCP_SIGLEN) == 0)
@@ -44,6 +44,8 @@
 #include "nameser.h"
 #include "nfs.h"
 #include "bootp.h"
+#include "dissector.h"
+#include "porttable.h"
 
 struct rtcphdr {
 	u_int16_t rh_flags;	/* T:2 P:1 CNT:5 PT:8 */
@@ -345,6 +347,174 @@ udpipaddr_print(netdissect_options *ndo, const struct ip *ip, int sport, int dpo
 	}
 }
 
+/*
+ * Printers for UDP payloads chosen by port; see porttable.h.
+ */
+enum {
+	UDP_PR_NONE,
+	UDP_PR_DNS,
+	UDP_PR_MDNS,
+	UDP_PR_TIMED,
+	UDP_PR_TFTP,
+	UDP_PR_BOOTP,
+	UDP_PR_RIP,
+	UDP_PR_AODV,
+	UDP_PR_ISAKMP,
+	UDP_PR_ISAKMP_NATT,
+	UDP_PR_SNMP,
+	UDP_PR_NTP,
+	UDP_PR_KRB,
+	UDP_PR_L2TP,
+	UDP_PR_NBT_NS,
+	UDP_PR_NBT_DGRAM,
+	UDP_PR_VAT,
+	UDP_PR_ZEPHYR,
+	UDP_PR_RX,
+	UDP_PR_RIPNG,
+	UDP_PR_DHCP6,
+	UDP_PR_AHCP,
+	UDP_PR_BABEL,
+	UDP_PR_WB,
+	UDP_PR_AUTORP,
+	UDP_PR_RADIUS,
+	UDP_PR_HSRP,
+	UDP_PR_LWRES,
+	UDP_PR_LDP,
+	UDP_PR_OLSR,
+	UDP_PR_LSPPING,
+	UDP_PR_BFD,
+	UDP_PR_LMP,
+	UDP_PR_VQP,
+	UDP_PR_SFLOW,
+	UDP_PR_LWAPP_CONTROL,
+	UDP_PR_LWAPP_DATA,
+	UDP_PR_SIP,
+	UDP_PR_SYSLOG,
+	UDP_PR_OTV,
+	UDP_PR_VXLAN
+};
+
+static const struct tok udp_printers[] = {
+	{ UDP_PR_DNS,		"dns" },
+	{ UDP_PR_MDNS,		"mdns" },
+	{ UDP_PR_TIMED,		"timed" },
+	{ UDP_PR_TFTP,		"tftp" },
+	{ UDP_PR_BOOTP,		"bootp" },
+	{ UDP_PR_RIP,		"rip" },
+	{ UDP_PR_AODV,		"aodv" },
+	{ UDP_PR_ISAKMP,	"isakmp" },
+	{ UDP_PR_ISAKMP_NATT,	"isakmp-natt" },
+	{ UDP_PR_SNMP,		"snmp" },
+	{ UDP_PR_NTP,		"ntp" },
+	{ UDP_PR_KRB,		"krb" },
+	{ UDP_PR_L2TP,		"l2tp" },
+#ifdef TCPDUMP_DO_SMB
+	{ UDP_PR_NBT_NS,	"nbt-ns" },
+	{ UDP_PR_NBT_DGRAM,	"nbt-dgram" },
+#endif
+	{ UDP_PR_VAT,		"vat" },
+	{ UDP_PR_ZEPHYR,	"zephyr" },
+	{ UDP_PR_RX,		"rx" },
+#ifdef INET6
+	{ UDP_PR_RIPNG,		"ripng" },
+	{ UDP_PR_DHCP6,		"dhcp6" },
+	{ UDP_PR_AHCP,		"ahcp" },
+	{ UDP_PR_BABEL,		"babel" },
+#endif
+	{ UDP_PR_WB,		"wb" },
+	{ UDP_PR_AUTORP,	"autorp" },
+	{ UDP_PR_RADIUS,	"radius" },
+	{ UDP_PR_HSRP,		"hsrp" },
+	{ UDP_PR_LWRES,		"lwres" },
+	{ UDP_PR_LDP,		"ldp" },
+	{ UDP_PR_OLSR,		"olsr" },
+	{ UDP_PR_LSPPING,	"lspping" },
+	{ UDP_PR_BFD,		"bfd" },
+	{ UDP_PR_LMP,		"lmp" },
+	{ UDP_PR_VQP,		"vqp" },
+	{ UDP_PR_SFLOW,		"sflow" },
+	{ UDP_PR_LWAPP_CONTROL,	"lwapp-control" },
+	{ UDP_PR_LWAPP_DATA,	"lwapp-data" },
+	{ UDP_PR_SIP,		"sip" },
+	{ UDP_PR_SYSLOG,	"syslog" },
+	{ UDP_PR_OTV,		"otv" },
+	{ UDP_PR_VXLAN,		"vxlan" },
+	{ 0,			NULL }
+};
+
+#define UDP_PORT(port, dir, printer)	{ port, port, dir, printer }
+
+/* In order of precedence */
+static const struct port_entry udp_builtin_ports[] = {
+	UDP_PORT(NAMESERVER_PORT,		PORT_ANY, UDP_PR_DNS),
+	UDP_PORT(MULTICASTDNS_PORT,		PORT_ANY, UDP_PR_MDNS),
+	UDP_PORT(TIMED_PORT,			PORT_ANY, UDP_PR_TIMED),
+	UDP_PORT(TFTP_PORT,			PORT_ANY, UDP_PR_TFTP),
+	UDP_PORT(IPPORT_BOOTPC,			PORT_ANY, UDP_PR_BOOTP),
+	UDP_PORT(IPPORT_BOOTPS,			PORT_ANY, UDP_PR_BOOTP),
+	UDP_PORT(RIP_PORT,			PORT_ANY, UDP_PR_RIP),
+	UDP_PORT(AODV_PORT,			PORT_ANY, UDP_PR_AODV),
+	UDP_PORT(ISAKMP_PORT,			PORT_ANY, UDP_PR_ISAKMP),
+	UDP_PORT(ISAKMP_PORT_NATT,		PORT_ANY, UDP_PR_ISAKMP_NATT),
+#if 1 /*???*/
+	UDP_PORT(ISAKMP_PORT_USER1,		PORT_ANY, UDP_PR_ISAKMP),
+	UDP_PORT(ISAKMP_PORT_USER2,		PORT_ANY, UDP_PR_ISAKMP),
+#endif
+	UDP_PORT(SNMP_PORT,			PORT_ANY, UDP_PR_SNMP),
+	UDP_PORT(SNMPTRAP_PORT,			PORT_ANY, UDP_PR_SNMP),
+	UDP_PORT(NTP_PORT,			PORT_ANY, UDP_PR_NTP),
+	UDP_PORT(KERBEROS_PORT,			PORT_ANY, UDP_PR_KRB),
+	UDP_PORT(KERBEROS_SEC_PORT,		PORT_ANY, UDP_PR_KRB),
+	UDP_PORT(L2TP_PORT,			PORT_ANY, UDP_PR_L2TP),
+#ifdef TCPDUMP_DO_SMB
+	UDP_PORT(NETBIOS_NS_PORT,		PORT_ANY, UDP_PR_NBT_NS),
+	UDP_PORT(NETBIOS_DGRAM_PORT,		PORT_ANY, UDP_PR_NBT_DGRAM),
+#endif
+	UDP_PORT(VAT_PORT,			PORT_DST, UDP_PR_VAT),
+	UDP_PORT(ZEPHYR_SRV_PORT,		PORT_ANY, UDP_PR_ZEPHYR),
+	UDP_PORT(ZEPHYR_CLT_PORT,		PORT_ANY, UDP_PR_ZEPHYR),
+	{ RX_PORT_LOW, RX_PORT_HIGH,		PORT_ANY, UDP_PR_RX },
+#ifdef INET6
+	UDP_PORT(RIPNG_PORT,			PORT_ANY, UDP_PR_RIPNG),
+	UDP_PORT(DHCP6_SERV_PORT,		PORT_ANY, UDP_PR_DHCP6),
+	UDP_PORT(DHCP6_CLI_PORT,		PORT_ANY, UDP_PR_DHCP6),
+	UDP_PORT(AHCP_PORT,			PORT_ANY, UDP_PR_AHCP),
+	UDP_PORT(BABEL_PORT,			PORT_ANY, UDP_PR_BABEL),
+	UDP_PORT(BABEL_PORT_OLD,		PORT_ANY, UDP_PR_BABEL),
+#endif /*INET6*/
+	/*
+	 * Kludge in test for whiteboard packets.
+	 */
+	UDP_PORT(WB_PORT,			PORT_DST, UDP_PR_WB),
+	UDP_PORT(CISCO_AUTORP_PORT,		PORT_ANY, UDP_PR_AUTORP),
+	UDP_PORT(RADIUS_PORT,			PORT_ANY, UDP_PR_RADIUS),
+	UDP_PORT(RADIUS_NEW_PORT,		PORT_ANY, UDP_PR_RADIUS),
+	UDP_PORT(RADIUS_ACCOUNTING_PORT,	PORT_ANY, UDP_PR_RADIUS),
+	UDP_PORT(RADIUS_NEW_ACCOUNTING_PORT,	PORT_ANY, UDP_PR_RADIUS),
+	UDP_PORT(HSRP_PORT,			PORT_DST, UDP_PR_HSRP),
+	UDP_PORT(LWRES_PORT,			PORT_ANY, UDP_PR_LWRES),
+	UDP_PORT(LDP_PORT,			PORT_ANY, UDP_PR_LDP),
+	UDP_PORT(OLSR_PORT,			PORT_ANY, UDP_PR_OLSR),
+	UDP_PORT(MPLS_LSP_PING_PORT,		PORT_ANY, UDP_PR_LSPPING),
+	UDP_PORT(BFD_CONTROL_PORT,		PORT_DST, UDP_PR_BFD),
+	UDP_PORT(BFD_ECHO_PORT,			PORT_DST, UDP_PR_BFD),
+	UDP_PORT(LMP_PORT,			PORT_ANY, UDP_PR_LMP),
+	UDP_PORT(VQP_PORT,			PORT_ANY, UDP_PR_VQP),
+	UDP_PORT(SFLOW_PORT,			PORT_ANY, UDP_PR_SFLOW),
+	/* to the AC if the destination port matches, from it otherwise */
+	UDP_PORT(LWAPP_CONTROL_PORT,		PORT_ANY, UDP_PR_LWAPP_CONTROL),
+	UDP_PORT(LWAPP_DATA_PORT,		PORT_ANY, UDP_PR_LWAPP_DATA),
+	UDP_PORT(SIP_PORT,			PORT_ANY, UDP_PR_SIP),
+	UDP_PORT(SYSLOG_PORT,			PORT_ANY, UDP_PR_SYSLOG),
+	UDP_PORT(OTV_PORT,			PORT_ANY, UDP_PR_OTV),
+	UDP_PORT(VXLAN_PORT,			PORT_ANY, UDP_PR_VXLAN),
+	{ 0, 0, 0, UDP_PR_NONE }
+};
+
+struct port_table udp_port_table = {
+	"udp", udp_printers, udp_builtin_ports
+};
+
 void
 udp_print(netdissect_options *ndo, register const u_char *bp, u_int length,
 	  register const u_char *bp2, int fragmented)
@@ -354,6 +524,8 @@ udp_print(netdissect_options *ndo, register const u_char *bp, u_int length,
 	register const u_char *cp;
 	register const u_char *ep = bp + length;
 	u_int16_t sport, dport, ulen;
+	int todst;
+	u_int printer;
 #ifdef INET6
 	register const struct ip6_hdr *ip6;
 #endif
@@ -562,124 +734,193 @@ udp_print(netdissect_options *ndo, register const u_char *bp, u_int length,
 	}
 
 	if (!ndo->ndo_qflag) {
-#define ISPORT(p) (dport == (p) || sport == (p))
-		if (ISPORT(NAMESERVER_PORT))
-			ns_print((const u_char *)(up + 1), length, 0);
-		else if (ISPORT(MULTICASTDNS_PORT))
-			ns_print((const u_char *)(up + 1), length, 1);
-		else if (ISPORT(TIMED_PORT))
-			timed_print((const u_char *)(up + 1));
-		else if (ISPORT(TFTP_PORT))
-			tftp_print((const u_char *)(up + 1), length);
-		else if (ISPORT(IPPORT_BOOTPC) || ISPORT(IPPORT_BOOTPS))
-			bootp_print((const u_char *)(up + 1), length);
-		else if (ISPORT(RIP_PORT))
-			rip_print(ndo, (const u_char *)(up + 1), length);
-		else if (ISPORT(AODV_PORT))
-			aodv_print((const u_char *)(up + 1), length,
+		printer = port_table_lookup(&udp_port_table, sport, dport, &todst);
+		switch (printer) {
+
+		case UDP_PR_DNS:
+			ns_print(cp, length, 0);
+			break;
+
+		case UDP_PR_MDNS:
+			ns_print(cp, length, 1);
+			break;
+
+		case UDP_PR_TIMED:
+			timed_print(cp);
+			break;
+
+		case UDP_PR_TFTP:
+			tftp_print(cp, length);
+			break;
+
+		case UDP_PR_BOOTP:
+			bootp_print(cp, length);
+			break;
+
+		case UDP_PR_RIP:
+			rip_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_AODV:
+			aodv_print(cp, length,
 #ifdef INET6
 			    ip6 != NULL);
 #else
 			    0);
 #endif
-	        else if (ISPORT(ISAKMP_PORT))
-			 isakmp_print(ndo, (const u_char *)(up + 1), length, bp2);
-  	        else if (ISPORT(ISAKMP_PORT_NATT))
-			 isakmp_rfc3948_print(ndo, (const u_char *)(up + 1), length, bp2);
-#if 1 /*???*/
-   	        else if (ISPORT(ISAKMP_PORT_USER1) || ISPORT(ISAKMP_PORT_USER2))
-			isakmp_print(ndo, (const u_char *)(up + 1), length, bp2);
-#endif
-		else if (ISPORT(SNMP_PORT) || ISPORT(SNMPTRAP_PORT))
-			snmp_print((const u_char *)(up + 1), length);
-		else if (ISPORT(NTP_PORT))
-			ntp_print((const u_char *)(up + 1), length);
-		else if (ISPORT(KERBEROS_PORT) || ISPORT(KERBEROS_SEC_PORT))
-			krb_print((const void *)(up + 1));
-		else if (ISPORT(L2TP_PORT))
-			l2tp_print(ndo, (const u_char *)(up + 1), length);
+			break;
+
+		case UDP_PR_ISAKMP:
+			isakmp_print(ndo, cp, length, bp2);
+			break;
+
+		case UDP_PR_ISAKMP_NATT:
+			isakmp_rfc3948_print(ndo, cp, length, bp2);
+			break;
+
+		case UDP_PR_SNMP:
+			snmp_print(cp, length);
+			break;
+
+		case UDP_PR_NTP:
+			ntp_print(cp, length);
+			break;
+
+		case UDP_PR_KRB:
+			krb_print(cp);
+			break;
+
+		case UDP_PR_L2TP:
+			l2tp_print(ndo, cp, length);
+			break;
+
 #ifdef TCPDUMP_DO_SMB
-		else if (ISPORT(NETBIOS_NS_PORT))
-			nbt_udp137_print((const u_char *)(up + 1), length);
-		else if (ISPORT(NETBIOS_DGRAM_PORT))
-			nbt_udp138_print((const u_char *)(up + 1), length);
+		case UDP_PR_NBT_NS:
+			nbt_udp137_print(cp, length);
+			break;
+
+		case UDP_PR_NBT_DGRAM:
+			nbt_udp138_print(cp, length);
+			break;
 #endif
-		else if (dport == VAT_PORT)
-			vat_print(ndo, (const void *)(up + 1), up);
-		else if (ISPORT(ZEPHYR_SRV_PORT) || ISPORT(ZEPHYR_CLT_PORT))
-			zephyr_print(ndo, (const void *)(up + 1), length);
-		/*
-		 * Since there are 10 possible ports to check, I think
-		 * a <> test would be more efficient
-		 */
-		else if ((sport >= RX_PORT_LOW && sport <= RX_PORT_HIGH) ||
-			 (dport >= RX_PORT_LOW && dport <= RX_PORT_HIGH))
-			rx_print((const void *)(up + 1), length, sport, dport,
-				 (u_char *) ip);
+
+		case UDP_PR_VAT:
+			vat_print(ndo, cp, up);
+			break;
+
+		case UDP_PR_ZEPHYR:
+			zephyr_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_RX:
+			rx_print(cp, length, sport, dport, (u_char *) ip);
+			break;
+
 #ifdef INET6
-		else if (ISPORT(RIPNG_PORT))
-			ripng_print(ndo, (const u_char *)(up + 1), length);
-		else if (ISPORT(DHCP6_SERV_PORT) || ISPORT(DHCP6_CLI_PORT))
-			dhcp6_print((const u_char *)(up + 1), length);
-		else if (ISPORT(AHCP_PORT))
-			ahcp_print(ndo, (const u_char *)(up + 1), length);
-		else if (ISPORT(BABEL_PORT) || ISPORT(BABEL_PORT_OLD))
-			babel_print((const u_char *)(up + 1), length);
+		case UDP_PR_RIPNG:
+			ripng_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_DHCP6:
+			dhcp6_print(cp, length);
+			break;
+
+		case UDP_PR_AHCP:
+			ahcp_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_BABEL:
+			babel_print(cp, length);
+			break;
 #endif /*INET6*/
-		/*
-		 * Kludge in test for whiteboard packets.
-		 */
-		else if (dport == WB_PORT)
-			wb_print((const void *)(up + 1), length);
-		else if (ISPORT(CISCO_AUTORP_PORT))
-			cisco_autorp_print((const void *)(up + 1), length);
-		else if (ISPORT(RADIUS_PORT) ||
-			 ISPORT(RADIUS_NEW_PORT) ||
-			 ISPORT(RADIUS_ACCOUNTING_PORT) ||
-			 ISPORT(RADIUS_NEW_ACCOUNTING_PORT) )
-			radius_print(ndo, (const u_char *)(up+1), length);
-		else if (dport == HSRP_PORT)
-			hsrp_print(ndo, (const u_char *)(up + 1), length);
-		else if (ISPORT(LWRES_PORT))
-			lwres_print((const u_char *)(up + 1), length);
-		else if (ISPORT(LDP_PORT))
-			ldp_print(ndo, (const u_char *)(up + 1), length);
-		else if (ISPORT(OLSR_PORT))
-			olsr_print((const u_char *)(up + 1), length,
+
+		case UDP_PR_WB:
+			wb_print(cp, length);
+			break;
+
+		case UDP_PR_AUTORP:
+			cisco_autorp_print(cp, length);
+			break;
+
+		case UDP_PR_RADIUS:
+			radius_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_HSRP:
+			hsrp_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_LWRES:
+			lwres_print(cp, length);
+			break;
+
+		case UDP_PR_LDP:
+			ldp_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_OLSR:
+			olsr_print(cp, length,
 #if INET6
 					(IP_V(ip) == 6) ? 1 : 0);
 #else
 					0);
 #endif
-		else if (ISPORT(MPLS_LSP_PING_PORT))
-			lspping_print((const u_char *)(up + 1), length);
-		else if (dport == BFD_CONTROL_PORT ||
-			 dport == BFD_ECHO_PORT )
-			bfd_print(ndo, (const u_char *)(up+1), length, dport);
-                else if (ISPORT(LMP_PORT))
-			lmp_print(ndo, (const u_char *)(up + 1), length);
-		else if (ISPORT(VQP_PORT))
-			vqp_print(ndo, (const u_char *)(up + 1), length);
-                else if (ISPORT(SFLOW_PORT))
-                        sflow_print((const u_char *)(up + 1), length);
-	        else if (dport == LWAPP_CONTROL_PORT)
-			lwapp_control_print(ndo, (const u_char *)(up + 1), length, 1);
-                else if (sport == LWAPP_CONTROL_PORT)
-                        lwapp_control_print(ndo, (const u_char *)(up + 1), length, 0);
-                else if (ISPORT(LWAPP_DATA_PORT))
-                        lwapp_data_print(ndo, (const u_char *)(up + 1), length);
-                else if (ISPORT(SIP_PORT))
-			sip_print((const u_char *)(up + 1), length);
-                else if (ISPORT(SYSLOG_PORT))
-			syslog_print((const u_char *)(up + 1), length);
-                else if (ISPORT(OTV_PORT))
-			otv_print(ndo, (const u_char *)(up + 1), length);
-                else if (ISPORT(VXLAN_PORT))
-			vxlan_print(ndo, (const u_char *)(up + 1), length);
-		else
+			break;
+
+		case UDP_PR_LSPPING:
+			lspping_print(cp, length);
+			break;
+
+		case UDP_PR_BFD:
+			bfd_print(ndo, cp, length, todst ? dport : sport);
+			break;
+
+		case UDP_PR_LMP:
+			lmp_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_VQP:
+			vqp_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_SFLOW:
+			sflow_print(cp, length);
+			break;
+
+		case UDP_PR_LWAPP_CONTROL:
+			lwapp_control_print(ndo, cp, length, todst);
+			break;
+
+		case UDP_PR_LWAPP_DATA:
+			lwapp_data_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_SIP:
+			sip_print(cp, length);
+			break;
+
+		case UDP_PR_SYSLOG:
+			syslog_print(cp, length);
+			break;
+
+		case UDP_PR_OTV:
+			otv_print(ndo, cp, length);
+			break;
+
+		case UDP_PR_VXLAN:
+			vxlan_print(ndo, cp, length);
+			break;
+
+		default:
+			if (printer >= PORT_DYNAMIC) {
+				(*port_table_dissector(&udp_port_table, printer))
+				    (ndo, cp, length, (const u_char *)ip);
+				break;
+			}
 			ND_PRINT((ndo, "UDP, length %u",
 			    (u_int32_t)(ulen - sizeof(*up))));
-#undef ISPORT
+			break;
+		}
 	} else
 		ND_PRINT((ndo, "UDP, length %u", (u_int32_t)(ulen - sizeof(*up))));
 }
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Scratch space and the cache pool for printers; see scratch.h.
+ *
+ * The scratch space is a list of chunks that are never moved or freed,
+ * so pointers handed out stay valid until they are released even when
+ * more chunks are added.  A chunk is big enough for at least one
+ * maximum-size packet; bigger requests get a chunk of their own size.
+ *
+ * The pool hands out zeroed memory from chunks of its own, with bigger
+ * requests going straight to calloc().
+ */
+
+#define NETDISSECT_REWORKED
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <tcpdump-stdinc.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "interface.h"
+#include "scratch.h"
+
+#define SCRATCH_CHUNK	(256 * 1024)
+#define POOL_CHUNK	(64 * 1024)
+#define POOL_BIG	(POOL_CHUNK / 8)	/* bigger requests use calloc() */
+#define SCRATCH_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+struct scratch_chunk {
+	struct scratch_chunk *next;
+	size_t	size;
+	size_t	used;
+	/* data follows */
+};
+
+#define CHUNK_DATA(c)	((u_char *)(c) + SCRATCH_ALIGN(sizeof(struct scratch_chunk)))
+
+void
+scratch_mark(netdissect_options *ndo, struct scratch_mark *m)
+{
+	m->chunk = ndo->ndo_scratch;
+	m->used = m->chunk != NULL ? m->chunk->used : 0;
+}
+
+void *
+scratch_alloc(netdissect_options *ndo, size_t len)
+{
+	struct scratch_chunk *c, *n;
+	size_t size;
+	void *p;
+
+	len = SCRATCH_ALIGN(len);
+	c = ndo->ndo_scratch;
+	if (c == NULL && ndo->ndo_scratch_head != NULL) {
+		c = ndo->ndo_scratch_head;
+		c->used = 0;
+	}
+	/* move on to the next chunk, adding one if needed, until one fits */
+	while (c == NULL || c->size - c->used < len) {
+		if (c != NULL && c->next != NULL) {
+			c = c->next;
+			c->used = 0;
+			continue;
+		}
+		size = len > SCRATCH_CHUNK ? len : SCRATCH_CHUNK;
+		n = (struct scratch_chunk *)malloc(
+		    SCRATCH_ALIGN(sizeof(struct scratch_chunk)) + size);
+		if (n == NULL)
+			(*ndo->ndo_error)(ndo, "scratch_alloc: out of memory");
+		n->next = NULL;
+		n->size = size;
+		n->used = 0;
+		if (c != NULL)
+			c->next = n;
+		else
+			ndo->ndo_scratch_head = n;
+		c = n;
+	}
+	ndo->ndo_scratch = c;
+	p = CHUNK_DATA(c) + c->used;
+	c->used += len;
+	return p;
+}
+
+void
+scratch_release(netdissect_options *ndo, const struct scratch_mark *m)
+{
+	ndo->ndo_scratch = m->chunk;
+	if (m->chunk != NULL)
+		m->chunk->used = m->used;
+}
+
+void
+scratch_reset(netdissect_options *ndo)
+{
+	ndo->ndo_scratch = NULL;
+}
+
+void *
+pool_alloc(size_t len)
+{
+	static u_char *chunk;
+	static size_t left;
+	void *p;
+
+	len = SCRATCH_ALIGN(len);
+	if (len > POOL_BIG) {
+		p = calloc(1, len);
+		if (p == NULL)
+			error("pool_alloc: calloc");
+		return p;
+	}
+	if (left < len) {
+		chunk = (u_char *)calloc(1, POOL_CHUNK);
+		if (chunk == NULL)
+			error("pool_alloc: calloc");
+		left = POOL_CHUNK;
+	}
+	p = chunk;
+	chunk += len;
+	left -= len;
+	return p;
+}
+
+char *
+pool_strdup(const char *s)
+{
+	size_t len = strlen(s) + 1;
+
+	return (char *)memcpy(pool_alloc(len), s, len);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Scratch space for printers that dissect a transformed copy of part
+ * of a packet (unescaped, decompressed, rebuilt headers, ...), or that
+ * need memory only while printing a packet.
+ *
+ * Space is handed out stack-fashion: take a mark with scratch_mark(),
+ * allocate with scratch_alloc(), and give back everything allocated
+ * since the mark with scratch_release().  Marks nest, so a printer
+ * holding scratch space may call one that allocates more.  Whatever
+ * is still allocated when a packet has been printed is given back by
+ * scratch_reset().  Memory is kept for reuse, so once the space has
+ * grown to what the traffic needs, printing allocates nothing.
+ *
+ * Caches that live as long as the process (name tables and the like)
+ * take their entries from a separate pool with pool_alloc() and
+ * pool_strdup(); that memory is never freed.
+ */
+
+struct scratch_chunk;
+
+struct scratch_mark {
+	struct scratch_chunk *chunk;
+	size_t used;
+};
+
+extern void scratch_mark(netdissect_options *, struct scratch_mark *);
+extern void *scratch_alloc(netdissect_options *, size_t);
+extern void scratch_release(netdissect_options *, const struct scratch_mark *);
+extern void scratch_reset(netdissect_options *);
+
+extern void *pool_alloc(size_t);
+extern char *pool_strdup(const char *);
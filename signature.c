@@ -40,20 +40,29 @@ const struct tok signature_check_values[] = {
 
 #ifdef HAVE_LIBCRYPTO
 /*
- * Compute a HMAC MD5 sum.
+ * MD5 states after hashing the inner and outer pads of the HMAC key,
+ * and the key they were computed for.  The pads are hashed once per
+ * key instead of once per packet.
+ */
+static MD5_CTX hmac_md5_ipad_ctx;
+static MD5_CTX hmac_md5_opad_ctx;
+static const unsigned char *hmac_md5_key;
+
+/*
+ * Compute the pad states for a HMAC MD5 key.
  * Taken from rfc2104, Appendix.
  */
 USES_APPLE_DEPRECATED_API
 static void
-signature_compute_hmac_md5(const u_int8_t *text, int text_len, unsigned char *key,
-                           unsigned int key_len, u_int8_t *digest)
+signature_hmac_md5_setkey(const unsigned char *key, unsigned int key_len)
 {
-    MD5_CTX context;
     unsigned char k_ipad[65];    /* inner padding - key XORd with ipad */
     unsigned char k_opad[65];    /* outer padding - key XORd with opad */
     unsigned char tk[16];
     int i;
 
+    hmac_md5_key = key;
+
     /* if key is longer than 64 bytes reset it to key=MD5(key) */
     if (key_len > 64) {
 
@@ -90,19 +99,37 @@ signature_compute_hmac_md5(const u_int8_t *text, int text_len, unsigned char *ke
         k_opad[i] ^= 0x5c;
     }
 
+    MD5_Init(&hmac_md5_ipad_ctx);
+    MD5_Update(&hmac_md5_ipad_ctx, k_ipad, 64);
+    MD5_Init(&hmac_md5_opad_ctx);
+    MD5_Update(&hmac_md5_opad_ctx, k_opad, 64);
+}
+USES_APPLE_RST
+
+/*
+ * Compute a HMAC MD5 sum.
+ */
+USES_APPLE_DEPRECATED_API
+static void
+signature_compute_hmac_md5(const u_int8_t *text, int text_len, unsigned char *key,
+                           unsigned int key_len, u_int8_t *digest)
+{
+    MD5_CTX context;
+
+    if (key != hmac_md5_key)
+        signature_hmac_md5_setkey(key, key_len);
+
     /*
      * perform inner MD5
      */
-    MD5_Init(&context);                   /* init context for 1st pass */
-    MD5_Update(&context, k_ipad, 64);     /* start with inner pad */
+    context = hmac_md5_ipad_ctx;          /* inner pad already hashed */
     MD5_Update(&context, text, text_len); /* then text of datagram */
     MD5_Final(digest, &context);          /* finish up 1st pass */
 
     /*
      * perform outer MD5
      */
-    MD5_Init(&context);                   /* init context for 2nd pass */
-    MD5_Update(&context, k_opad, 64);     /* start with outer pad */
+    context = hmac_md5_opad_ctx;          /* outer pad already hashed */
     MD5_Update(&context, digest, 16);     /* then results of 1st hash */
     MD5_Final(digest, &context);          /* finish up 2nd pass */
 }
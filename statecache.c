@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Hash tables for per-printer state; see statecache.h.
+ *
+ * Entries live in one array, addressed by index + 1 so that 0 can
+ * mean "none".  Each entry is on a hash chain and on a list in order
+ * of last use; unused entries are on a free list.  The array and the
+ * hash table double when the table fills up, until "capacity" is
+ * reached; then the least recently used entry is recycled.
+ */
+
+#define NETDISSECT_REWORKED
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <tcpdump-stdinc.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "interface.h"
+#include "statecache.h"
+
+#define SC_INITIAL	64	/* entries allocated at first */
+#define SC_ALIGN(n)	(((n) + 7) & ~(size_t)7)
+
+struct sc_entry {
+	u_int	hnext;		/* hash chain */
+	u_int	prev;		/* use list, towards most recent */
+	u_int	next;		/* use list, towards least recent; free list */
+	u_int	hash;
+	time_t	last;		/* packet time of last use */
+	/* key and data follow */
+};
+
+struct state_cache {
+	size_t		keylen;
+	size_t		dataoff;	/* offset of data in an entry */
+	size_t		stride;		/* size of an entry */
+	u_int		capacity;
+	u_int		timeout;
+	u_int		size;		/* entries allocated */
+	u_int		nbuckets;	/* always a power of 2 */
+	u_int		*buckets;
+	u_char		*entries;
+	u_int		mru;		/* most recently used */
+	u_int		lru;		/* least recently used */
+	u_int		freelist;
+};
+
+#define SC_ENTRY(sc, i)	((struct sc_entry *)((sc)->entries + ((i) - 1) * (sc)->stride))
+#define SC_KEY(e)	((u_char *)(e) + sizeof(struct sc_entry))
+#define SC_DATA(sc, e)	((u_char *)(e) + (sc)->dataoff)
+
+static u_int
+sc_hash(const struct state_cache *sc, const void *key)
+{
+	const u_char *p = (const u_char *)key;
+	u_int h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < sc->keylen; i++)
+		h = (h ^ p[i]) * 16777619U;
+	return h;
+}
+
+static void
+sc_grow(netdissect_options *ndo, struct state_cache *sc)
+{
+	struct sc_entry *e;
+	u_char *nentries;
+	u_int nsize, i, b;
+
+	nsize = sc->size ? sc->size * 2 : SC_INITIAL;
+	if (nsize > sc->capacity)
+		nsize = sc->capacity;
+	nentries = (u_char *)realloc(sc->entries, nsize * sc->stride);
+	if (nentries == NULL)
+		(*ndo->ndo_error)(ndo, "state_cache: out of memory");
+	sc->entries = nentries;
+	for (i = nsize; i > sc->size; i--) {
+		e = SC_ENTRY(sc, i);
+		e->next = sc->freelist;
+		sc->freelist = i;
+	}
+	sc->size = nsize;
+
+	/* keep the hash table at most half full */
+	if (sc->nbuckets >= nsize * 2)
+		return;
+	free(sc->buckets);
+	sc->nbuckets = sc->nbuckets ? sc->nbuckets : SC_INITIAL;
+	while (sc->nbuckets < nsize * 2)
+		sc->nbuckets *= 2;
+	sc->buckets = (u_int *)calloc(sc->nbuckets, sizeof(u_int));
+	if (sc->buckets == NULL)
+		(*ndo->ndo_error)(ndo, "state_cache: out of memory");
+	for (i = sc->mru; i != 0; i = e->next) {
+		e = SC_ENTRY(sc, i);
+		b = e->hash & (sc->nbuckets - 1);
+		e->hnext = sc->buckets[b];
+		sc->buckets[b] = i;
+	}
+}
+
+static void
+sc_unlink_use(struct state_cache *sc, u_int i)
+{
+	struct sc_entry *e = SC_ENTRY(sc, i);
+
+	if (e->prev)
+		SC_ENTRY(sc, e->prev)->next = e->next;
+	else
+		sc->mru = e->next;
+	if (e->next)
+		SC_ENTRY(sc, e->next)->prev = e->prev;
+	else
+		sc->lru = e->prev;
+}
+
+static void
+sc_make_mru(struct state_cache *sc, u_int i)
+{
+	struct sc_entry *e = SC_ENTRY(sc, i);
+
+	e->prev = 0;
+	e->next = sc->mru;
+	if (sc->mru)
+		SC_ENTRY(sc, sc->mru)->prev = i;
+	else
+		sc->lru = i;
+	sc->mru = i;
+}
+
+static void
+sc_remove(struct state_cache *sc, u_int i)
+{
+	struct sc_entry *e = SC_ENTRY(sc, i);
+	u_int *ip;
+
+	for (ip = &sc->buckets[e->hash & (sc->nbuckets - 1)]; *ip != 0;
+	    ip = &SC_ENTRY(sc, *ip)->hnext)
+		if (*ip == i) {
+			*ip = e->hnext;
+			break;
+		}
+	sc_unlink_use(sc, i);
+	e->next = sc->freelist;
+	sc->freelist = i;
+}
+
+static int
+sc_expired(const netdissect_options *ndo, const struct state_cache *sc,
+	   const struct sc_entry *e)
+{
+	return sc->timeout != 0 &&
+	    ndo->ndo_ts.tv_sec - e->last >= (time_t)sc->timeout;
+}
+
+struct state_cache *
+state_cache_create(netdissect_options *ndo, size_t keylen, size_t datalen,
+		   u_int capacity, u_int timeout)
+{
+	struct state_cache *sc;
+
+	sc = (struct state_cache *)calloc(1, sizeof(*sc));
+	if (sc == NULL)
+		(*ndo->ndo_error)(ndo, "state_cache_create: calloc");
+	sc->keylen = keylen;
+	sc->dataoff = SC_ALIGN(sizeof(struct sc_entry) + keylen);
+	sc->stride = sc->dataoff + SC_ALIGN(datalen);
+	sc->capacity = capacity ? capacity : 1;
+	sc->timeout = timeout;
+	return sc;
+}
+
+void *
+state_cache_lookup(netdissect_options *ndo, struct state_cache *sc,
+		   const void *key)
+{
+	struct sc_entry *e;
+	u_int h, i;
+
+	if (sc->nbuckets == 0)
+		return NULL;
+	h = sc_hash(sc, key);
+	for (i = sc->buckets[h & (sc->nbuckets - 1)]; i != 0; i = e->hnext) {
+		e = SC_ENTRY(sc, i);
+		if (e->hash == h && memcmp(SC_KEY(e), key, sc->keylen) == 0)
+			break;
+	}
+	if (i == 0)
+		return NULL;
+	if (sc_expired(ndo, sc, e)) {
+		sc_remove(sc, i);
+		return NULL;
+	}
+	e->last = ndo->ndo_ts.tv_sec;
+	if (sc->mru != i) {
+		sc_unlink_use(sc, i);
+		sc_make_mru(sc, i);
+	}
+	return SC_DATA(sc, e);
+}
+
+void *
+state_cache_enter(netdissect_options *ndo, struct state_cache *sc,
+		  const void *key)
+{
+	struct sc_entry *e;
+	void *data;
+	u_int i, b;
+
+	data = state_cache_lookup(ndo, sc, key);
+	if (data != NULL)
+		return data;
+
+	/* drop a couple of expired entries while we're here */
+	for (b = 0; b < 2 && sc->lru != 0 &&
+	    sc_expired(ndo, sc, SC_ENTRY(sc, sc->lru)); b++)
+		sc_remove(sc, sc->lru);
+
+	if (sc->freelist == 0 && sc->size < sc->capacity)
+		sc_grow(ndo, sc);
+	if (sc->freelist == 0)
+		sc_remove(sc, sc->lru);
+	i = sc->freelist;
+	e = SC_ENTRY(sc, i);
+	sc->freelist = e->next;
+
+	e->hash = sc_hash(sc, key);
+	e->last = ndo->ndo_ts.tv_sec;
+	memcpy(SC_KEY(e), key, sc->keylen);
+	memset(SC_DATA(sc, e), 0, sc->stride - sc->dataoff);
+	b = e->hash & (sc->nbuckets - 1);
+	e->hnext = sc->buckets[b];
+	sc->buckets[b] = i;
+	sc_make_mru(sc, i);
+	return SC_DATA(sc, e);
+}
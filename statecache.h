@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Hash tables for state that printers keep from one packet to the
+ * next (which side started an exchange, which request a reply belongs
+ * to, ...).
+ *
+ * Entries have a fixed-size key and a fixed-size data area.  The
+ * table grows as needed up to "capacity" entries; beyond that, the
+ * least recently used entry is recycled.  Entries that haven't been
+ * used for "timeout" seconds of packet time (0 means never) are
+ * treated as gone.
+ */
+
+/* Defaults for the caches of individual printers */
+#define IKE_COOKIE_DEFAULT_MAX		16384
+#define IKE_COOKIE_DEFAULT_TIMEOUT	3600	/* seconds */
+#define RX_CALL_DEFAULT_MAX		16384
+#define RX_CALL_DEFAULT_TIMEOUT		300	/* seconds */
+#define DNS_QUERY_DEFAULT_MAX		65536
+#define DNS_QUERY_DEFAULT_TIMEOUT	10	/* seconds */
+
+struct state_cache;
+
+extern struct state_cache *state_cache_create(netdissect_options *,
+					      size_t, size_t, u_int, u_int);
+
+/* Returns the data of the entry for "key", or NULL */
+extern void *state_cache_lookup(netdissect_options *, struct state_cache *,
+				const void *);
+
+/*
+ * Returns the data of the entry for "key", creating the entry, with
+ * its data zeroed, if there isn't one.
+ */
+extern void *state_cache_enter(netdissect_options *, struct state_cache *,
+			       const void *);
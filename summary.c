@@ -0,0 +1,677 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Summary modes.
+ *
+ * Packets are not handed to the printers; a small header walker
+ * finds the IP and transport headers (using the same header
+ * definitions as the printers) and the enabled summary modes update
+ * their tables from that.  Nothing is formatted until a report is
+ * printed, at the end of each -o interval (in packet time), on
+ * SIGINFO and at exit.
+ *
+ * The flows mode keeps packet and byte counts, first/last time stamps
+ * and the union of TCP flags per unidirectional 5-tuple, in an
+ * open-addressing hash table that doubles as needed up to flow-max
+ * entries.
+ *
+ * The bgp-stats mode hands the payload of TCP segments to or from the
+ * BGP port to the BGP printer's UPDATE walker (see print-bgp.c).
+ *
+ * The wlan-stats mode hands 802.11 frames, with or without a radiotap
+ * header, to the 802.11 printer's statistics code (see print-802_11.c).
+ *
+ * The netflow-stats mode hands UDP datagrams to the NetFlow and IPFIX
+ * collector ports (or all of them, with -T cnfp) to the collector in
+ * print-cnfp.c.
+ *
+ * The sflow-stats mode hands UDP datagrams to the sFlow collector port
+ * to print-sflow.c, which scales the samples up by their sampling rate
+ * and finds the addresses in sampled packet headers with
+ * summary_frame().
+ *
+ * The dns-stats mode hands UDP datagrams to or from the DNS port to
+ * print-domain.c, which matches responses to queries.
+ */
+
+#define NETDISSECT_REWORKED
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <tcpdump-stdinc.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "interface.h"
+#include "addrtoname.h"
+#include "extract.h"
+
+#include "ether.h"
+#include "ethertype.h"
+#include "ip.h"
+#ifdef INET6
+#include "ip6.h"
+#endif
+#include "ipproto.h"
+#include "tcp.h"
+#include "udp.h"
+#include "nameser.h"
+#include "summary.h"
+#include "tcpanalysis.h"
+
+#define SLL_HDR_LEN	16	/* see print-sll.c */
+
+struct flow_key {
+	u_int8_t	af;
+	u_int8_t	proto;
+	u_int16_t	sport;
+	u_int16_t	dport;
+	u_int8_t	src[16];
+	u_int8_t	dst[16];
+};
+
+struct flow {
+	struct flow_key	key;
+	int		used;
+	u_int8_t	tcpflags;
+	u_int64_t	packets;
+	u_int64_t	bytes;
+	struct timeval	first;
+	struct timeval	last;
+};
+
+static const struct tok flow_tcpflag_values[] = {
+	{ TH_FIN, "F" },
+	{ TH_SYN, "S" },
+	{ TH_RST, "R" },
+	{ TH_PUSH, "P" },
+	{ TH_ACK, "." },
+	{ TH_URG, "U" },
+	{ TH_ECNECHO, "E" },
+	{ TH_CWR, "W" },
+	{ 0, NULL }
+};
+
+static int summary_dlt;
+static time_t summary_next_report;
+
+static struct flow *flowtab;
+static u_int flowtab_size;		/* always a power of 2 */
+static u_int flowtab_count;
+static u_int64_t flow_packets, flow_bytes;
+static u_int64_t flow_untracked_packets, flow_untracked_bytes;
+static u_int64_t flow_nonip_packets;
+
+void
+summary_init(netdissect_options *ndo _U_, int dlt)
+{
+	summary_dlt = dlt;
+}
+
+static u_int
+flow_hash(const struct flow_key *key)
+{
+	const u_int8_t *p = (const u_int8_t *)key;
+	u_int h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < sizeof(*key); i++)
+		h = (h ^ p[i]) * 16777619U;
+	return h;
+}
+
+static struct flow *
+flow_slot(struct flow *tab, u_int size, const struct flow_key *key)
+{
+	u_int i;
+
+	for (i = flow_hash(key) & (size - 1); tab[i].used;
+	    i = (i + 1) & (size - 1))
+		if (memcmp(&tab[i].key, key, sizeof(*key)) == 0)
+			break;
+	return &tab[i];
+}
+
+static int
+flow_grow(void)
+{
+	struct flow *ntab, *f;
+	u_int nsize, i;
+
+	nsize = flowtab_size ? flowtab_size * 2 : 1024;
+	ntab = (struct flow *)calloc(nsize, sizeof(*ntab));
+	if (ntab == NULL)
+		return 0;
+	for (i = 0; i < flowtab_size; i++) {
+		if (!flowtab[i].used)
+			continue;
+		f = flow_slot(ntab, nsize, &flowtab[i].key);
+		*f = flowtab[i];
+	}
+	free(flowtab);
+	flowtab = ntab;
+	flowtab_size = nsize;
+	return 1;
+}
+
+static void
+flow_update(netdissect_options *ndo, const struct summary_pkt *pkt)
+{
+	struct flow_key key;
+	struct flow *f;
+
+	memset(&key, 0, sizeof(key));
+	key.af = pkt->af;
+	key.proto = pkt->proto;
+	if (pkt->has_ports) {
+		key.sport = pkt->sport;
+		key.dport = pkt->dport;
+	}
+	memcpy(key.src, pkt->src, pkt->af == 4 ? 4 : 16);
+	memcpy(key.dst, pkt->dst, pkt->af == 4 ? 4 : 16);
+
+	flow_packets++;
+	flow_bytes += pkt->iplen;
+
+	if (flowtab_count * 2 >= flowtab_size &&
+	    flowtab_count < ndo->ndo_flow_max)
+		(void)flow_grow();
+	if (flowtab_size == 0)
+		goto untracked;
+	f = flow_slot(flowtab, flowtab_size, &key);
+	if (!f->used) {
+		if (flowtab_count >= ndo->ndo_flow_max ||
+		    (flowtab_count + 1) * 4 > flowtab_size * 3)
+			goto untracked;
+		f->used = 1;
+		f->key = key;
+		f->first = ndo->ndo_ts;
+		flowtab_count++;
+	}
+	f->packets++;
+	f->bytes += pkt->iplen;
+	f->last = ndo->ndo_ts;
+	f->tcpflags |= pkt->tcpflags;
+	return;
+
+untracked:
+	flow_untracked_packets++;
+	flow_untracked_bytes += pkt->iplen;
+}
+
+static int
+flow_cmp(const void *va, const void *vb)
+{
+	const struct flow *a = *(const struct flow * const *)va;
+	const struct flow *b = *(const struct flow * const *)vb;
+
+	if (a->bytes != b->bytes)
+		return a->bytes < b->bytes ? 1 : -1;
+	if (a->packets != b->packets)
+		return a->packets < b->packets ? 1 : -1;
+	return memcmp(&a->key, &b->key, sizeof(a->key));
+}
+
+static const char *
+flow_addr_string(const struct flow *f, const u_int8_t *addr)
+{
+#ifdef INET6
+	if (f->key.af == 6)
+		return ip6addr_string(addr);
+#endif
+	return ipaddr_string(addr);
+}
+
+static const char *
+flow_port_string(const struct flow *f, u_int16_t port)
+{
+	if (f->key.proto == IPPROTO_TCP)
+		return tcpport_string(port);
+	if (f->key.proto == IPPROTO_UDP)
+		return udpport_string(port);
+	return NULL;
+}
+
+static void
+flow_report(netdissect_options *ndo)
+{
+	struct flow **sorted;
+	struct flow *f;
+	struct timeval dur;
+	u_int i, n;
+
+	ND_PRINT((ndo, "Flow summary: %u flow%s, %" PRIu64 " packet%s, %" PRIu64 " byte%s",
+	    flowtab_count, PLURAL_SUFFIX(flowtab_count),
+	    flow_packets, PLURAL_SUFFIX(flow_packets),
+	    flow_bytes, PLURAL_SUFFIX(flow_bytes)));
+	if (flow_untracked_packets != 0)
+		ND_PRINT((ndo, ", %" PRIu64 " packets (%" PRIu64 " bytes) in untracked flows",
+		    flow_untracked_packets, flow_untracked_bytes));
+	if (flow_nonip_packets != 0)
+		ND_PRINT((ndo, ", %" PRIu64 " non-IP packet%s",
+		    flow_nonip_packets, PLURAL_SUFFIX(flow_nonip_packets)));
+	ND_PRINT((ndo, "\n"));
+	if (flowtab_count == 0)
+		return;
+
+	sorted = (struct flow **)malloc(flowtab_count * sizeof(*sorted));
+	if (sorted == NULL)
+		(*ndo->ndo_error)(ndo, "flow_report: malloc");
+	for (i = n = 0; i < flowtab_size; i++)
+		if (flowtab[i].used)
+			sorted[n++] = &flowtab[i];
+	qsort(sorted, n, sizeof(*sorted), flow_cmp);
+	if (ndo->ndo_summary_top != 0 && n > ndo->ndo_summary_top)
+		n = ndo->ndo_summary_top;
+
+	ND_PRINT((ndo, "%12s %14s %12s  %s\n", "packets", "bytes", "duration", "flow"));
+	for (i = 0; i < n; i++) {
+		f = sorted[i];
+		dur.tv_sec = f->last.tv_sec - f->first.tv_sec;
+		dur.tv_usec = f->last.tv_usec - f->first.tv_usec;
+		if (dur.tv_usec < 0) {
+			dur.tv_sec--;
+			dur.tv_usec += 1000000;
+		}
+		ND_PRINT((ndo, "%12" PRIu64 " %14" PRIu64 " %5u.%06u  %s ",
+		    f->packets, f->bytes,
+		    (unsigned)dur.tv_sec, (unsigned)dur.tv_usec,
+		    tok2str(ipproto_values, "ip-proto-%d", f->key.proto)));
+		if ((f->key.sport != 0 || f->key.dport != 0) &&
+		    flow_port_string(f, 0) != NULL) {
+			ND_PRINT((ndo, "%s.", flow_addr_string(f, f->key.src)));
+			ND_PRINT((ndo, "%s > ", flow_port_string(f, f->key.sport)));
+			ND_PRINT((ndo, "%s.", flow_addr_string(f, f->key.dst)));
+			ND_PRINT((ndo, "%s", flow_port_string(f, f->key.dport)));
+		} else {
+			ND_PRINT((ndo, "%s > ", flow_addr_string(f, f->key.src)));
+			ND_PRINT((ndo, "%s", flow_addr_string(f, f->key.dst)));
+			if (f->key.sport != 0 || f->key.dport != 0)
+				ND_PRINT((ndo, " ports %u > %u", f->key.sport, f->key.dport));
+		}
+		if (f->key.proto == IPPROTO_TCP)
+			ND_PRINT((ndo, " [%s]", bittok2str_nosep(flow_tcpflag_values,
+			    "none", f->tcpflags)));
+		ND_PRINT((ndo, "\n"));
+	}
+	free(sorted);
+}
+
+static void
+flow_reset(void)
+{
+	if (flowtab != NULL)
+		memset(flowtab, 0, flowtab_size * sizeof(*flowtab));
+	flowtab_count = 0;
+	flow_packets = flow_bytes = 0;
+	flow_untracked_packets = flow_untracked_bytes = 0;
+	flow_nonip_packets = 0;
+}
+
+static void
+summary_report(netdissect_options *ndo, const struct timeval *tvp)
+{
+	ts_print(tvp);
+	if (ndo->ndo_summary & SUMMARY_FLOWS)
+		flow_report(ndo);
+	if (ndo->ndo_summary & SUMMARY_BGP)
+		bgp_stats_print();
+	if (ndo->ndo_summary & SUMMARY_WLAN)
+		ieee802_11_stats_print();
+	if (ndo->ndo_summary & SUMMARY_NETFLOW)
+		cnfp_stats_print();
+	if (ndo->ndo_summary & SUMMARY_SFLOW)
+		sflow_stats_print();
+	if (ndo->ndo_summary & SUMMARY_DNS)
+		dns_stats_print();
+	if (ndo->ndo_summary & SUMMARY_SNMP)
+		snmp_stats_print();
+	if (ndo->ndo_tcp_analysis)
+		tcp_analysis_report(ndo);
+	if (ndo->ndo_rx_stats)
+		rx_stats_print();
+}
+
+void
+summary_print(netdissect_options *ndo)
+{
+	summary_report(ndo, &ndo->ndo_ts);
+}
+
+/*
+ * Is there anything for summary_print() to print?  Besides the summary
+ * modes, some printers collect statistics that are reported with them.
+ */
+int
+summary_reporting(netdissect_options *ndo)
+{
+	return ndo->ndo_summary != 0 || ndo->ndo_tcp_analysis ||
+	    ndo->ndo_rx_stats;
+}
+
+/*
+ * Find the transport header of an IPv4 or IPv6 datagram.
+ * Returns 0 if "bp" doesn't hold a usable IP header.
+ */
+static int
+summary_ip(netdissect_options *ndo, const u_char *bp, struct summary_pkt *pkt)
+{
+	const struct ip *ip;
+#ifdef INET6
+	const struct ip6_hdr *ip6;
+	u_int advance, nh;
+#endif
+	const u_char *cp, *ipend;
+	u_int hlen;
+	int first_frag = 1;
+
+	ND_TCHECK2(*bp, 1);
+	switch (*bp >> 4) {
+
+	case 4:
+		ip = (const struct ip *)bp;
+		ND_TCHECK(*ip);
+		hlen = IP_HL(ip) * 4;
+		pkt->iplen = EXTRACT_16BITS(&ip->ip_len);
+		if (hlen < sizeof(struct ip) || pkt->iplen < hlen)
+			return 0;
+		pkt->af = 4;
+		pkt->src = (const u_char *)&ip->ip_src;
+		pkt->dst = (const u_char *)&ip->ip_dst;
+		pkt->proto = ip->ip_p;
+		if (EXTRACT_16BITS(&ip->ip_off) & IP_OFFMASK)
+			first_frag = 0;
+		cp = bp + hlen;
+		break;
+
+#ifdef INET6
+	case 6:
+		ip6 = (const struct ip6_hdr *)bp;
+		ND_TCHECK(*ip6);
+		pkt->af = 6;
+		pkt->src = (const u_char *)&ip6->ip6_src;
+		pkt->dst = (const u_char *)&ip6->ip6_dst;
+		pkt->iplen = sizeof(struct ip6_hdr) + EXTRACT_16BITS(&ip6->ip6_plen);
+		cp = bp + sizeof(struct ip6_hdr);
+		nh = ip6->ip6_nxt;
+		for (;;) {
+			switch (nh) {
+
+			case IPPROTO_HOPOPTS:
+			case IPPROTO_DSTOPTS:
+			case IPPROTO_ROUTING:
+				ND_TCHECK2(*cp, 2);
+				advance = (cp[1] + 1) * 8;
+				break;
+
+			case IPPROTO_FRAGMENT:
+				ND_TCHECK2(*cp, 4);
+				if (EXTRACT_16BITS(cp + 2) & IP6F_OFF_MASK)
+					first_frag = 0;
+				advance = sizeof(struct ip6_frag);
+				break;
+
+			case IPPROTO_AH:
+				ND_TCHECK2(*cp, 2);
+				advance = (cp[1] + 2) * 4;
+				break;
+
+			default:
+				advance = 0;
+				break;
+			}
+			if (advance == 0)
+				break;
+			nh = *cp;
+			cp += advance;
+			if (!first_frag)
+				break;
+		}
+		pkt->proto = nh;
+		break;
+#endif
+
+	default:
+		return 0;
+	}
+
+	/* the transport header, if we have one */
+	ipend = bp + pkt->iplen;
+	if (!first_frag || cp > ipend)
+		return 1;
+	pkt->l4 = cp;
+	pkt->l4len = ipend - cp;
+	switch (pkt->proto) {
+
+	case IPPROTO_TCP:
+		if (!ND_TTEST2(*cp, 14))
+			return 1;
+		pkt->tcpflags = cp[13];
+		pkt->payload = cp + TH_OFF((const struct tcphdr *)cp) * 4;
+		break;
+
+	case IPPROTO_UDP:
+		pkt->payload = cp + sizeof(struct udphdr);
+		break;
+
+	case IPPROTO_SCTP:
+	case IPPROTO_DCCP:
+		break;
+
+	default:
+		return 1;
+	}
+	if (!ND_TTEST2(*cp, 4))
+		return 1;
+	pkt->has_ports = 1;
+	pkt->sport = EXTRACT_16BITS(cp);
+	pkt->dport = EXTRACT_16BITS(cp + 2);
+	if (pkt->payload != NULL) {
+		if (ipend > ndo->ndo_snapend)
+			ipend = ndo->ndo_snapend;
+		if (pkt->payload < ipend)
+			pkt->paylen = ipend - pkt->payload;
+		else
+			pkt->payload = NULL;
+	}
+	return 1;
+
+trunc:
+	return 0;
+}
+
+/*
+ * Find the IP header of a frame with link-layer type "dlt".
+ */
+static const u_char *
+summary_link(netdissect_options *ndo, int dlt, const u_char *p)
+{
+	const u_char *bp;
+	u_int etype;
+
+	bp = NULL;
+	switch (dlt) {
+
+	case DLT_EN10MB:
+		if (!ND_TTEST2(*p, ETHER_HDRLEN))
+			break;
+		etype = EXTRACT_16BITS(p + 12);
+		bp = p + ETHER_HDRLEN;
+		while (etype == ETHERTYPE_8021Q || etype == ETHERTYPE_8021Q9100 ||
+		    etype == ETHERTYPE_8021Q9200 || etype == ETHERTYPE_8021QinQ) {
+			if (!ND_TTEST2(*bp, 4)) {
+				etype = 0;
+				break;
+			}
+			etype = EXTRACT_16BITS(bp + 2);
+			bp += 4;
+		}
+		if (etype != ETHERTYPE_IP && etype != ETHERTYPE_IPV6)
+			bp = NULL;
+		break;
+
+#ifdef DLT_LINUX_SLL
+	case DLT_LINUX_SLL:
+		if (!ND_TTEST2(*p, SLL_HDR_LEN))
+			break;
+		etype = EXTRACT_16BITS(p + SLL_HDR_LEN - 2);
+		if (etype == ETHERTYPE_IP || etype == ETHERTYPE_IPV6)
+			bp = p + SLL_HDR_LEN;
+		break;
+#endif
+
+	case DLT_NULL:
+#ifdef DLT_LOOP
+	case DLT_LOOP:
+#endif
+		bp = p + 4;
+		break;
+
+	case DLT_RAW:
+#ifdef DLT_IPV4
+	case DLT_IPV4:
+#endif
+#ifdef DLT_IPV6
+	case DLT_IPV6:
+#endif
+		bp = p;
+		break;
+	}
+	return bp;
+}
+
+/*
+ * Fill in "pkt" for the frame "p", of link-layer type "dlt".  Returns
+ * 0 if it doesn't hold a usable IP header within the snapshot.  Also
+ * used by printers that carry sampled frames, such as sFlow.
+ */
+int
+summary_frame(netdissect_options *ndo, int dlt, const u_char *p,
+	      struct summary_pkt *pkt)
+{
+	const u_char *bp;
+
+	memset(pkt, 0, sizeof(*pkt));
+	bp = summary_link(ndo, dlt, p);
+	return bp != NULL && summary_ip(ndo, bp, pkt);
+}
+
+/*
+ * With "-o interval", print the summary and start counting again if
+ * the packet with time stamp "tsp" is past the end of the interval.
+ * Called for each packet, whether it is printed or only summarized.
+ */
+void
+summary_interval(netdissect_options *ndo, const struct timeval *tsp)
+{
+	struct timeval tv;
+
+	if (ndo->ndo_summary_interval == 0)
+		return;
+	if (summary_next_report == 0) {
+		summary_next_report = tsp->tv_sec + ndo->ndo_summary_interval;
+		return;
+	}
+	if (tsp->tv_sec < summary_next_report)
+		return;
+
+	tv.tv_sec = summary_next_report;
+	tv.tv_usec = 0;
+	summary_report(ndo, &tv);
+	flow_reset();
+	if (ndo->ndo_summary & SUMMARY_BGP)
+		bgp_stats_reset();
+	if (ndo->ndo_summary & SUMMARY_WLAN)
+		ieee802_11_stats_reset();
+	if (ndo->ndo_summary & SUMMARY_NETFLOW)
+		cnfp_stats_reset();
+	if (ndo->ndo_summary & SUMMARY_SFLOW)
+		sflow_stats_reset();
+	if (ndo->ndo_summary & SUMMARY_DNS)
+		dns_stats_reset();
+	if (ndo->ndo_summary & SUMMARY_SNMP)
+		snmp_stats_reset();
+	if (ndo->ndo_tcp_analysis)
+		tcp_analysis_reset(ndo);
+	if (ndo->ndo_rx_stats)
+		rx_stats_reset();
+	while (summary_next_report <= tsp->tv_sec)
+		summary_next_report += ndo->ndo_summary_interval;
+}
+
+void
+summary_packet(netdissect_options *ndo, const struct pcap_pkthdr *h,
+	       const u_char *p)
+{
+	struct summary_pkt pkt;
+
+	ndo->ndo_snapend = p + h->caplen;
+	ndo->ndo_ts = h->ts;
+
+	summary_interval(ndo, &h->ts);
+
+	switch (summary_dlt) {
+
+	case DLT_IEEE802_11:
+#ifdef DLT_IEEE802_11_RADIO
+	case DLT_IEEE802_11_RADIO:
+#endif
+		if (ndo->ndo_summary & SUMMARY_WLAN)
+			ieee802_11_stats_packet(p, h->len, h->caplen,
+			    summary_dlt != DLT_IEEE802_11);
+		break;
+	}
+
+	if (!summary_frame(ndo, summary_dlt, p, &pkt)) {
+		flow_nonip_packets++;
+		return;
+	}
+
+	if (ndo->ndo_summary & SUMMARY_FLOWS)
+		flow_update(ndo, &pkt);
+	if ((ndo->ndo_summary & SUMMARY_BGP) && pkt.proto == IPPROTO_TCP &&
+	    pkt.payload != NULL &&
+	    (pkt.sport == BGP_PORT || pkt.dport == BGP_PORT))
+		bgp_stats_packet(pkt.payload, pkt.paylen, pkt.af, pkt.src);
+	if ((ndo->ndo_summary & SUMMARY_NETFLOW) && pkt.proto == IPPROTO_UDP &&
+	    pkt.payload != NULL &&
+	    (ndo->ndo_packettype == PT_CNFP || pkt.dport == NETFLOW_PORT ||
+	    pkt.dport == IPFIX_PORT))
+		cnfp_stats_packet(pkt.payload, pkt.paylen, pkt.af, pkt.src,
+		    pkt.sport);
+	if ((ndo->ndo_summary & SUMMARY_SFLOW) && pkt.proto == IPPROTO_UDP &&
+	    pkt.payload != NULL && pkt.dport == SFLOW_PORT)
+		sflow_stats_packet(pkt.payload, pkt.paylen);
+	if ((ndo->ndo_summary & SUMMARY_DNS) && pkt.proto == IPPROTO_UDP &&
+	    pkt.payload != NULL &&
+	    (pkt.sport == NAMESERVER_PORT || pkt.dport == NAMESERVER_PORT))
+		dns_stats_packet(pkt.payload, pkt.paylen, pkt.af, pkt.src,
+		    pkt.dst, pkt.sport, pkt.dport);
+	if ((ndo->ndo_summary & SUMMARY_SNMP) && pkt.proto == IPPROTO_UDP &&
+	    pkt.payload != NULL &&
+	    (pkt.sport == SNMP_PORT || pkt.dport == SNMP_PORT ||
+	    pkt.sport == SNMPTRAP_PORT || pkt.dport == SNMPTRAP_PORT))
+		snmp_stats_packet(pkt.payload, pkt.paylen, pkt.af, pkt.src,
+		    pkt.dst);
+	if (ndo->ndo_tcp_analysis && pkt.proto == IPPROTO_TCP && pkt.l4 != NULL) {
+		struct tcp_analysis_result res;
+
+		tcp_analysis_update(ndo, pkt.af, pkt.src, pkt.dst,
+		    (const struct tcphdr *)pkt.l4, pkt.l4len, &res);
+	}
+}
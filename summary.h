@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Summary modes: instead of printing each packet, collect statistics
+ * and print them periodically and at exit.
+ */
+
+/* Summary modes, as selected with -o; values for ndo_summary */
+#define SUMMARY_FLOWS	0x0001		/* per-5-tuple counters */
+#define SUMMARY_BGP	0x0002		/* BGP UPDATE statistics */
+#define SUMMARY_WLAN	0x0004		/* 802.11 BSS and station statistics */
+#define SUMMARY_NETFLOW	0x0008		/* NetFlow/IPFIX collector */
+#define SUMMARY_SFLOW	0x0010		/* sFlow collector */
+#define SUMMARY_DNS	0x0020		/* DNS query/response statistics */
+#define SUMMARY_SNMP	0x0040		/* SNMP PDU statistics */
+
+#define SUMMARY_DEFAULT_TOP		10
+#define SUMMARY_DEFAULT_FLOW_MAX	100000
+
+/*
+ * What the header walker found in a packet.  Addresses point into
+ * the packet; "payload" is the captured part of the transport payload.
+ */
+struct summary_pkt {
+	int		af;		/* 4 or 6 */
+	const u_char	*src;
+	const u_char	*dst;
+	u_int		proto;		/* transport protocol */
+	u_int		iplen;		/* length of the IP datagram */
+	int		has_ports;
+	u_int16_t	sport;
+	u_int16_t	dport;
+	u_int8_t	tcpflags;
+	const u_char	*l4;		/* transport header */
+	u_int		l4len;		/* transport header and payload length */
+	const u_char	*payload;
+	u_int		paylen;
+};
+
+extern void summary_init(netdissect_options *, int);
+extern void summary_packet(netdissect_options *, const struct pcap_pkthdr *,
+			   const u_char *);
+extern int summary_frame(netdissect_options *, int, const u_char *,
+			 struct summary_pkt *);
+extern void summary_interval(netdissect_options *, const struct timeval *);
+extern void summary_print(netdissect_options *);
+extern int summary_reporting(netdissect_options *);
@@ -0,0 +1,581 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * TCP connection analysis.
+ *
+ * For each connection we follow both directions: the next sequence
+ * number each side is expected to send, the last ACK and window it
+ * advertised, and its window scale.  From that we flag retransmitted,
+ * out-of-order and missing segments, duplicate ACKs, zero windows,
+ * zero window probes and segments that fill the receiver's window.
+ *
+ * RTT is sampled the way BSD TCP does it: one segment per direction
+ * is timed at a time (SYNs included, which gives the handshake RTT)
+ * and the sample is taken when the other side ACKs it; timing is
+ * abandoned if the segment is retransmitted (Karn's algorithm).
+ *
+ * Since we may see the packets at either end of the path, these
+ * are the RTTs from the capture point, not end-to-end.
+ */
+
+#define NETDISSECT_REWORKED
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <tcpdump-stdinc.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "interface.h"
+#include "addrtoname.h"
+#include "extract.h"
+
+#include "tcp.h"
+#include "tcpanalysis.h"
+
+#define TCPA_HASHSIZE	4096	/* must be a power of 2 */
+
+#define SEQ_LT(a, b)	((int32_t)((a) - (b)) < 0)
+#define SEQ_GT(a, b)	((int32_t)((a) - (b)) > 0)
+#define SEQ_GEQ(a, b)	((int32_t)((a) - (b)) >= 0)
+
+/*
+ * The two ends of a connection, in a canonical order so that both
+ * directions find the same entry.
+ */
+struct tcpa_key {
+	u_int8_t	af;
+	u_int8_t	pad;
+	u_int16_t	port[2];
+	u_int8_t	addr[2][16];
+};
+
+/* State of one direction, indexed by the sending end */
+struct tcpa_dir {
+	int		syn_seen;
+	u_int32_t	isn;
+	int		wscale;		/* shift from our SYN, -1 if none */
+	int		have_seq;
+	u_int32_t	next_seq;	/* highest sequence number sent + 1 */
+	int		have_ack;
+	u_int32_t	last_ack;
+	u_int		last_win;	/* window field as sent */
+	u_int32_t	rwin;		/* scaled window */
+	struct timeval	last_ts;
+	u_int		dupacks;	/* consecutive duplicate ACKs */
+
+	int		timing;		/* a segment of ours is being timed */
+	u_int32_t	rtt_seq;	/* ACK that completes the sample */
+	struct timeval	rtt_sent;
+	u_int32_t	rtt_lowest;	/* lowest RTT, not reset; 0 if none */
+
+	u_int64_t	packets;
+	u_int64_t	bytes;		/* payload */
+	u_int64_t	retrans;
+	u_int64_t	ooo;
+	u_int64_t	lost;
+	u_int64_t	dupack_total;
+	u_int64_t	zerowin;
+	u_int64_t	winfull;
+	u_int64_t	sack_blocks;
+	u_int64_t	sack_bytes;
+	u_int		rtt_samples;
+	u_int64_t	rtt_sum;	/* microseconds */
+	u_int32_t	rtt_min;
+	u_int32_t	rtt_max;
+	u_int32_t	rwin_min;
+	u_int32_t	rwin_max;
+};
+
+struct tcpa_conn {
+	struct tcpa_conn *hnext;	/* hash chain */
+	struct tcpa_conn *next;		/* all connections, newest first */
+	struct tcpa_key	key;
+	u_int		index;		/* order of creation */
+	int		unhashed;	/* replaced by a new connection */
+	int		wscale_known;	/* saw both SYNs */
+	struct timeval	first;
+	struct timeval	last;
+	struct tcpa_dir	dir[2];
+};
+
+static struct tcpa_conn *tcpa_hash[TCPA_HASHSIZE];
+static struct tcpa_conn *tcpa_conns;
+static u_int tcpa_nconns;
+static u_int tcpa_serial;		/* for tcpa_conn.index */
+static u_int64_t tcpa_untracked;	/* segments past flow-max connections */
+
+static const struct tok tcpa_flag_values[] = {
+	{ TCPA_RETRANSMISSION, "retransmission" },
+	{ TCPA_OUT_OF_ORDER, "out-of-order" },
+	{ TCPA_LOST_SEGMENT, "previous segment not captured" },
+	{ TCPA_ZERO_WINDOW, "zero window" },
+	{ TCPA_ZERO_WINDOW_PROBE, "zero window probe" },
+	{ TCPA_WINDOW_FULL, "window full" },
+	{ 0, NULL }
+};
+
+/* Microseconds from "b" to "a", in 64 bits as connections can be long */
+static u_int64_t
+tcpa_usec(const struct timeval *a, const struct timeval *b)
+{
+	long sec, usec;
+
+	sec = a->tv_sec - b->tv_sec;
+	usec = a->tv_usec - b->tv_usec;
+	if (sec < 0 || (sec == 0 && usec < 0))
+		return 0;
+	return (u_int64_t)sec * 1000000 + usec;
+}
+
+static u_int
+tcpa_hashkey(const struct tcpa_key *key)
+{
+	const u_int8_t *p = (const u_int8_t *)key;
+	u_int h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < sizeof(*key); i++)
+		h = (h ^ p[i]) * 16777619U;
+	return h & (TCPA_HASHSIZE - 1);
+}
+
+static struct tcpa_conn *
+tcpa_new(netdissect_options *ndo, const struct tcpa_key *key, u_int h)
+{
+	struct tcpa_conn *c;
+
+	if (tcpa_nconns >= ndo->ndo_flow_max)
+		return NULL;
+	c = (struct tcpa_conn *)calloc(1, sizeof(*c));
+	if (c == NULL)
+		(*ndo->ndo_error)(ndo, "tcp_analysis_update: calloc");
+	c->key = *key;
+	c->index = tcpa_serial++;
+	tcpa_nconns++;
+	c->dir[0].wscale = c->dir[1].wscale = -1;
+	c->hnext = tcpa_hash[h];
+	tcpa_hash[h] = c;
+	c->next = tcpa_conns;
+	tcpa_conns = c;
+	return c;
+}
+
+/* Drop a connection from the hash table; it stays in the report */
+static void
+tcpa_unhash(struct tcpa_conn *c, u_int h)
+{
+	struct tcpa_conn **cp;
+
+	for (cp = &tcpa_hash[h]; *cp != NULL; cp = &(*cp)->hnext)
+		if (*cp == c) {
+			*cp = c->hnext;
+			break;
+		}
+	c->unhashed = 1;
+}
+
+/*
+ * Walk the TCP options, picking up the window scale and accounting
+ * SACK blocks.
+ */
+static void
+tcpa_options(netdissect_options *ndo, const struct tcphdr *tp,
+	     struct tcpa_dir *d, int syn)
+{
+	const u_char *cp, *ep;
+	u_int opt, len, i;
+
+	cp = (const u_char *)tp + sizeof(*tp);
+	ep = (const u_char *)tp + TH_OFF(tp) * 4;
+	while (cp < ep && ND_TTEST2(*cp, 1)) {
+		opt = *cp;
+		if (opt == TCPOPT_EOL)
+			break;
+		if (opt == TCPOPT_NOP) {
+			cp++;
+			continue;
+		}
+		if (cp + 2 > ep || !ND_TTEST2(*cp, 2))
+			break;
+		len = cp[1];
+		if (len < 2 || cp + len > ep || !ND_TTEST2(*cp, len))
+			break;
+		switch (opt) {
+
+		case TCPOPT_WSCALE:
+			if (syn && len == 3)
+				d->wscale = cp[2] > 14 ? 14 : cp[2];
+			break;
+
+		case TCPOPT_SACK:
+			for (i = 2; i + 8 <= len; i += 8) {
+				d->sack_blocks++;
+				d->sack_bytes += EXTRACT_32BITS(cp + i + 4) -
+				    EXTRACT_32BITS(cp + i);
+			}
+			break;
+		}
+		cp += len;
+	}
+}
+
+void
+tcp_analysis_update(netdissect_options *ndo, int af,
+		    const u_char *src, const u_char *dst,
+		    const struct tcphdr *tp, u_int length,
+		    struct tcp_analysis_result *res)
+{
+	struct tcpa_key key;
+	struct tcpa_conn *c;
+	struct tcpa_dir *d, *r;
+	u_int32_t seq, ack, seglen, rtt;
+	u_int64_t usec;
+	u_int hlen, paylen, win, alen, h;
+	u_int16_t sport, dport;
+	u_int8_t flags;
+	int s;
+
+	memset(res, 0, sizeof(*res));
+	if (!ND_TTEST(*tp))
+		return;
+	hlen = TH_OFF(tp) * 4;
+	if (hlen < sizeof(*tp) || hlen > length)
+		return;
+	paylen = length - hlen;
+	sport = EXTRACT_16BITS(&tp->th_sport);
+	dport = EXTRACT_16BITS(&tp->th_dport);
+	seq = EXTRACT_32BITS(&tp->th_seq);
+	ack = EXTRACT_32BITS(&tp->th_ack);
+	win = EXTRACT_16BITS(&tp->th_win);
+	flags = tp->th_flags;
+
+	/* find the connection; end 0 is the one with the lower address */
+	alen = af == 4 ? 4 : 16;
+	memset(&key, 0, sizeof(key));
+	key.af = af;
+	s = memcmp(src, dst, alen);
+	if (s == 0)
+		s = sport > dport;
+	else
+		s = s > 0;
+	memcpy(key.addr[s], src, alen);
+	memcpy(key.addr[!s], dst, alen);
+	key.port[s] = sport;
+	key.port[!s] = dport;
+	h = tcpa_hashkey(&key);
+	for (c = tcpa_hash[h]; c != NULL; c = c->hnext)
+		if (memcmp(&c->key, &key, sizeof(key)) == 0)
+			break;
+	/* a SYN with a new ISN starts a new connection on the same ports */
+	if (c != NULL && (flags & (TH_SYN|TH_ACK)) == TH_SYN &&
+	    c->dir[s].syn_seen && c->dir[s].isn != seq) {
+		tcpa_unhash(c, h);
+		c = NULL;
+	}
+	if (c == NULL && (c = tcpa_new(ndo, &key, h)) == NULL) {
+		tcpa_untracked++;
+		return;
+	}
+	if (c->dir[0].packets == 0 && c->dir[1].packets == 0)
+		c->first = ndo->ndo_ts;		/* new, or since the last reset */
+	c->last = ndo->ndo_ts;
+	d = &c->dir[s];
+	r = &c->dir[!s];
+
+	if (flags & TH_SYN) {
+		d->syn_seen = 1;
+		d->isn = seq;
+		d->wscale = -1;
+	}
+	tcpa_options(ndo, tp, d, flags & TH_SYN);
+	if ((flags & TH_SYN) && d->syn_seen && r->syn_seen)
+		c->wscale_known = 1;
+
+	/* the data side: what does this segment send? */
+	seglen = paylen;
+	if (flags & TH_SYN)
+		seglen++;
+	if (flags & TH_FIN)
+		seglen++;
+	if (seglen != 0 && !(flags & TH_RST)) {
+		if (!d->have_seq) {
+			d->have_seq = 1;
+			d->next_seq = seq;
+		}
+		if (r->have_ack && r->rwin == 0 && paylen == 1 &&
+		    seq == r->last_ack) {
+			/* the probe byte is sent again once the window opens */
+			res->flags |= TCPA_ZERO_WINDOW_PROBE;
+		} else if (SEQ_LT(seq, d->next_seq)) {
+			/*
+			 * Seen before, or sent before the segment we
+			 * thought came last.  If it follows the previous
+			 * one of this direction by less than the lowest
+			 * RTT, the sender can't have retransmitted it:
+			 * it was reordered.
+			 */
+			if (d->rtt_lowest != 0 &&
+			    tcpa_usec(&ndo->ndo_ts, &d->last_ts) < d->rtt_lowest) {
+				res->flags |= TCPA_OUT_OF_ORDER;
+				d->ooo++;
+			} else {
+				res->flags |= TCPA_RETRANSMISSION;
+				d->retrans++;
+				if (d->timing && SEQ_LT(seq, d->rtt_seq))
+					d->timing = 0;
+			}
+			if (SEQ_GT(seq + seglen, d->next_seq))
+				d->next_seq = seq + seglen;
+		} else {
+			if (seq != d->next_seq) {
+				res->flags |= TCPA_LOST_SEGMENT;
+				d->lost++;
+			}
+			d->next_seq = seq + seglen;
+			if (!d->timing) {
+				d->timing = 1;
+				d->rtt_seq = d->next_seq;
+				d->rtt_sent = ndo->ndo_ts;
+			}
+		}
+		if (paylen != 0 && c->wscale_known && r->have_ack &&
+		    !(res->flags & (TCPA_RETRANSMISSION|TCPA_ZERO_WINDOW_PROBE)) &&
+		    r->rwin != 0 && seq + paylen - r->last_ack >= r->rwin) {
+			res->flags |= TCPA_WINDOW_FULL;
+			d->winfull++;
+		}
+	}
+
+	/* the ACK side: what does this segment say about the other one? */
+	if (flags & TH_ACK) {
+		if (paylen == 0 && !(flags & (TH_SYN|TH_FIN|TH_RST)) &&
+		    d->have_ack && ack == d->last_ack &&
+		    win != 0 && win == d->last_win &&
+		    r->have_seq && r->next_seq != ack) {
+			res->flags |= TCPA_DUP_ACK;
+			res->dupack = ++d->dupacks;
+			d->dupack_total++;
+		} else if (!d->have_ack || ack != d->last_ack)
+			d->dupacks = 0;
+		if (r->timing && SEQ_GEQ(ack, r->rtt_seq)) {
+			/* an RTT of over 71 minutes is kept as the maximum */
+			usec = tcpa_usec(&ndo->ndo_ts, &r->rtt_sent);
+			rtt = usec > 0xffffffffU ? 0xffffffffU : (u_int32_t)usec;
+			r->timing = 0;
+			if (r->rtt_samples == 0 || rtt < r->rtt_min)
+				r->rtt_min = rtt;
+			if (rtt > r->rtt_max)
+				r->rtt_max = rtt;
+			if (r->rtt_lowest == 0 || rtt < r->rtt_lowest)
+				r->rtt_lowest = rtt;
+			r->rtt_samples++;
+			r->rtt_sum += rtt;
+			res->flags |= TCPA_RTT;
+			res->rtt = rtt;
+		}
+		d->have_ack = 1;
+		d->last_ack = ack;
+	}
+	if (!(flags & TH_RST)) {
+		if (win == 0) {
+			res->flags |= TCPA_ZERO_WINDOW;
+			d->zerowin++;
+		}
+		d->last_win = win;
+		/* the window in a SYN is never scaled */
+		d->rwin = win;
+		if (c->wscale_known && !(flags & TH_SYN) &&
+		    d->wscale >= 0 && r->wscale >= 0)
+			d->rwin <<= d->wscale;
+		if (d->packets == 0 || d->rwin < d->rwin_min)
+			d->rwin_min = d->rwin;
+		if (d->rwin > d->rwin_max)
+			d->rwin_max = d->rwin;
+	}
+
+	d->last_ts = ndo->ndo_ts;
+	d->packets++;
+	d->bytes += paylen;
+}
+
+void
+tcp_analysis_print_result(netdissect_options *ndo,
+			  const struct tcp_analysis_result *res)
+{
+	const struct tok *tp;
+	const char *sep = "";
+
+	if (res->flags == 0)
+		return;
+	ND_PRINT((ndo, ", analysis ["));
+	for (tp = tcpa_flag_values; tp->s != NULL; tp++)
+		if (res->flags & tp->v) {
+			ND_PRINT((ndo, "%s%s", sep, tp->s));
+			sep = ", ";
+		}
+	if (res->flags & TCPA_DUP_ACK) {
+		ND_PRINT((ndo, "%sdup ack #%u", sep, res->dupack));
+		sep = ", ";
+	}
+	if (res->flags & TCPA_RTT)
+		ND_PRINT((ndo, "%srtt %u.%03ums", sep,
+		    res->rtt / 1000, res->rtt % 1000));
+	ND_PRINT((ndo, "]"));
+}
+
+static void
+tcpa_print_end(netdissect_options *ndo, const struct tcpa_conn *c, int e)
+{
+#ifdef INET6
+	if (c->key.af == 6)
+		ND_PRINT((ndo, "%s.", ip6addr_string(c->key.addr[e])));
+	else
+#endif
+		ND_PRINT((ndo, "%s.", ipaddr_string(c->key.addr[e])));
+	ND_PRINT((ndo, "%s", tcpport_string(c->key.port[e])));
+}
+
+static int
+tcpa_cmp(const void *va, const void *vb)
+{
+	const struct tcpa_conn *a = *(const struct tcpa_conn * const *)va;
+	const struct tcpa_conn *b = *(const struct tcpa_conn * const *)vb;
+	u_int64_t abytes, bbytes;
+
+	abytes = a->dir[0].bytes + a->dir[1].bytes;
+	bbytes = b->dir[0].bytes + b->dir[1].bytes;
+	if (abytes != bbytes)
+		return abytes < bbytes ? 1 : -1;
+	return a->index < b->index ? -1 : a->index > b->index;
+}
+
+void
+tcp_analysis_report(netdissect_options *ndo)
+{
+	struct tcpa_conn **sorted, *c;
+	const struct tcpa_dir *d;
+	u_int64_t dur;
+	u_int32_t avg;
+	u_int i, n;
+	int e;
+
+	sorted = NULL;
+	if (tcpa_nconns != 0) {
+		sorted = (struct tcpa_conn **)malloc(tcpa_nconns * sizeof(*sorted));
+		if (sorted == NULL)
+			(*ndo->ndo_error)(ndo, "tcp_analysis_report: malloc");
+	}
+	/* leave out the connections idle since the last reset */
+	for (n = 0, c = tcpa_conns; c != NULL; c = c->next)
+		if (c->dir[0].packets != 0 || c->dir[1].packets != 0)
+			sorted[n++] = c;
+
+	ND_PRINT((ndo, "TCP analysis: %u connection%s", n, PLURAL_SUFFIX(n)));
+	if (tcpa_untracked != 0)
+		ND_PRINT((ndo, ", %" PRIu64 " segment%s of untracked connections",
+		    tcpa_untracked, PLURAL_SUFFIX(tcpa_untracked)));
+	ND_PRINT((ndo, "\n"));
+	if (n == 0) {
+		free(sorted);
+		return;
+	}
+
+	qsort(sorted, n, sizeof(*sorted), tcpa_cmp);
+	if (ndo->ndo_summary_top != 0 && n > ndo->ndo_summary_top)
+		n = ndo->ndo_summary_top;
+
+	for (i = 0; i < n; i++) {
+		c = sorted[i];
+		tcpa_print_end(ndo, c, 0);
+		ND_PRINT((ndo, " <> "));
+		tcpa_print_end(ndo, c, 1);
+		dur = tcpa_usec(&c->last, &c->first);
+		ND_PRINT((ndo, ": duration %" PRIu64 ".%06u%s\n", dur / 1000000,
+		    (u_int)(dur % 1000000),
+		    c->wscale_known ? "" : ", window scale unknown"));
+		for (e = 0; e < 2; e++) {
+			d = &c->dir[e];
+			if (d->packets == 0)
+				continue;
+			ND_PRINT((ndo, "\t"));
+			tcpa_print_end(ndo, c, e);
+			ND_PRINT((ndo, " > "));
+			tcpa_print_end(ndo, c, !e);
+			ND_PRINT((ndo, ": %" PRIu64 " packet%s, %" PRIu64 " byte%s",
+			    d->packets, PLURAL_SUFFIX(d->packets),
+			    d->bytes, PLURAL_SUFFIX(d->bytes)));
+			ND_PRINT((ndo, ", retransmitted %" PRIu64 ", out-of-order %" PRIu64
+			    ", not captured %" PRIu64 ", dup acks %" PRIu64,
+			    d->retrans, d->ooo, d->lost, d->dupack_total));
+			ND_PRINT((ndo, ", zero window %" PRIu64 ", window full %" PRIu64,
+			    d->zerowin, d->winfull));
+			ND_PRINT((ndo, ", win %u-%u", d->rwin_min, d->rwin_max));
+			if (d->sack_blocks != 0)
+				ND_PRINT((ndo, ", sack %" PRIu64 " block%s, %" PRIu64 " bytes",
+				    d->sack_blocks, PLURAL_SUFFIX(d->sack_blocks),
+				    d->sack_bytes));
+			if (d->rtt_samples != 0) {
+				avg = (u_int32_t)(d->rtt_sum / d->rtt_samples);
+				ND_PRINT((ndo, ", rtt min/avg/max %u.%03u/%u.%03u/%u.%03ums (%u sample%s)",
+				    d->rtt_min / 1000, d->rtt_min % 1000,
+				    avg / 1000, avg % 1000,
+				    d->rtt_max / 1000, d->rtt_max % 1000,
+				    d->rtt_samples, PLURAL_SUFFIX(d->rtt_samples)));
+			}
+			ND_PRINT((ndo, "\n"));
+		}
+	}
+	free(sorted);
+}
+
+/*
+ * Start counting again after an interval report.  What is known about
+ * each connection's sequence numbers, windows and RTT timing is kept,
+ * so that it is still followed; connections that were replaced by a
+ * new one on the same ports are let go of.
+ */
+void
+tcp_analysis_reset(netdissect_options *ndo _U_)
+{
+	struct tcpa_conn **cp, *c;
+	struct tcpa_dir *d;
+	int e;
+
+	for (cp = &tcpa_conns; (c = *cp) != NULL; ) {
+		if (c->unhashed) {
+			*cp = c->next;
+			free(c);
+			tcpa_nconns--;
+			continue;
+		}
+		for (e = 0; e < 2; e++) {
+			d = &c->dir[e];
+			d->packets = d->bytes = 0;
+			d->retrans = d->ooo = d->lost = d->dupack_total = 0;
+			d->zerowin = d->winfull = 0;
+			d->sack_blocks = d->sack_bytes = 0;
+			d->rtt_samples = 0;
+			d->rtt_sum = 0;
+			d->rtt_min = d->rtt_max = 0;
+			d->rwin_min = d->rwin_max = 0;
+		}
+		cp = &c->next;
+	}
+	tcpa_untracked = 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * TCP connection analysis (-o tcp-analysis), used by print-tcp.c and
+ * the summary modes.
+ */
+
+/* What tcp_analysis_update() found out about a segment */
+#define TCPA_RETRANSMISSION	0x0001
+#define TCPA_OUT_OF_ORDER	0x0002
+#define TCPA_LOST_SEGMENT	0x0004	/* previous segment not captured */
+#define TCPA_DUP_ACK		0x0008
+#define TCPA_ZERO_WINDOW	0x0010
+#define TCPA_ZERO_WINDOW_PROBE	0x0020
+#define TCPA_WINDOW_FULL	0x0040
+#define TCPA_RTT		0x0080	/* "rtt" holds an RTT sample */
+
+struct tcp_analysis_result {
+	u_int		flags;		/* TCPA_ flags */
+	u_int		dupack;		/* dup ack number, with TCPA_DUP_ACK */
+	u_int32_t	rtt;		/* microseconds, with TCPA_RTT */
+};
+
+/*
+ * "tp" points to the TCP header and "length" is the length of the TCP
+ * header and payload; "src" and "dst" are 4- or 16-byte addresses,
+ * according to "af" (4 or 6).
+ */
+extern void tcp_analysis_update(netdissect_options *, int,
+				const u_char *, const u_char *,
+				const struct tcphdr *, u_int,
+				struct tcp_analysis_result *);
+extern void tcp_analysis_print_result(netdissect_options *,
+				      const struct tcp_analysis_result *);
+extern void tcp_analysis_report(netdissect_options *);
+extern void tcp_analysis_reset(netdissect_options *);
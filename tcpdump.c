@@ -84,6 +84,12 @@ extern int SIZE_BUF;
 #include "setsignal.h"
 #include "gmt2local.h"
 #include "pcap-missing.h"
+#include "dissector.h"
+#include "ipreasm.h"
+#include "porttable.h"
+#include "summary.h"
+#include "statecache.h"
+#include "scratch.h"
 
 #ifndef PATH_MAX
 #define PATH_MAX 1024
@@ -123,6 +129,7 @@ static void usage(void) __attribute__((noreturn));
 static void show_dlts_and_exit(const char *device, pcap_t *pd) __attribute__((noreturn));
 
 static void print_packet(u_char *, const struct pcap_pkthdr *, const u_char *);
+static void summary_packet_cb(u_char *, const struct pcap_pkthdr *, const u_char *);
 static void ndo_default_print(netdissect_options *, const u_char *, u_int);
 static void dump_packet_and_trunc(u_char *, const struct pcap_pkthdr *, const u_char *);
 static void dump_packet(u_char *, const struct pcap_pkthdr *, const u_char *);
@@ -155,103 +162,12 @@ static void info(int);
 static u_int packets_captured;
 
 struct printer {
-        if_printer f;
-	int type;
-};
-
-
-struct ndo_printer {
         if_ndo_printer f;
 	int type;
 };
 
 
 static const struct printer printers[] = {
-	{ sl_if_print,		DLT_SLIP },
-#ifdef DLT_SLIP_BSDOS
-	{ sl_bsdos_if_print,	DLT_SLIP_BSDOS },
-#endif
-	{ ppp_if_print,		DLT_PPP },
-#ifdef DLT_PPP_WITHDIRECTION
-	{ ppp_if_print,		DLT_PPP_WITHDIRECTION },
-#endif
-#ifdef DLT_PPP_BSDOS
-	{ ppp_bsdos_if_print,	DLT_PPP_BSDOS },
-#endif
-	{ atm_if_print,		DLT_ATM_RFC1483 },
-#ifdef DLT_PPP_SERIAL
-	{ ppp_hdlc_if_print,	DLT_PPP_SERIAL },
-#endif
-#ifdef DLT_IEEE802_11
-	{ ieee802_11_if_print,	DLT_IEEE802_11},
-#endif
-#ifdef DLT_LTALK
-	{ ltalk_if_print,	DLT_LTALK },
-#endif
-#ifdef DLT_SUNATM
-	{ sunatm_if_print,	DLT_SUNATM },
-#endif
-#ifdef DLT_PRISM_HEADER
-	{ prism_if_print,	DLT_PRISM_HEADER },
-#endif
-#ifdef DLT_IEEE802_11_RADIO
-	{ ieee802_11_radio_if_print,	DLT_IEEE802_11_RADIO },
-#endif
-#ifdef DLT_ENC
-	{ enc_if_print,		DLT_ENC },
-#endif
-#ifdef DLT_IEEE802_11_RADIO_AVS
-	{ ieee802_11_radio_avs_if_print,	DLT_IEEE802_11_RADIO_AVS },
-#endif
-#ifdef DLT_JUNIPER_ATM1
-	{ juniper_atm1_print,	DLT_JUNIPER_ATM1 },
-#endif
-#ifdef DLT_JUNIPER_ATM2
-	{ juniper_atm2_print,	DLT_JUNIPER_ATM2 },
-#endif
-#ifdef DLT_JUNIPER_MFR
-	{ juniper_mfr_print,	DLT_JUNIPER_MFR },
-#endif
-#ifdef DLT_JUNIPER_MLFR
-	{ juniper_mlfr_print,	DLT_JUNIPER_MLFR },
-#endif
-#ifdef DLT_JUNIPER_MLPPP
-	{ juniper_mlppp_print,	DLT_JUNIPER_MLPPP },
-#endif
-#ifdef DLT_JUNIPER_PPPOE
-	{ juniper_pppoe_print,	DLT_JUNIPER_PPPOE },
-#endif
-#ifdef DLT_JUNIPER_PPPOE_ATM
-	{ juniper_pppoe_atm_print, DLT_JUNIPER_PPPOE_ATM },
-#endif
-#ifdef DLT_JUNIPER_GGSN
-	{ juniper_ggsn_print,	DLT_JUNIPER_GGSN },
-#endif
-#ifdef DLT_JUNIPER_ES
-	{ juniper_es_print,	DLT_JUNIPER_ES },
-#endif
-#ifdef DLT_JUNIPER_MONITOR
-	{ juniper_monitor_print, DLT_JUNIPER_MONITOR },
-#endif
-#ifdef DLT_JUNIPER_SERVICES
-	{ juniper_services_print, DLT_JUNIPER_SERVICES },
-#endif
-#ifdef DLT_JUNIPER_ETHER
-	{ juniper_ether_print,	DLT_JUNIPER_ETHER },
-#endif
-#ifdef DLT_JUNIPER_PPP
-	{ juniper_ppp_print,	DLT_JUNIPER_PPP },
-#endif
-#ifdef DLT_JUNIPER_FRELAY
-	{ juniper_frelay_print,	DLT_JUNIPER_FRELAY },
-#endif
-#ifdef DLT_JUNIPER_CHDLC
-	{ juniper_chdlc_print,	DLT_JUNIPER_CHDLC },
-#endif
-	{ NULL,			0 },
-};
-
-static const struct ndo_printer ndo_printers[] = {
 	{ ether_if_print,	DLT_EN10MB },
 #ifdef DLT_IPNET
 	{ ipnet_if_print,	DLT_IPNET },
@@ -343,6 +259,87 @@ static const struct ndo_printer ndo_printers[] = {
 #endif
 #ifdef DLT_MFR
 	{ mfr_if_print,		DLT_MFR },
+#endif
+	{ sl_if_print,		DLT_SLIP },
+#ifdef DLT_SLIP_BSDOS
+	{ sl_bsdos_if_print,	DLT_SLIP_BSDOS },
+#endif
+	{ ppp_if_print,		DLT_PPP },
+#ifdef DLT_PPP_WITHDIRECTION
+	{ ppp_if_print,		DLT_PPP_WITHDIRECTION },
+#endif
+#ifdef DLT_PPP_BSDOS
+	{ ppp_bsdos_if_print,	DLT_PPP_BSDOS },
+#endif
+	{ atm_if_print,		DLT_ATM_RFC1483 },
+#ifdef DLT_PPP_SERIAL
+	{ ppp_hdlc_if_print,	DLT_PPP_SERIAL },
+#endif
+#ifdef DLT_IEEE802_11
+	{ ieee802_11_if_print,	DLT_IEEE802_11},
+#endif
+#ifdef DLT_LTALK
+	{ ltalk_if_print,	DLT_LTALK },
+#endif
+#ifdef DLT_SUNATM
+	{ sunatm_if_print,	DLT_SUNATM },
+#endif
+#ifdef DLT_PRISM_HEADER
+	{ prism_if_print,	DLT_PRISM_HEADER },
+#endif
+#ifdef DLT_IEEE802_11_RADIO
+	{ ieee802_11_radio_if_print,	DLT_IEEE802_11_RADIO },
+#endif
+#ifdef DLT_ENC
+	{ enc_if_print,		DLT_ENC },
+#endif
+#ifdef DLT_IEEE802_11_RADIO_AVS
+	{ ieee802_11_radio_avs_if_print,	DLT_IEEE802_11_RADIO_AVS },
+#endif
+#ifdef DLT_JUNIPER_ATM1
+	{ juniper_atm1_print,	DLT_JUNIPER_ATM1 },
+#endif
+#ifdef DLT_JUNIPER_ATM2
+	{ juniper_atm2_print,	DLT_JUNIPER_ATM2 },
+#endif
+#ifdef DLT_JUNIPER_MFR
+	{ juniper_mfr_print,	DLT_JUNIPER_MFR },
+#endif
+#ifdef DLT_JUNIPER_MLFR
+	{ juniper_mlfr_print,	DLT_JUNIPER_MLFR },
+#endif
+#ifdef DLT_JUNIPER_MLPPP
+	{ juniper_mlppp_print,	DLT_JUNIPER_MLPPP },
+#endif
+#ifdef DLT_JUNIPER_PPPOE
+	{ juniper_pppoe_print,	DLT_JUNIPER_PPPOE },
+#endif
+#ifdef DLT_JUNIPER_PPPOE_ATM
+	{ juniper_pppoe_atm_print, DLT_JUNIPER_PPPOE_ATM },
+#endif
+#ifdef DLT_JUNIPER_GGSN
+	{ juniper_ggsn_print,	DLT_JUNIPER_GGSN },
+#endif
+#ifdef DLT_JUNIPER_ES
+	{ juniper_es_print,	DLT_JUNIPER_ES },
+#endif
+#ifdef DLT_JUNIPER_MONITOR
+	{ juniper_monitor_print, DLT_JUNIPER_MONITOR },
+#endif
+#ifdef DLT_JUNIPER_SERVICES
+	{ juniper_services_print, DLT_JUNIPER_SERVICES },
+#endif
+#ifdef DLT_JUNIPER_ETHER
+	{ juniper_ether_print,	DLT_JUNIPER_ETHER },
+#endif
+#ifdef DLT_JUNIPER_PPP
+	{ juniper_ppp_print,	DLT_JUNIPER_PPP },
+#endif
+#ifdef DLT_JUNIPER_FRELAY
+	{ juniper_frelay_print,	DLT_JUNIPER_FRELAY },
+#endif
+#ifdef DLT_JUNIPER_CHDLC
+	{ juniper_chdlc_print,	DLT_JUNIPER_CHDLC },
 #endif
 	{ NULL,			0 },
 };
@@ -358,25 +355,36 @@ static const struct tok status_flags[] = {
 	{ 0, NULL }
 };
 
-if_printer
-lookup_printer(int type)
-{
-	const struct printer *p;
+/*
+ * printers[] indexed by link-layer type, filled in by the first lookup;
+ * the first entry for a type wins, as it did when printers[] was
+ * searched.  Types too large for the table are still searched for.
+ */
+#define PRINTER_TABLE_SIZE	512
 
-	for (p = printers; p->f; ++p)
-		if (type == p->type)
-			return p->f;
-
-	return NULL;
-	/* NOTREACHED */
-}
+static if_ndo_printer printer_table[PRINTER_TABLE_SIZE];
+static int printer_table_built;
 
 if_ndo_printer
 lookup_ndo_printer(int type)
 {
-	const struct ndo_printer *p;
+	const struct printer *p;
+	if_ndo_printer f;
 
-	for (p = ndo_printers; p->f; ++p)
+	if ((f = dissector_lookup_dlt(type)) != NULL)
+		return f;
+
+	if (!printer_table_built) {
+		for (p = printers; p->f; ++p)
+			if (p->type >= 0 && p->type < PRINTER_TABLE_SIZE &&
+			    printer_table[p->type] == NULL)
+				printer_table[p->type] = p->f;
+		printer_table_built = 1;
+	}
+	if (type >= 0 && type < PRINTER_TABLE_SIZE)
+		return printer_table[type];
+
+	for (p = printers; p->f; ++p)
 		if (type == p->type)
 			return p->f;
 
@@ -394,11 +402,7 @@ extern char *optarg;
 
 struct print_info {
         netdissect_options *ndo;
-        union {
-                if_printer     printer;
-                if_ndo_printer ndo_printer;
-        } p;
-        int ndo_type;
+        if_ndo_printer printer;
 };
 
 struct dump_info {
@@ -480,8 +484,7 @@ show_dlts_and_exit(const char *device, pcap_t *pd)
 			/*
 			 * OK, does tcpdump handle that type?
 			 */
-			if (lookup_printer(dlts[n_dlts]) == NULL
-                            && lookup_ndo_printer(dlts[n_dlts]) == NULL)
+			if (lookup_ndo_printer(dlts[n_dlts]) == NULL)
 				(void) fprintf(stderr, " (printing not supported)");
 			fprintf(stderr, "\n");
 		} else {
@@ -625,6 +628,132 @@ droproot(const char *username, const char *chroot_dir)
 }
 #endif /* WIN32 */
 
+/*
+ * Parse the argument of -o, a comma-separated list of dissector
+ * options, each either "name" or "name=value".
+ */
+static u_int
+get_option_uint(const char *name, const char *value)
+{
+	char *end;
+	u_long v;
+
+	if (value == NULL)
+		error("option `%s' requires a value", name);
+	v = strtoul(value, &end, 0);
+	if (end == value || *end != '\0' || v > UINT_MAX)
+		error("invalid value `%s' for option `%s'", value, name);
+	return (u_int)v;
+}
+
+/*
+ * Ports files are read once all of the options have been parsed, as
+ * they may name printers added by plugins given after them.
+ */
+static char **ports_files;
+static u_int n_ports_files;
+
+static void
+load_ports_files(void)
+{
+	u_int i;
+
+	for (i = 0; i < n_ports_files; i++) {
+		port_table_load(ports_files[i]);
+		free(ports_files[i]);
+	}
+	free(ports_files);
+	ports_files = NULL;
+	n_ports_files = 0;
+}
+
+static void
+parse_dissector_options(const char *arg)
+{
+	char *buf, *p, *name, *value;
+
+	buf = p = strdup(arg);
+	if (buf == NULL)
+		error("parse_dissector_options: strdup");
+	while ((name = strsep(&p, ",")) != NULL) {
+		if (*name == '\0')
+			continue;
+		value = strchr(name, '=');
+		if (value != NULL)
+			*value++ = '\0';
+
+		if (strcasecmp(name, "reassemble") == 0)
+			gndo->ndo_reassemble = 1;
+		else if (strcasecmp(name, "frag-timeout") == 0)
+			gndo->ndo_frag_timeout = get_option_uint(name, value);
+		else if (strcasecmp(name, "frag-memory") == 0)
+			gndo->ndo_frag_memory = get_option_uint(name, value);
+		else if (strcasecmp(name, "tcp-analysis") == 0)
+			gndo->ndo_tcp_analysis = 1;
+		else if (strcasecmp(name, "ike-cookies") == 0)
+			gndo->ndo_ike_cookies = get_option_uint(name, value);
+		else if (strcasecmp(name, "ike-timeout") == 0)
+			gndo->ndo_ike_timeout = get_option_uint(name, value);
+		else if (strcasecmp(name, "rx-calls") == 0)
+			gndo->ndo_rx_calls = get_option_uint(name, value);
+		else if (strcasecmp(name, "rx-timeout") == 0)
+			gndo->ndo_rx_timeout = get_option_uint(name, value);
+		else if (strcasecmp(name, "rx-stats") == 0)
+			gndo->ndo_rx_stats = 1;
+		else if (strcasecmp(name, "dns-queries") == 0)
+			gndo->ndo_dns_queries = get_option_uint(name, value);
+		else if (strcasecmp(name, "dns-timeout") == 0)
+			gndo->ndo_dns_timeout = get_option_uint(name, value);
+		else if (strcasecmp(name, "flows") == 0)
+			gndo->ndo_summary |= SUMMARY_FLOWS;
+		else if (strcasecmp(name, "bgp-stats") == 0)
+			gndo->ndo_summary |= SUMMARY_BGP;
+		else if (strcasecmp(name, "wlan-stats") == 0)
+			gndo->ndo_summary |= SUMMARY_WLAN;
+		else if (strcasecmp(name, "netflow-stats") == 0)
+			gndo->ndo_summary |= SUMMARY_NETFLOW;
+		else if (strcasecmp(name, "sflow-stats") == 0)
+			gndo->ndo_summary |= SUMMARY_SFLOW;
+		else if (strcasecmp(name, "dns-stats") == 0)
+			gndo->ndo_summary |= SUMMARY_DNS;
+		else if (strcasecmp(name, "bgp-counts") == 0)
+			gndo->ndo_bgp_counts = 1;
+		else if (strcasecmp(name, "top") == 0)
+			gndo->ndo_summary_top = get_option_uint(name, value);
+		else if (strcasecmp(name, "interval") == 0)
+			gndo->ndo_summary_interval = get_option_uint(name, value);
+		else if (strcasecmp(name, "flow-max") == 0)
+			gndo->ndo_flow_max = get_option_uint(name, value);
+		else if (strcasecmp(name, "esp-reload") == 0)
+			gndo->ndo_esp_reload = get_option_uint(name, value);
+		else if (strcasecmp(name, "snmp-stats") == 0)
+			gndo->ndo_summary |= SUMMARY_SNMP;
+		else if (strcasecmp(name, "snmp-oids") == 0) {
+			if (value == NULL)
+				error("option `%s' requires a value", name);
+			snmp_load_oids(value);
+		}
+		else if (strcasecmp(name, "ports") == 0) {
+			if (value == NULL)
+				error("option `%s' requires a value", name);
+			ports_files = realloc(ports_files,
+			    (n_ports_files + 1) * sizeof(*ports_files));
+			if (ports_files == NULL ||
+			    (ports_files[n_ports_files] = strdup(value)) == NULL)
+				error("parse_dissector_options: out of memory");
+			n_ports_files++;
+		}
+		else if (strcasecmp(name, "plugin") == 0) {
+			if (value == NULL)
+				error("option `%s' requires a value", name);
+			dissector_load_plugin(value);
+		}
+		else
+			error("unknown -o option `%s'", name);
+	}
+	free(buf);
+}
+
 static int
 getWflagChars(int x)
 {
@@ -692,20 +821,15 @@ get_print_info(int type)
 {
 	struct print_info printinfo;
 
-	printinfo.ndo_type = 1;
 	printinfo.ndo = gndo;
-	printinfo.p.ndo_printer = lookup_ndo_printer(type);
-	if (printinfo.p.ndo_printer == NULL) {
-		printinfo.p.printer = lookup_printer(type);
-		printinfo.ndo_type = 0;
-		if (printinfo.p.printer == NULL) {
-			gndo->ndo_dltname = pcap_datalink_val_to_name(type);
-			if (gndo->ndo_dltname != NULL)
-				error("packet printing is not supported for link type %s: use -w",
-				      gndo->ndo_dltname);
-			else
-				error("packet printing is not supported for link type %d: use -w", type);
-		}
+	printinfo.printer = lookup_ndo_printer(type);
+	if (printinfo.printer == NULL) {
+		gndo->ndo_dltname = pcap_datalink_val_to_name(type);
+		if (gndo->ndo_dltname != NULL)
+			error("packet printing is not supported for link type %s: use -w",
+			      gndo->ndo_dltname);
+		else
+			error("packet printing is not supported for link type %d: use -w", type);
 	}
 	return (printinfo);
 }
@@ -768,6 +892,16 @@ main(int argc, char **argv)
 	gndo->ndo_error=ndo_error;
 	gndo->ndo_warning=ndo_warning;
 	gndo->ndo_snaplen = DEFAULT_SNAPLEN;
+	gndo->ndo_frag_timeout = IP_REASM_DEFAULT_TIMEOUT;
+	gndo->ndo_frag_memory = IP_REASM_DEFAULT_MEMORY;
+	gndo->ndo_summary_top = SUMMARY_DEFAULT_TOP;
+	gndo->ndo_flow_max = SUMMARY_DEFAULT_FLOW_MAX;
+	gndo->ndo_ike_cookies = IKE_COOKIE_DEFAULT_MAX;
+	gndo->ndo_ike_timeout = IKE_COOKIE_DEFAULT_TIMEOUT;
+	gndo->ndo_rx_calls = RX_CALL_DEFAULT_MAX;
+	gndo->ndo_rx_timeout = RX_CALL_DEFAULT_TIMEOUT;
+	gndo->ndo_dns_queries = DNS_QUERY_DEFAULT_MAX;
+	gndo->ndo_dns_timeout = DNS_QUERY_DEFAULT_TIMEOUT;
 
 	cnt = -1;
 	device = NULL;
@@ -790,7 +924,7 @@ main(int argc, char **argv)
 #endif
 
 	while (
-	    (op = getopt(argc, argv, "aAb" B_FLAG "c:C:d" D_FLAG "eE:fF:G:hHi:" I_FLAG j_FLAG J_FLAG "KlLm:M:nNOpq" Q_FLAG "r:Rs:StT:u" U_FLAG "vV:w:W:xXy:Yz:Z:")) != -1)
+	    (op = getopt(argc, argv, "aAb" B_FLAG "c:C:d" D_FLAG "eE:fF:G:hHi:" I_FLAG j_FLAG J_FLAG "KlLm:M:nNo:Opq" Q_FLAG "r:Rs:StT:u" U_FLAG "vV:w:W:xXy:Yz:Z:")) != -1)
 		switch (op) {
 
 		case 'a':
@@ -993,6 +1127,10 @@ main(int argc, char **argv)
 			++Nflag;
 			break;
 
+		case 'o':
+			parse_dissector_options(optarg);
+			break;
+
 		case 'O':
 			Oflag = 0;
 			break;
@@ -1155,6 +1293,8 @@ main(int argc, char **argv)
 			/* NOTREACHED */
 		}
 
+	load_ports_files();
+
 #ifdef HAVE_PCAP_FINDALLDEVS
 	if (Dflag)
 		show_devices_and_exit();
@@ -1184,6 +1324,9 @@ main(int argc, char **argv)
 	if (VFileName != NULL && RFileName != NULL)
 		error("-V and -r are mutually exclusive.");
 
+	if (summary_reporting(gndo) && WFileName != NULL)
+		error("summary modes can not be used with -w");
+
 #ifdef WITH_CHROOT
 	/* if run as root, prepare for chrooting */
 	if (getuid() == 0 || geteuid() == 0) {
@@ -1533,6 +1676,11 @@ main(int argc, char **argv)
 		if (Uflag)
 			pcap_dump_flush(p);
 #endif
+	} else if (gndo->ndo_summary != 0) {
+		type = pcap_datalink(pd);
+		summary_init(gndo, type);
+		callback = summary_packet_cb;
+		pcap_userdata = NULL;
 	} else {
 		type = pcap_datalink(pd);
 		printinfo = get_print_info(type);
@@ -1641,7 +1789,10 @@ main(int argc, char **argv)
 				new_dlt = pcap_datalink(pd);
 				if (WFileName && new_dlt != dlt)
 					error("%s: new dlt does not match original", RFileName);
-				printinfo = get_print_info(new_dlt);
+				if (gndo->ndo_summary != 0)
+					summary_init(gndo, new_dlt);
+				else
+					printinfo = get_print_info(new_dlt);
 				dlt_name = pcap_datalink_val_to_name(new_dlt);
 				if (dlt_name == NULL) {
 					fprintf(stderr, "reading from file %s, link-type %u\n",
@@ -1661,6 +1812,11 @@ main(int argc, char **argv)
 	}
 	while (ret != NULL);
 
+	if (summary_reporting(gndo)) {
+		summary_print(gndo);
+		(void)fflush(stdout);
+	}
+
 	free(cmdbuf);
 	exit(status == -1 ? 1 : 0);
 }
@@ -1723,6 +1879,15 @@ info(register int verbose)
 {
 	struct pcap_stat stat;
 
+	/*
+	 * On a request for information, also show what the summary
+	 * modes have collected so far.
+	 */
+	if (!verbose && summary_reporting(gndo)) {
+		summary_print(gndo);
+		(void)fflush(stdout);
+	}
+
 	/*
 	 * Older versions of libpcap didn't set ps_ifdrop on some
 	 * platforms; initialize it to 0 to handle that.
@@ -1969,10 +2134,19 @@ print_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
 	++packets_captured;
 
 	++infodelay;
-	ts_print(&h->ts);
 
 	print_info = (struct print_info *)user;
         ndo = print_info->ndo;
+	ndo->ndo_ts = h->ts;
+
+	/*
+	 * Statistics collected while printing, such as those of
+	 * "-o rx-stats", are reported every "-o interval" too.
+	 */
+	if (summary_reporting(ndo))
+		summary_interval(ndo, &h->ts);
+
+	ts_print(&h->ts);
 
 	/*
 	 * Some printers want to check that they're not walking off the
@@ -1981,11 +2155,7 @@ print_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
 	 */
 	ndo->ndo_snapend = sp + h->caplen;
 
-        if(print_info->ndo_type) {
-                hdrlen = (*print_info->p.ndo_printer)(print_info->ndo, h, sp);
-        } else {
-                hdrlen = (*print_info->p.printer)(h, sp);
-        }
+	hdrlen = (*print_info->printer)(ndo, h, sp);
 
 	if (ndo->ndo_Xflag) {
 		/*
@@ -2047,6 +2217,26 @@ print_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
 
 	putchar('\n');
 
+	scratch_reset(ndo);
+
+	--infodelay;
+	if (infoprint)
+		info(0);
+}
+
+/*
+ * Callback used instead of print_packet() when a summary mode is
+ * selected; packets are only counted, not printed.
+ */
+static void
+summary_packet_cb(u_char *user _U_, const struct pcap_pkthdr *h,
+		  const u_char *sp)
+{
+	++packets_captured;
+
+	++infodelay;
+	summary_packet(gndo, h, sp);
+	scratch_reset(gndo);
 	--infodelay;
 	if (infoprint)
 		info(0);
@@ -2160,7 +2350,7 @@ usage(void)
 	(void)fprintf(stderr,
 "\t\t[ -C file_size ] [ -E algo:secret ] [ -F file ] [ -G seconds ]\n");
 	(void)fprintf(stderr,
-"\t\t[ -i interface ]" j_FLAG_USAGE " [ -M secret ]\n");
+"\t\t[ -i interface ]" j_FLAG_USAGE " [ -M secret ] [ -o option[,option...] ]\n");
 #ifdef HAVE_PCAP_SETDIRECTION
 	(void)fprintf(stderr,
 "\t\t[ -Q in|out|inout ]\n");
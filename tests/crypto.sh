@@ -9,8 +9,17 @@ then
 	./TESTonce esp3 02-sunrise-sunset-esp.pcap esp1.out '-t -E "3des-cbc-hmac96:0x4043434545464649494a4a4c4c4f4f515152525454575758"'
 	./TESTonce esp4 08-sunrise-sunset-esp2.pcap esp2.out '-t -E "file esp-secrets.txt"'
 	./TESTonce esp5 08-sunrise-sunset-aes.pcap esp5.out '-t -E "file esp-secrets.txt"'
+	./TESTonce esp-gcm esp-gcm.pcap esp-gcm.out '-n -t -E "file esp-gcm-secrets.txt"'
 	./TESTonce espudp1 espudp1.pcap espudp1.out '-nnnn -t -E "file esp-secrets.txt"'
 	./TESTonce ikev2pI2 ikev2pI2.pcap ikev2pI2.out '-t -E "file ikev2pI2-secrets.txt" -v -v -v -v'
+	./TESTonce tcp-md5 tcp-md5.pcap tcp-md5.out '-n -t -v -M sekrit'
+	# the secrets show up after the first two packets (468 bytes)
+	mkdir -p NEW
+	echo '# no keys yet' > NEW/esp-reload-secrets.txt
+	(dd bs=468 count=1 2>/dev/null; sleep 1;
+	 cp esp-secrets.txt NEW/esp-reload-secrets.txt; sleep 2;
+	 cat) < 08-sunrise-sunset-esp2.pcap |
+	./TESTonce esp-reload - esp-reload.out '-t -o esp-reload=1 -E "file NEW/esp-reload-secrets.txt"'
 else
 	FORMAT='    %-30s: TEST SKIPPED (compiled w/o OpenSSL)\n'
 	printf "$FORMAT" esp1
@@ -18,6 +27,9 @@ else
 	printf "$FORMAT" esp3
 	printf "$FORMAT" esp4
 	printf "$FORMAT" esp5
+	printf "$FORMAT" esp-gcm
 	printf "$FORMAT" espudp1
 	printf "$FORMAT" ikev2pI2
+	printf "$FORMAT" tcp-md5
+	printf "$FORMAT" esp-reload
 fi
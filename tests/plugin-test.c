@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2014 The TCPDUMP project
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Dissector plugin for the tests: "testproto" on UDP and TCP port 7777,
+ * Ethernet type 0x88b5 (local experimental) and IP protocol 253
+ * (experimentation).  A testproto message starts with a 32-bit ID.
+ *
+ * Only ND_PRINT() and the EXTRACT_ macros are used, as the plugin can't
+ * call functions in tcpdump.
+ */
+
+#define NETDISSECT_REWORKED
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <tcpdump-stdinc.h>
+
+#include "interface.h"
+#include "extract.h"
+#include "dissector.h"
+
+#define TESTPROTO_PORT		7777
+#define TESTPROTO_ETHERTYPE	0x88b5
+#define TESTPROTO_IPPROTO	253
+
+DISSECTOR_PLUGIN_ABI;
+
+static void
+testproto_print(netdissect_options *ndo, const char *over, const u_char *bp,
+		u_int length)
+{
+	ND_PRINT((ndo, "testproto over %s, length %u", over, length));
+	ND_TCHECK2(*bp, 4);
+	ND_PRINT((ndo, ", id %u", EXTRACT_32BITS(bp)));
+	return;
+trunc:
+	ND_PRINT((ndo, " [|testproto]"));
+}
+
+static void
+testproto_udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
+		    const u_char *ip _U_)
+{
+	testproto_print(ndo, "UDP", bp, length);
+}
+
+static void
+testproto_tcp_print(netdissect_options *ndo, const u_char *bp, u_int length,
+		    const u_char *ip _U_)
+{
+	testproto_print(ndo, "TCP", bp, length);
+}
+
+static void
+testproto_ether_print(netdissect_options *ndo, const u_char *bp,
+		      u_int length, const u_char *ip _U_)
+{
+	testproto_print(ndo, "Ethernet", bp, length);
+}
+
+static void
+testproto_ip_print(netdissect_options *ndo, const u_char *bp, u_int length,
+		   const u_char *ip)
+{
+	/* the version is in the first 4 bits of either header */
+	testproto_print(ndo, (*ip >> 4) == 6 ? "IPv6" : "IPv4", bp, length);
+}
+
+int
+netdissect_plugin_init(const struct dissector_api *api)
+{
+	if (api->version < DISSECTOR_API_VERSION)
+		return (-1);
+	api->register_port("udp", TESTPROTO_PORT, TESTPROTO_PORT, "testproto",
+	    testproto_udp_print);
+	api->register_port("tcp", TESTPROTO_PORT, TESTPROTO_PORT, "testproto",
+	    testproto_tcp_print);
+	api->register_ethertype(TESTPROTO_ETHERTYPE, testproto_ether_print);
+	api->register_ipproto(TESTPROTO_IPPROTO, testproto_ip_print);
+	return (0);
+}
@@ -0,0 +1,18 @@
+#!/bin/sh
+
+# Only attempt the dissector plugin tests when compiled with dlopen();
+# plugin-test.so is built by "make check".
+
+if grep '^#define HAVE_DLOPEN 1$' ../config.h >/dev/null
+then
+	status=0
+	./TESTonce plugin plugin-test.pcap plugin.out '-t -o plugin=./plugin-test.so' || status=1
+	./TESTonce plugin-ports plugin-test.pcap plugin-ports.out '-t -o plugin=./plugin-test.so,ports=plugin-test-ports.txt' || status=1
+	./TESTonce plugin-ports-first plugin-test.pcap plugin-ports.out '-t -o ports=plugin-test-ports.txt,plugin=./plugin-test.so' || status=1
+	exit $status
+else
+	FORMAT='    %-30s: TEST SKIPPED (compiled w/o dlopen)\n'
+	printf "$FORMAT" plugin
+	printf "$FORMAT" plugin-ports
+	printf "$FORMAT" plugin-ports-first
+fi
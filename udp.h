@@ -88,6 +88,8 @@ struct udphdr {
 #define LWAPP_CONTROL_PORT      12223 /* draft-ohara-capwap-lwapp-04.txt */
 #define OTV_PORT                8472  /* draft-hasmit-otv-04 */
 #define VXLAN_PORT              4789  /* draft-mahalingam-dutt-dcops-vxlan-04 */
+#define NETFLOW_PORT            2055  /* usual NetFlow collector port */
+#define IPFIX_PORT              4739  /* RFC 7011 */
 
 #ifdef INET6
 #define RIPNG_PORT 521		/*XXX*/
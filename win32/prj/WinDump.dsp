@@ -109,6 +109,10 @@ SOURCE=..\..\missing\datalinks.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\dissector.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\missing\dlnames.c
 # End Source File
 # Begin Source File
@@ -141,6 +145,10 @@ SOURCE=..\..\ipproto.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\ipreasm.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\l2vpn.c
 # End Source File
 # Begin Source File
@@ -161,6 +169,10 @@ SOURCE=..\..\parsenfsfh.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\porttable.c
+# End Source File
+# Begin Source File
+
 SOURCE="..\..\print-802_11.c"
 # End Source File
 # Begin Source File
@@ -605,6 +617,10 @@ SOURCE="..\..\print-zephyr.c"
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\scratch.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\setsignal.c
 # End Source File
 # Begin Source File
@@ -613,6 +629,18 @@ SOURCE=..\..\smbutil.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\statecache.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\summary.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\tcpanalysis.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\strcasecmp.c
 # End Source File
 # Begin Source File